@@ -2,10 +2,40 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <float.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "lexer_dfa.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <direct.h>
+#include <process.h>
+#include <sys/utime.h>
+#define getpid _getpid
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
 
 //编译运行实例
 //gcc lexer.c -o lexer
 //lexer sample.c
+//多文件/目录/文件列表：lexer [-j N] [--stats] [--profile] [--values] [--format text|binary|ndjson] a.c b.c src/ @files.txt -（需 -pthread；- 为标准输入）
+//二进制 Token 流还原为文本：lexer --decode tokens.bin
+//作为库使用：先 #define LEXER_NO_MAIN 再 #include "Untitled-1.c"（见 bench.c）
 typedef enum {
     TK_IDENTIFIER, TK_KEYWORD, TK_INT_LITERAL, TK_HEX_LITERAL,
     TK_FLOAT_LITERAL, TK_STRING_LITERAL, TK_CHAR_LITERAL,
@@ -13,11 +43,32 @@ typedef enum {
     TK_ERROR, TK_EOF
 } TokenKind;
 
+typedef enum {
+    TV_NONE,            /* not decoded */
+    TV_OK,
+    TV_OVERFLOW,        /* integer above ULLONG_MAX (value saturated) or float to infinity */
+    TV_MALFORMED        /* 8 or 9 in an octal literal, "0x" or an exponent without digits */
+} TokenValueStatus;
+
+typedef union {
+    unsigned long long u;   /* INT, HEX */
+    double d;               /* FLOAT */
+} TokenValue;
+
+/* lexeme/length describe a slice of the input buffer (offset is its byte
+ * position), so scanning a mapped file copies nothing.  Error and EOF tokens
+ * point at static text instead. */
 typedef struct {
     TokenKind kind;
-    char lexeme[256];
+    TokenValueStatus value_status;
+    const char *lexeme;
+    size_t length;
+    size_t offset;
     size_t line;
     size_t column;
+    int keyword;        /* KeywordId for TK_KEYWORD, KW_NONE otherwise */
+    int symbol;         /* interned spelling when the scanner has a SymbolTable */
+    TokenValue value;   /* numeric literals, when the scanner decodes values */
 } Token;
 
 static const char *keywords[] = {
@@ -27,317 +78,4064 @@ static const char *keywords[] = {
     "switch","typedef","union","unsigned","void","volatile","while",NULL
 };
 
-static int is_keyword(const char *lexeme) {
-    for (size_t i = 0; keywords[i]; ++i) {
-        if (strcmp(keywords[i], lexeme) == 0) {
-            return 1;
+/* Keyword ids follow the order of keywords[]. */
+typedef enum {
+    KW_NONE = -1,
+    KW_AUTO, KW_BREAK, KW_CASE, KW_CHAR, KW_CONST, KW_CONTINUE, KW_DEFAULT, KW_DO,
+    KW_DOUBLE, KW_ELSE, KW_ENUM, KW_EXTERN, KW_FLOAT, KW_FOR, KW_GOTO, KW_IF,
+    KW_INLINE, KW_INT, KW_LONG, KW_REGISTER, KW_RESTRICT, KW_RETURN, KW_SHORT,
+    KW_SIGNED, KW_SIZEOF, KW_STATIC, KW_STRUCT, KW_SWITCH, KW_TYPEDEF, KW_UNION,
+    KW_UNSIGNED, KW_VOID, KW_VOLATILE, KW_WHILE, KW_COUNT
+} KeywordId;
+
+/* Collision-free hash over (first char, second char, last char, length):
+ * the top 6 bits of key * KEYWORD_HASH_MUL pick one of 64 slots, each holding
+ * keyword id + 1 or 0.  The multiplier was found by searching odd 32-bit
+ * constants until all of keywords[] landed in distinct slots; rerun that
+ * search and rebuild keyword_slots whenever the table changes. */
+#define KEYWORD_MIN_LEN 2
+#define KEYWORD_MAX_LEN 8
+#define KEYWORD_HASH_MUL 0x9dc4fa6bu
+
+static const unsigned char keyword_slots[64] = {
+     0,  0, 14,  1, 18, 22, 27,  3, 15,  0,  0, 11,  0,  0,  4, 34,
+     0, 33, 29,  0,  0,  9,  0,  0,  0, 19,  0, 30,  8, 23, 26,  0,
+     0, 13,  0,  6,  0,  0,  0, 32,  0, 17,  0, 28, 12,  0,  0,  7,
+     0,  0, 21, 16, 10, 20,  0,  2,  0,  0, 31,  0, 25,  0,  5, 24
+};
+
+/* strlen of each keywords[] entry, checked before the spelling is compared
+ * so a longer lexeme never reads past the end of a shorter keyword. */
+static const unsigned char keyword_lengths[KW_COUNT] = {
+    4, 5, 4, 4, 5, 8, 7, 2, 6, 4, 4, 6, 5, 3, 4, 2, 6, 3, 4,
+    8, 8, 6, 5, 6, 6, 6, 6, 6, 7, 5, 8, 4, 8, 5
+};
+
+static KeywordId keyword_lookup(const char *lexeme, size_t length) {
+    if (length < KEYWORD_MIN_LEN || length > KEYWORD_MAX_LEN) {
+        return KW_NONE;
+    }
+    const unsigned char *p = (const unsigned char *)lexeme;
+    unsigned key = (unsigned)p[0] | (unsigned)p[1] << 8 |
+                   (unsigned)p[length - 1] << 16 | (unsigned)length << 24;
+    unsigned slot = keyword_slots[(unsigned)((key * KEYWORD_HASH_MUL) & 0xffffffffu) >> 26];
+    if (slot == 0) {
+        return KW_NONE;
+    }
+    if (keyword_lengths[slot - 1] != length || memcmp(keywords[slot - 1], lexeme, length) != 0) {
+        return KW_NONE;
+    }
+    return (KeywordId)(slot - 1);
+}
+
+/* Interned spellings.  Each distinct identifier or literal spelling gets a
+ * dense id; the keywords are interned first, so a keyword's id equals its
+ * KeywordId.  Spellings are copied once into arena blocks (NUL-terminated)
+ * and looked up through an open-addressing table of (hash, id) pairs. */
+#define SYMBOL_NONE (-1)
+#define SYMBOL_ARENA_BLOCK (64u << 10)
+
+typedef struct SymbolBlock {
+    struct SymbolBlock *next;
+    size_t used;
+    size_t cap;
+    char data[];
+} SymbolBlock;
+
+typedef struct {
+    unsigned *slot_hash;
+    int *slot_id;           /* SYMBOL_NONE for an empty slot */
+    size_t slot_count;      /* power of two, at most half full */
+    const char **names;
+    size_t *lengths;
+    size_t count;
+    size_t cap;
+    SymbolBlock *arena;
+    size_t arena_bytes;     /* bytes allocated for blocks */
+    size_t lookups;
+    size_t hits;
+} SymbolTable;
+
+static unsigned symbol_hash(const char *p, size_t n) {
+    unsigned long long h = 0x9e3779b97f4a7c15ull ^ n;
+    while (n >= 8) {
+        unsigned long long w;
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+        p += 8;
+        n -= 8;
+    }
+    unsigned long long w = 0;
+    memcpy(&w, p, n);
+    h = (h ^ w) * 0xff51afd7ed558ccdull;
+    h ^= h >> 29;
+    return (unsigned)h;
+}
+
+static const char *symbol_arena_copy(SymbolTable *tab, const char *p, size_t n) {
+    SymbolBlock *block = tab->arena;
+    if (!block || block->cap - block->used < n + 1) {
+        /* blocks double from 4 KiB up to SYMBOL_ARENA_BLOCK */
+        size_t cap = tab->arena_bytes < 4096 ? 4096 : tab->arena_bytes;
+        if (cap > SYMBOL_ARENA_BLOCK) cap = SYMBOL_ARENA_BLOCK;
+        if (cap < n + 1) cap = n + 1;
+        block = (SymbolBlock *)malloc(sizeof(SymbolBlock) + cap);
+        if (!block) {
+            fprintf(stderr, "out of memory\n");
+            exit(EXIT_FAILURE);
         }
+        block->next = tab->arena;
+        block->used = 0;
+        block->cap = cap;
+        tab->arena = block;
+        tab->arena_bytes += sizeof(SymbolBlock) + cap;
     }
-    return 0;
+    char *dst = block->data + block->used;
+    memcpy(dst, p, n);
+    dst[n] = '\0';
+    block->used += n + 1;
+    return dst;
 }
 
-static void print_token(const Token *tok) {
-    const char *kind_str = NULL;
-    switch (tok->kind) {
-        case TK_IDENTIFIER: kind_str = "IDENT"; break;
-        case TK_KEYWORD: kind_str = "KEYWORD"; break;
-        case TK_INT_LITERAL: kind_str = "INT"; break;
-        case TK_HEX_LITERAL: kind_str = "HEX"; break;
-        case TK_FLOAT_LITERAL: kind_str = "FLOAT"; break;
-        case TK_STRING_LITERAL: kind_str = "STRING"; break;
-        case TK_CHAR_LITERAL: kind_str = "CHAR"; break;
-        case TK_OPERATOR: kind_str = "OP"; break;
-        case TK_PUNCTUATION: kind_str = "PUNC"; break;
-        case TK_COMMENT: kind_str = "COMMENT"; break;
-        case TK_ERROR: kind_str = "ERROR"; break;
-        case TK_EOF: kind_str = "EOF"; break;
-        default: kind_str = "UNKNOWN"; break;
-    }
-    printf("(%s, \"%s\", line=%zu, col=%zu)\n", kind_str, tok->lexeme, tok->line, tok->column);
+static void symbol_table_grow(SymbolTable *tab) {
+    size_t count = tab->slot_count ? tab->slot_count * 2 : 1024;
+    unsigned *hashes = (unsigned *)malloc(count * sizeof(unsigned));
+    int *ids = (int *)malloc(count * sizeof(int));
+    if (!hashes || !ids) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < count; ++i) ids[i] = SYMBOL_NONE;
+    for (size_t i = 0; i < tab->slot_count; ++i) {
+        if (tab->slot_id[i] == SYMBOL_NONE) continue;
+        size_t j = tab->slot_hash[i] & (count - 1);
+        while (ids[j] != SYMBOL_NONE) j = (j + 1) & (count - 1);
+        hashes[j] = tab->slot_hash[i];
+        ids[j] = tab->slot_id[i];
+    }
+    free(tab->slot_hash);
+    free(tab->slot_id);
+    tab->slot_hash = hashes;
+    tab->slot_id = ids;
+    tab->slot_count = count;
 }
 
-typedef struct {
-    FILE *fp;
-    int current;
-    size_t line;
-    size_t column;
-    size_t last_line_column;
-} Scanner;
+/* Returns the id of the spelling p[0..n), adding it on first sight. */
+static int symbol_intern(SymbolTable *tab, const char *p, size_t n) {
+    unsigned h = symbol_hash(p, n);
+    size_t mask = tab->slot_count - 1;
+    size_t i = h & mask;
+    tab->lookups++;
+    while (tab->slot_id[i] != SYMBOL_NONE) {
+        int id = tab->slot_id[i];
+        if (tab->slot_hash[i] == h && tab->lengths[id] == n && memcmp(tab->names[id], p, n) == 0) {
+            tab->hits++;
+            return id;
+        }
+        i = (i + 1) & mask;
+    }
+    if (tab->count == tab->cap) {
+        size_t cap = tab->cap ? tab->cap * 2 : 1024;
+        const char **names = (const char **)realloc((void *)tab->names, cap * sizeof(*names));
+        size_t *lengths = names ? (size_t *)realloc(tab->lengths, cap * sizeof(*lengths)) : NULL;
+        if (names) tab->names = names;
+        if (!lengths) {
+            fprintf(stderr, "out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        tab->lengths = lengths;
+        tab->cap = cap;
+    }
+    int id = (int)tab->count++;
+    tab->names[id] = symbol_arena_copy(tab, p, n);
+    tab->lengths[id] = n;
+    tab->slot_hash[i] = h;
+    tab->slot_id[i] = id;
+    if (tab->count * 2 > tab->slot_count) {
+        symbol_table_grow(tab);
+    }
+    return id;
+}
 
-static void scanner_init(Scanner *s, FILE *fp) {
-    s->fp = fp;
-    s->current = fgetc(fp);
-    s->line = 1;
-    s->column = 1;
-    s->last_line_column = 1;
+/* Sets tok->symbol for names and literals; keywords are pre-interned. */
+static void symbol_assign(SymbolTable *tab, Token *tok) {
+    if (tok->kind == TK_KEYWORD) {
+        tab->lookups++;
+        tab->hits++;
+        tok->symbol = tok->keyword;
+    } else if (tok->kind <= TK_CHAR_LITERAL) {
+        tok->symbol = symbol_intern(tab, tok->lexeme, tok->length);
+    }
 }
 
-static void scanner_advance(Scanner *s) {
-    if (s->current == '\n') {
-        s->line++;
-        s->last_line_column = s->column;
-        s->column = 1;
-    } else {
-        s->column++;
+static void symbol_table_init(SymbolTable *tab) {
+    memset(tab, 0, sizeof(*tab));
+    symbol_table_grow(tab);
+    for (int k = 0; k < KW_COUNT; ++k) {
+        symbol_intern(tab, keywords[k], strlen(keywords[k]));
     }
-    s->current = fgetc(s->fp);
+    tab->lookups = tab->hits = 0;
 }
 
-static int scanner_peek(Scanner *s) {
-    return s->current;
+#ifdef LEXER_NO_MAIN
+static const char *symbol_name(const SymbolTable *tab, int id, size_t *length) {
+    *length = tab->lengths[id];
+    return tab->names[id];
 }
+#endif
 
-static Token make_simple_token(TokenKind kind, const char *lexeme, size_t line, size_t col) {
-    Token tok;
-    tok.kind = kind;
-    tok.line = line;
-    tok.column = col;
-    strncpy(tok.lexeme, lexeme, sizeof(tok.lexeme) - 1);
-    tok.lexeme[sizeof(tok.lexeme) - 1] = '\0';
-    return tok;
+static void symbol_table_free(SymbolTable *tab) {
+    while (tab->arena) {
+        SymbolBlock *next = tab->arena->next;
+        free(tab->arena);
+        tab->arena = next;
+    }
+    free(tab->slot_hash);
+    free(tab->slot_id);
+    free((void *)tab->names);
+    free(tab->lengths);
+    memset(tab, 0, sizeof(*tab));
 }
 
-static Token lex_error(const char *message, size_t line, size_t col) {
-    return make_simple_token(TK_ERROR, message, line, col);
+/* Growable output buffer.  With a sink it flushes itself once it holds
+ * OUTBUF_FLUSH bytes; without one it keeps everything (parallel jobs). */
+#define OUTBUF_FLUSH (1u << 16)
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    FILE *sink;
+    size_t prev_offset;     /* previous token, for binary delta coding */
+    size_t prev_line;
+    size_t prev_column;
+} OutBuf;
+
+static void outbuf_init(OutBuf *out, FILE *sink) {
+    memset(out, 0, sizeof(*out));
+    out->sink = sink;
 }
 
-static Token scan_string_literal(Scanner *s, size_t start_line, size_t start_col) {
-    char buffer[256];
-    size_t idx = 0;
-    scanner_advance(s);
-    while (scanner_peek(s) != EOF && scanner_peek(s) != '"' && idx < sizeof(buffer) - 1) {
-        if (scanner_peek(s) == '\\') {
-            buffer[idx++] = (char)scanner_peek(s);
-            scanner_advance(s);
-            if (scanner_peek(s) == EOF) break;
+static void outbuf_flush(OutBuf *out) {
+    if (out->sink && out->len) {
+        fwrite(out->data, 1, out->len, out->sink);
+        out->len = 0;
+    }
+}
+
+static char *outbuf_reserve(OutBuf *out, size_t extra) {
+    if (out->len + extra > out->cap) {
+        size_t cap = out->cap ? out->cap : 4096;
+        while (cap < out->len + extra) cap *= 2;
+        char *grown = (char *)realloc(out->data, cap);
+        if (!grown) {
+            fprintf(stderr, "out of memory\n");
+            exit(EXIT_FAILURE);
         }
-        buffer[idx++] = (char)scanner_peek(s);
-        scanner_advance(s);
+        out->data = grown;
+        out->cap = cap;
     }
-    if (scanner_peek(s) != '"') {
-        return lex_error("Unterminated string literal", start_line, start_col);
+    return out->data + out->len;
+}
+
+static void outbuf_printf(OutBuf *out, size_t max_len, const char *fmt, ...) {
+    va_list ap;
+    char *dst = outbuf_reserve(out, max_len + 1);
+    va_start(ap, fmt);
+    int n = vsnprintf(dst, max_len + 1, fmt, ap);
+    va_end(ap);
+    if (n > 0) out->len += (size_t)n < max_len ? (size_t)n : max_len;
+    if (out->sink && out->len >= OUTBUF_FLUSH) outbuf_flush(out);
+}
+
+static void outbuf_write(OutBuf *out, const char *data, size_t n) {
+    if (out->sink && n >= OUTBUF_FLUSH) {
+        /* a long lexeme goes straight out instead of through the buffer */
+        outbuf_flush(out);
+        fwrite(data, 1, n, out->sink);
+        return;
     }
-    scanner_advance(s);
-    buffer[idx] = '\0';
-    return make_simple_token(TK_STRING_LITERAL, buffer, start_line, start_col);
+    memcpy(outbuf_reserve(out, n), data, n);
+    out->len += n;
+    if (out->sink && out->len >= OUTBUF_FLUSH) outbuf_flush(out);
 }
 
-static Token scan_char_literal(Scanner *s, size_t start_line, size_t start_col) {
-    char buffer[256];
-    size_t idx = 0;
-    scanner_advance(s);
-    while (scanner_peek(s) != EOF && scanner_peek(s) != '\'' && idx < sizeof(buffer) - 1) {
-        if (scanner_peek(s) == '\\') {
-            buffer[idx++] = (char)scanner_peek(s);
-            scanner_advance(s);
-            if (scanner_peek(s) == EOF) break;
-        }
-        buffer[idx++] = (char)scanner_peek(s);
-        scanner_advance(s);
+#ifndef LEXER_NO_MAIN
+static void outbuf_free(OutBuf *out) {
+    outbuf_flush(out);
+    free(out->data);
+    out->data = NULL;
+    out->len = out->cap = 0;
+}
+
+static const char *token_kind_name(TokenKind kind) {
+    switch (kind) {
+        case TK_IDENTIFIER: return "IDENT";
+        case TK_KEYWORD: return "KEYWORD";
+        case TK_INT_LITERAL: return "INT";
+        case TK_HEX_LITERAL: return "HEX";
+        case TK_FLOAT_LITERAL: return "FLOAT";
+        case TK_STRING_LITERAL: return "STRING";
+        case TK_CHAR_LITERAL: return "CHAR";
+        case TK_OPERATOR: return "OP";
+        case TK_PUNCTUATION: return "PUNC";
+        case TK_COMMENT: return "COMMENT";
+        case TK_ERROR: return "ERROR";
+        case TK_EOF: return "EOF";
+        default: return "UNKNOWN";
     }
-    if (scanner_peek(s) != '\'') {
-        return lex_error("Unterminated char literal", start_line, start_col);
+}
+
+static void outbuf_put_uint(OutBuf *out, size_t value) {
+    char digits[24];
+    size_t n = sizeof(digits);
+    do {
+        digits[--n] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    outbuf_write(out, digits + n, sizeof(digits) - n);
+}
+
+static void outbuf_put_varint(OutBuf *out, unsigned long long value) {
+    unsigned char *dst = (unsigned char *)outbuf_reserve(out, 10);
+    size_t n = 0;
+    while (value >= 0x80) {
+        dst[n++] = (unsigned char)(value | 0x80);
+        value >>= 7;
     }
-    scanner_advance(s);
-    buffer[idx] = '\0';
-    return make_simple_token(TK_CHAR_LITERAL, buffer, start_line, start_col);
+    dst[n++] = (unsigned char)value;
+    out->len += n;
 }
 
-static Token scan_identifier_or_keyword(Scanner *s, size_t start_line, size_t start_col) {
-    char buffer[256];
-    size_t idx = 0;
-    while (scanner_peek(s) != EOF &&
-           (isalnum(scanner_peek(s)) || scanner_peek(s) == '_') &&
-           idx < sizeof(buffer) - 1) {
-        buffer[idx++] = (char)scanner_peek(s);
-        scanner_advance(s);
+/* Signed difference a - b folded so that small magnitudes stay small. */
+static unsigned long long zigzag_delta(size_t a, size_t b) {
+    return a >= b ? (unsigned long long)(a - b) << 1 : ((unsigned long long)(b - a) << 1) - 1;
+}
+
+static size_t unzigzag_delta(size_t base, unsigned long long v) {
+    return v & 1 ? base - (size_t)((v + 1) >> 1) : base + (size_t)(v >> 1);
+}
+
+/* Output formats: the original text lines, a compact binary token stream,
+ * or one JSON object per line. */
+typedef enum {
+    LEX_FORMAT_TEXT, LEX_FORMAT_BINARY, LEX_FORMAT_NDJSON
+} LexFormat;
+
+static LexFormat lex_format = LEX_FORMAT_TEXT;
+
+/* Binary token stream.  The stream starts with "CTOK", a version byte and a
+ * flags byte (bit 0: several inputs).  Then a sequence of records:
+ *   0xFE  varint n, n bytes      start of an input file (resets the deltas)
+ *   0xFD  varint offset, line, column   absolute position of the previous token
+ *   kind  token record:
+ *           [keyword id byte, for TK_KEYWORD]
+ *           varint zigzag(offset delta), varint zigzag(line delta),
+ *           varint column (zigzag column delta when the line is unchanged)
+ *           [varint length, length bytes, for everything but keywords]
+ * All deltas are taken from the previous token of the same file. */
+#define TOKSTREAM_MAGIC "CTOK"
+#define TOKSTREAM_VERSION 1
+#define TOKSTREAM_MULTI 0x01
+#define TOKSTREAM_FILE 0xFE
+#define TOKSTREAM_ANCHOR 0xFD
+
+static void print_stream_header(FILE *fp, int multi) {
+    unsigned char header[6] = {'C', 'T', 'O', 'K', TOKSTREAM_VERSION, 0};
+    header[5] = multi ? TOKSTREAM_MULTI : 0;
+    fwrite(header, 1, sizeof(header), fp);
+}
+
+static void print_token_binary(OutBuf *out, const Token *tok) {
+    unsigned char *dst = (unsigned char *)outbuf_reserve(out, 2);
+    dst[0] = (unsigned char)tok->kind;
+    out->len++;
+    if (tok->kind == TK_KEYWORD) {
+        dst[1] = (unsigned char)tok->keyword;
+        out->len++;
     }
-    buffer[idx] = '\0';
-    if (is_keyword(buffer)) {
-        return make_simple_token(TK_KEYWORD, buffer, start_line, start_col);
+    outbuf_put_varint(out, zigzag_delta(tok->offset, out->prev_offset));
+    outbuf_put_varint(out, zigzag_delta(tok->line, out->prev_line));
+    outbuf_put_varint(out, tok->line == out->prev_line ? zigzag_delta(tok->column, out->prev_column)
+                                                        : (unsigned long long)tok->column);
+    if (tok->kind != TK_KEYWORD) {
+        outbuf_put_varint(out, tok->length);
+        outbuf_write(out, tok->lexeme, tok->length);
+    } else if (out->sink && out->len >= OUTBUF_FLUSH) {
+        outbuf_flush(out);
     }
-    return make_simple_token(TK_IDENTIFIER, buffer, start_line, start_col);
+    out->prev_offset = tok->offset;
+    out->prev_line = tok->line;
+    out->prev_column = tok->column;
 }
 
-static int is_hex_digit(int ch) {
-    return isdigit(ch) || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F');
+static void print_stream_anchor(OutBuf *out, size_t offset, size_t line, size_t column) {
+    *outbuf_reserve(out, 1) = (char)TOKSTREAM_ANCHOR;
+    out->len++;
+    outbuf_put_varint(out, offset);
+    outbuf_put_varint(out, line);
+    outbuf_put_varint(out, column);
+    out->prev_offset = offset;
+    out->prev_line = line;
+    out->prev_column = column;
 }
 
-static Token scan_number(Scanner *s, size_t start_line, size_t start_col) {
-    char buffer[256];
-    size_t idx = 0;
-    int ch = scanner_peek(s);
-    int is_hex = 0;
-    int saw_dot = 0;
-    int saw_exp = 0;
-    if (ch == '0') {
-        buffer[idx++] = (char)ch;
-        scanner_advance(s);
-        if (scanner_peek(s) == 'x' || scanner_peek(s) == 'X') {
-            buffer[idx++] = (char)scanner_peek(s);
-            scanner_advance(s);
-            is_hex = 1;
-            while (is_hex_digit(scanner_peek(s)) && idx < sizeof(buffer) - 1) {
-                buffer[idx++] = (char)scanner_peek(s);
-                scanner_advance(s);
-            }
-            buffer[idx] = '\0';
-            return make_simple_token(TK_HEX_LITERAL, buffer, start_line, start_col);
-        }
+/* %.17g round-trips every double. */
+static void print_token_value(OutBuf *out, const Token *tok) {
+    if (tok->kind == TK_FLOAT_LITERAL) {
+        outbuf_printf(out, 32, "%.17g", tok->value.d);
+    } else {
+        outbuf_printf(out, 24, "%llu", tok->value.u);
     }
-    while (isdigit(scanner_peek(s)) && idx < sizeof(buffer) - 1) {
-        buffer[idx++] = (char)scanner_peek(s);
-        scanner_advance(s);
+}
+
+/* Same bytes as printf("(%s, \"%.*s\", line=%zu, col=%zu)\n"), which stops
+ * the lexeme at an embedded NUL. */
+static void print_token_text(OutBuf *out, const Token *tok) {
+    const char *name = token_kind_name(tok->kind);
+    const char *nul = (const char *)memchr(tok->lexeme, '\0', tok->length);
+    size_t length = nul ? (size_t)(nul - tok->lexeme) : tok->length;
+    outbuf_write(out, "(", 1);
+    outbuf_write(out, name, strlen(name));
+    outbuf_write(out, ", \"", 3);
+    outbuf_write(out, tok->lexeme, length);
+    outbuf_write(out, "\", line=", 8);
+    outbuf_put_uint(out, tok->line);
+    outbuf_write(out, ", col=", 6);
+    outbuf_put_uint(out, tok->column);
+    if (tok->value_status == TV_OK) {
+        outbuf_write(out, ", value=", 8);
+        print_token_value(out, tok);
     }
-    if (scanner_peek(s) == '.' && idx < sizeof(buffer) - 1) {
-        saw_dot = 1;
-        buffer[idx++] = '.';
-        scanner_advance(s);
-        while (isdigit(scanner_peek(s)) && idx < sizeof(buffer) - 1) {
-            buffer[idx++] = (char)scanner_peek(s);
-            scanner_advance(s);
+    outbuf_write(out, ")\n", 2);
+}
+
+/* JSON string body: quote, backslash and control bytes escaped, other bytes
+ * copied as they are. */
+static void outbuf_put_json(OutBuf *out, const char *text, size_t n) {
+    static const char hex[] = "0123456789abcdef";
+    size_t run = 0;
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char c = (unsigned char)text[i];
+        if (c >= 0x20 && c != '"' && c != '\\' && c != 0x7f) continue;
+        outbuf_write(out, text + run, i - run);
+        run = i + 1;
+        char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+        switch (c) {
+            case '"': outbuf_write(out, "\\\"", 2); break;
+            case '\\': outbuf_write(out, "\\\\", 2); break;
+            case '\n': outbuf_write(out, "\\n", 2); break;
+            case '\t': outbuf_write(out, "\\t", 2); break;
+            case '\r': outbuf_write(out, "\\r", 2); break;
+            default: outbuf_write(out, esc, sizeof(esc)); break;
         }
     }
-    if ((scanner_peek(s) == 'e' || scanner_peek(s) == 'E') && idx < sizeof(buffer) - 1) {
-        saw_exp = 1;
-        buffer[idx++] = (char)scanner_peek(s);
-        scanner_advance(s);
-        if ((scanner_peek(s) == '+' || scanner_peek(s) == '-') && idx < sizeof(buffer) - 1) {
-            buffer[idx++] = (char)scanner_peek(s);
-            scanner_advance(s);
-        }
-        while (isdigit(scanner_peek(s)) && idx < sizeof(buffer) - 1) {
-            buffer[idx++] = (char)scanner_peek(s);
-            scanner_advance(s);
-        }
+    outbuf_write(out, text + run, n - run);
+}
+
+static void print_token_ndjson(OutBuf *out, const Token *tok) {
+    const char *name = token_kind_name(tok->kind);
+    outbuf_write(out, "{\"kind\":\"", 9);
+    outbuf_write(out, name, strlen(name));
+    outbuf_write(out, "\",\"text\":\"", 10);
+    outbuf_put_json(out, tok->lexeme, tok->length);
+    outbuf_write(out, "\",\"line\":", 9);
+    outbuf_put_uint(out, tok->line);
+    outbuf_write(out, ",\"col\":", 7);
+    outbuf_put_uint(out, tok->column);
+    outbuf_write(out, ",\"offset\":", 10);
+    outbuf_put_uint(out, tok->offset);
+    if (tok->value_status == TV_OK) {
+        outbuf_write(out, ",\"value\":", 9);
+        print_token_value(out, tok);
     }
-    buffer[idx] = '\0';
-    if (saw_dot || saw_exp) {
-        return make_simple_token(TK_FLOAT_LITERAL, buffer, start_line, start_col);
+    outbuf_write(out, "}\n", 2);
+}
+
+static void print_token(OutBuf *out, const Token *tok) {
+    switch (lex_format) {
+        case LEX_FORMAT_BINARY: print_token_binary(out, tok); break;
+        case LEX_FORMAT_NDJSON: print_token_ndjson(out, tok); break;
+        default: print_token_text(out, tok); break;
     }
-    return make_simple_token(TK_INT_LITERAL, buffer, start_line, start_col);
 }
 
-static Token scan_comment_or_operator(Scanner *s, size_t start_line, size_t start_col) {
-    int ch = scanner_peek(s);
-    scanner_advance(s);
-    if (ch == '/') {
-        if (scanner_peek(s) == '/') {
-            scanner_advance(s);
-            char buffer[256];
-            size_t idx = 0;
-            while (scanner_peek(s) != EOF && scanner_peek(s) != '\n' && idx < sizeof(buffer) - 1) {
-                buffer[idx++] = (char)scanner_peek(s);
-                scanner_advance(s);
+/* Marks the start of one input in the output: the "==> path <==" banner
+ * when there are several inputs in text mode, a file record otherwise. */
+static void print_input_header(FILE *fp, const char *path, int multi) {
+    OutBuf out;
+    outbuf_init(&out, fp);
+    if (lex_format == LEX_FORMAT_BINARY) {
+        *outbuf_reserve(&out, 1) = (char)TOKSTREAM_FILE;
+        out.len++;
+        outbuf_put_varint(&out, strlen(path));
+        outbuf_write(&out, path, strlen(path));
+    } else if (lex_format == LEX_FORMAT_NDJSON) {
+        outbuf_write(&out, "{\"file\":\"", 9);
+        outbuf_put_json(&out, path, strlen(path));
+        outbuf_write(&out, "\"}\n", 3);
+    } else if (multi) {
+        outbuf_write(&out, "==> ", 4);
+        outbuf_write(&out, path, strlen(path));
+        outbuf_write(&out, " <==\n", 5);
+    }
+    outbuf_free(&out);
+}
+
+/* Reader for the binary token stream.  Lexemes point into the stream (or at
+ * keywords[] for keyword records), so the stream must outlive the tokens. */
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+    int multi;
+    const char *path;       /* current input, not NUL-terminated */
+    size_t path_len;
+    size_t offset;
+    size_t line;
+    size_t column;
+} TokenReader;
+
+typedef enum {
+    TOKSTREAM_END, TOKSTREAM_TOKEN, TOKSTREAM_NEW_FILE, TOKSTREAM_CORRUPT
+} TokenReadResult;
+
+/* Returns -1 when data does not start with a stream header. */
+static int token_reader_init(TokenReader *r, const void *data, size_t len) {
+    memset(r, 0, sizeof(*r));
+    r->p = (const unsigned char *)data;
+    r->end = r->p + len;
+    if (len < 6 || memcmp(data, TOKSTREAM_MAGIC, 4) != 0 || r->p[4] != TOKSTREAM_VERSION) {
+        return -1;
+    }
+    r->multi = (r->p[5] & TOKSTREAM_MULTI) != 0;
+    r->p += 6;
+    return 0;
+}
+
+static int token_reader_varint(TokenReader *r, unsigned long long *value) {
+    unsigned long long v = 0;
+    for (int shift = 0; shift < 64 && r->p < r->end; shift += 7) {
+        unsigned char b = *r->p++;
+        v |= (unsigned long long)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *value = v;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static TokenReadResult token_reader_next(TokenReader *r, Token *tok) {
+    unsigned long long a, b, c;
+    for (;;) {
+        if (r->p >= r->end) {
+            return TOKSTREAM_END;
+        }
+        unsigned char tag = *r->p++;
+        if (tag == TOKSTREAM_FILE) {
+            if (token_reader_varint(r, &a) != 0 || a > (unsigned long long)(r->end - r->p)) {
+                return TOKSTREAM_CORRUPT;
             }
-            buffer[idx] = '\0';
-            return make_simple_token(TK_COMMENT, buffer, start_line, start_col);
-        } else if (scanner_peek(s) == '*') {
-            scanner_advance(s);
-            char buffer[256];
-            size_t idx = 0;
-            int terminated = 0;
-            while (scanner_peek(s) != EOF && idx < sizeof(buffer) - 2) {
-                if (scanner_peek(s) == '*') {
-                    scanner_advance(s);
-                    if (scanner_peek(s) == '/') {
-                        scanner_advance(s);
-                        terminated = 1;
-                        break;
-                    }
-                    buffer[idx++] = '*';
-                    continue;
-                }
-                buffer[idx++] = (char)scanner_peek(s);
-                scanner_advance(s);
+            r->path = (const char *)r->p;
+            r->path_len = (size_t)a;
+            r->p += a;
+            r->offset = r->line = r->column = 0;
+            return TOKSTREAM_NEW_FILE;
+        }
+        if (tag == TOKSTREAM_ANCHOR) {
+            if (token_reader_varint(r, &a) != 0 || token_reader_varint(r, &b) != 0 ||
+                token_reader_varint(r, &c) != 0) {
+                return TOKSTREAM_CORRUPT;
             }
-            buffer[idx] = '\0';
-            if (!terminated) {
-                return lex_error("Unterminated block comment", start_line, start_col);
+            r->offset = (size_t)a;
+            r->line = (size_t)b;
+            r->column = (size_t)c;
+            continue;
+        }
+        if (tag > TK_EOF) {
+            return TOKSTREAM_CORRUPT;
+        }
+        tok->kind = (TokenKind)tag;
+        tok->keyword = KW_NONE;
+        tok->symbol = SYMBOL_NONE;
+        tok->value_status = TV_NONE;
+        tok->value.u = 0;
+        if (tag == TK_KEYWORD) {
+            if (r->p >= r->end || *r->p >= KW_COUNT) {
+                return TOKSTREAM_CORRUPT;
             }
-            return make_simple_token(TK_COMMENT, buffer, start_line, start_col);
+            tok->keyword = *r->p++;
         }
-        return make_simple_token(TK_OPERATOR, "/", start_line, start_col);
-    }
-    char lexeme[3] = {(char)ch, '\0', '\0'};
-    if ((ch == '+' || ch == '-' || ch == '=' || ch == '!' || ch == '<' || ch == '>') &&
-        (scanner_peek(s) == '=' || (ch == '+' && scanner_peek(s) == '+') ||
-         (ch == '-' && scanner_peek(s) == '-'))) {
-        lexeme[1] = (char)scanner_peek(s);
-        lexeme[2] = '\0';
-        scanner_advance(s);
+        if (token_reader_varint(r, &a) != 0 || token_reader_varint(r, &b) != 0 ||
+            token_reader_varint(r, &c) != 0) {
+            return TOKSTREAM_CORRUPT;
+        }
+        size_t line = unzigzag_delta(r->line, b);
+        r->column = line == r->line ? unzigzag_delta(r->column, c) : (size_t)c;
+        r->offset = unzigzag_delta(r->offset, a);
+        r->line = line;
+        if (tag == TK_KEYWORD) {
+            tok->lexeme = keywords[tok->keyword];
+            tok->length = strlen(tok->lexeme);
+        } else {
+            if (token_reader_varint(r, &a) != 0 || a > (unsigned long long)(r->end - r->p)) {
+                return TOKSTREAM_CORRUPT;
+            }
+            tok->lexeme = (const char *)r->p;
+            tok->length = (size_t)a;
+            r->p += a;
+        }
+        tok->offset = r->offset;
+        tok->line = r->line;
+        tok->column = r->column;
+        return TOKSTREAM_TOKEN;
     }
-    return make_simple_token(TK_OPERATOR, lexeme, start_line, start_col);
 }
+#endif
 
-static Token scanner_next_token(Scanner *s) {
-    while (isspace(scanner_peek(s))) {
-        scanner_advance(s);
+static double lex_now(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+#ifndef LEXER_NO_MAIN
+/* Whole-file input, mapped read-only.  Inputs the OS will not map are
+ * streamed instead (LexStream). */
+typedef struct {
+    const char *data;
+    size_t size;
+    int fd;                 /* POSIX streams: the descriptor, left open for LexStream */
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} SourceBuffer;
+
+/* Returns 0 when src holds the file contents, 1 when path must be read as a
+ * stream ("-" for stdin, a pipe, FIFO or device, or a file that cannot be
+ * mapped), -1 on error. */
+static int source_open(SourceBuffer *src, const char *path) {
+    memset(src, 0, sizeof(*src));
+    src->data = "";
+    src->fd = -1;
+    if (strcmp(path, "-") == 0) {
+        return 1;
     }
-    if (scanner_peek(s) == EOF) {
-        return make_simple_token(TK_EOF, "EOF", s->line, s->column);
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return -1;
     }
-    size_t start_line = s->line;
-    size_t start_col = s->column;
-    int ch = scanner_peek(s);
-    if (isalpha(ch) || ch == '_') {
-        return scan_identifier_or_keyword(s, start_line, start_col);
+    if (GetFileType(file) != FILE_TYPE_DISK) {
+        CloseHandle(file);
+        return 1;
     }
-    if (isdigit(ch)) {
-        return scan_number(s, start_line, start_col);
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return -1;
     }
-    if (ch == '"') {
-        return scan_string_literal(s, start_line, start_col);
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return 0;
     }
-    if (ch == '\'') {
-        return scan_char_literal(s, start_line, start_col);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const char *view = mapping ? (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return 1;
     }
-    if (ch == '/' || ch == '+' || ch == '-' || ch == '*' || ch == '%' ||
-        ch == '=' || ch == '!' || ch == '<' || ch == '>') {
-        return scan_comment_or_operator(s, start_line, start_col);
+    src->file = file;
+    src->mapping = mapping;
+    src->data = view;
+    src->size = (size_t)size.QuadPart;
+    return 0;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
     }
-    if (strchr("(){}[];,.:?&|^~#", ch)) {
-        char lexeme[2] = {(char)ch, '\0'};
-        scanner_advance(s);
-        return make_simple_token(TK_PUNCTUATION, lexeme, start_line, start_col);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
     }
-    if (ch == '@' || ch == '$' || ch == '`') {
-        char bad[2] = {(char)ch, '\0'};
-        scanner_advance(s);
-        return make_simple_token(TK_ERROR, bad, start_line, start_col);
+    if (!S_ISREG(st.st_mode)) {
+        /* reopening a FIFO would lose what its writer already sent */
+        src->fd = fd;
+        return 1;
     }
-    char unknown[2] = {(char)ch, '\0'};
-    scanner_advance(s);
-    return make_simple_token(TK_ERROR, unknown, start_line, start_col);
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    size_t size = (size_t)st.st_size;
+    void *view = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        src->fd = fd;
+        return 1;
+    }
+    close(fd);
+    madvise(view, size, MADV_SEQUENTIAL);
+    src->data = (const char *)view;
+    src->size = size;
+    return 0;
+#endif
 }
 
-int main(int argc, char **argv) {
-    if (argc != 2) {
-        fprintf(stderr, "usage: %s <source-file>\n", argv[0]);
-        return EXIT_FAILURE;
+static void source_close(SourceBuffer *src) {
+#ifndef _WIN32
+    if (src->fd >= 0) {
+        close(src->fd);
+        src->fd = -1;
     }
+#endif
+    if (src->size == 0) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(src->data);
+    CloseHandle(src->mapping);
+    CloseHandle(src->file);
+#else
+    munmap((void *)src->data, src->size);
+#endif
+    src->data = "";
+    src->size = 0;
+}
+#endif
 
-    FILE *fp = fopen(argv[1], "r");
-    if (!fp) {
-        perror("fopen");
-        return EXIT_FAILURE;
+/* Bulk classification kernels for buffer-mode scanning.  Each returns an
+ * index into p[0..n): the end of a whitespace or identifier run, or the start
+ * of the first a-b byte pair (find_pair, e.g. the end of a block comment),
+ * or the first byte equal to a or b (find_either); n when absent.
+ * count_newlines also reports the index of the last '\n' it saw;
+ * index_newlines stores base + i for every '\n' at p[i] and returns how many
+ * it stored, so out must have room for count_newlines of the same range.
+ * The SIMD versions test the ASCII sets that isspace/isalnum use in the "C"
+ * locale, which the lexer never leaves.  Most runs are short, so the AVX2
+ * versions probe the first 16 bytes with SSE2 before switching to 32-byte
+ * blocks.  Line comments use memchr, which libc already vectorizes. */
+typedef struct {
+    const char *name;
+    size_t (*skip_space)(const unsigned char *p, size_t n);
+    size_t (*skip_ident)(const unsigned char *p, size_t n);
+    size_t (*find_pair)(const unsigned char *p, size_t n, unsigned char a, unsigned char b);
+    size_t (*find_either)(const unsigned char *p, size_t n, unsigned char a, unsigned char b);
+    size_t (*count_newlines)(const unsigned char *p, size_t n, size_t *last);
+    size_t (*index_newlines)(const unsigned char *p, size_t n, size_t base, size_t *out);
+} LexKernels;
+
+static size_t skip_space_scalar(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    while (i < n && isspace(p[i])) i++;
+    return i;
+}
+
+static size_t skip_ident_scalar(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    while (i < n && (isalnum(p[i]) || p[i] == '_')) i++;
+    return i;
+}
+
+static size_t find_pair_scalar(const unsigned char *p, size_t n, unsigned char a, unsigned char b) {
+    for (size_t i = 0; i + 1 < n; ++i) {
+        if (p[i] == a && p[i + 1] == b) return i;
     }
+    return n;
+}
 
-    Scanner scanner;
-    scanner_init(&scanner, fp);
-    for (;;) {
-        Token tok = scanner_next_token(&scanner);
-        print_token(&tok);
-        if (tok.kind == TK_EOF) {
-            break;
-        }
-        if (tok.kind == TK_ERROR) {
-            fprintf(stderr, "Lexical error at line %zu col %zu: %s\n",
-                    tok.line, tok.column, tok.lexeme);
+static size_t find_either_scalar(const unsigned char *p, size_t n, unsigned char a, unsigned char b) {
+    size_t i = 0;
+    while (i < n && p[i] != a && p[i] != b) i++;
+    return i;
+}
+
+static size_t count_newlines_scalar(const unsigned char *p, size_t n, size_t *last) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (p[i] == '\n') {
+            count++;
+            *last = i;
         }
     }
+    return count;
+}
 
-    fclose(fp);
-    return EXIT_SUCCESS;
+static size_t index_newlines_scalar(const unsigned char *p, size_t n, size_t base, size_t *out) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (p[i] == '\n') out[count++] = base + i;
+    }
+    return count;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LEX_X86_KERNELS 1
+#include <immintrin.h>
+
+/* Unsigned v <= limit, per byte. */
+#define SSE2_LE_U8(v, limit) _mm_cmpeq_epi8(_mm_min_epu8((v), (limit)), (v))
+#define AVX2_LE_U8(v, limit) _mm256_cmpeq_epi8(_mm256_min_epu8((v), (limit)), (v))
+
+__attribute__((target("sse2")))
+static unsigned sse2_space_mask(__m128i v) {
+    __m128i ctrl = SSE2_LE_U8(_mm_sub_epi8(v, _mm_set1_epi8(9)), _mm_set1_epi8(4));
+    __m128i blank = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    return (unsigned)_mm_movemask_epi8(_mm_or_si128(ctrl, blank));
 }
 
+__attribute__((target("sse2")))
+static unsigned sse2_ident_mask(__m128i v) {
+    __m128i digit = SSE2_LE_U8(_mm_sub_epi8(v, _mm_set1_epi8('0')), _mm_set1_epi8(9));
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i alpha = SSE2_LE_U8(_mm_sub_epi8(lower, _mm_set1_epi8('a')), _mm_set1_epi8(25));
+    __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(digit, alpha), under));
+}
+
+__attribute__((target("sse2")))
+static size_t skip_space_sse2(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        unsigned miss = ~sse2_space_mask(_mm_loadu_si128((const __m128i *)(p + i))) & 0xffffu;
+        if (miss) return i + (size_t)__builtin_ctz(miss);
+    }
+    return i + skip_space_scalar(p + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static size_t skip_ident_sse2(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        unsigned miss = ~sse2_ident_mask(_mm_loadu_si128((const __m128i *)(p + i))) & 0xffffu;
+        if (miss) return i + (size_t)__builtin_ctz(miss);
+    }
+    return i + skip_ident_scalar(p + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static size_t find_pair_sse2(const unsigned char *p, size_t n, unsigned char a, unsigned char b) {
+    size_t i = 0;
+    const __m128i va = _mm_set1_epi8((char)a);
+    const __m128i vb = _mm_set1_epi8((char)b);
+    for (; i + 17 <= n; i += 16) {
+        __m128i first = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)), va);
+        __m128i second = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i + 1)), vb);
+        unsigned hit = (unsigned)_mm_movemask_epi8(_mm_and_si128(first, second));
+        if (hit) return i + (size_t)__builtin_ctz(hit);
+    }
+    return i + find_pair_scalar(p + i, n - i, a, b);
+}
+
+__attribute__((target("sse2")))
+static size_t find_either_sse2(const unsigned char *p, size_t n, unsigned char a, unsigned char b) {
+    size_t i = 0;
+    const __m128i va = _mm_set1_epi8((char)a);
+    const __m128i vb = _mm_set1_epi8((char)b);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        unsigned hit = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+        if (hit) return i + (size_t)__builtin_ctz(hit);
+    }
+    return i + find_either_scalar(p + i, n - i, a, b);
+}
+
+__attribute__((target("sse2")))
+static size_t count_newlines_sse2(const unsigned char *p, size_t n, size_t *last) {
+    size_t i = 0;
+    size_t count = 0;
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; i + 16 <= n; i += 16) {
+        unsigned hit = (unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)), nl));
+        if (hit) {
+            count += (size_t)__builtin_popcount(hit);
+            *last = i + 31 - (size_t)__builtin_clz(hit);
+        }
+    }
+    size_t tail_last = 0;
+    size_t tail = count_newlines_scalar(p + i, n - i, &tail_last);
+    if (tail) *last = i + tail_last;
+    return count + tail;
+}
+
+__attribute__((target("sse2")))
+static size_t index_newlines_sse2(const unsigned char *p, size_t n, size_t base, size_t *out) {
+    size_t i = 0;
+    size_t count = 0;
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; i + 16 <= n; i += 16) {
+        unsigned hit = (unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)), nl));
+        while (hit) {
+            out[count++] = base + i + (size_t)__builtin_ctz(hit);
+            hit &= hit - 1;
+        }
+    }
+    return count + index_newlines_scalar(p + i, n - i, base + i, out + count);
+}
+
+__attribute__((target("avx2")))
+static unsigned avx2_space_mask(__m256i v) {
+    __m256i ctrl = AVX2_LE_U8(_mm256_sub_epi8(v, _mm256_set1_epi8(9)), _mm256_set1_epi8(4));
+    __m256i blank = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+    return (unsigned)_mm256_movemask_epi8(_mm256_or_si256(ctrl, blank));
+}
+
+__attribute__((target("avx2")))
+static unsigned avx2_ident_mask(__m256i v) {
+    __m256i digit = AVX2_LE_U8(_mm256_sub_epi8(v, _mm256_set1_epi8('0')), _mm256_set1_epi8(9));
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i alpha = AVX2_LE_U8(_mm256_sub_epi8(lower, _mm256_set1_epi8('a')), _mm256_set1_epi8(25));
+    __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(digit, alpha), under));
+}
+
+__attribute__((target("avx2")))
+static size_t skip_space_avx2(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    if (n >= 16) {
+        unsigned miss = ~sse2_space_mask(_mm_loadu_si128((const __m128i *)p)) & 0xffffu;
+        if (miss) return (size_t)__builtin_ctz(miss);
+        i = 16;
+    }
+    for (; i + 32 <= n; i += 32) {
+        unsigned miss = ~avx2_space_mask(_mm256_loadu_si256((const __m256i *)(p + i)));
+        if (miss) return i + (size_t)__builtin_ctz(miss);
+    }
+    return i + skip_space_sse2(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t skip_ident_avx2(const unsigned char *p, size_t n) {
+    size_t i = 0;
+    if (n >= 16) {
+        unsigned miss = ~sse2_ident_mask(_mm_loadu_si128((const __m128i *)p)) & 0xffffu;
+        if (miss) return (size_t)__builtin_ctz(miss);
+        i = 16;
+    }
+    for (; i + 32 <= n; i += 32) {
+        unsigned miss = ~avx2_ident_mask(_mm256_loadu_si256((const __m256i *)(p + i)));
+        if (miss) return i + (size_t)__builtin_ctz(miss);
+    }
+    return i + skip_ident_sse2(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t find_pair_avx2(const unsigned char *p, size_t n, unsigned char a, unsigned char b) {
+    size_t i = 0;
+    const __m256i va = _mm256_set1_epi8((char)a);
+    const __m256i vb = _mm256_set1_epi8((char)b);
+    for (; i + 33 <= n; i += 32) {
+        __m256i first = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + i)), va);
+        __m256i second = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + i + 1)), vb);
+        unsigned hit = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(first, second));
+        if (hit) return i + (size_t)__builtin_ctz(hit);
+    }
+    return i + find_pair_sse2(p + i, n - i, a, b);
+}
+
+__attribute__((target("avx2")))
+static size_t find_either_avx2(const unsigned char *p, size_t n, unsigned char a, unsigned char b) {
+    size_t i = 0;
+    const __m256i va = _mm256_set1_epi8((char)a);
+    const __m256i vb = _mm256_set1_epi8((char)b);
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        unsigned hit = (unsigned)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+        if (hit) return i + (size_t)__builtin_ctz(hit);
+    }
+    return i + find_either_sse2(p + i, n - i, a, b);
+}
+
+__attribute__((target("avx2")))
+static size_t count_newlines_avx2(const unsigned char *p, size_t n, size_t *last) {
+    size_t i = 0;
+    size_t count = 0;
+    const __m256i nl = _mm256_set1_epi8('\n');
+    for (; i + 32 <= n; i += 32) {
+        unsigned hit = (unsigned)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + i)), nl));
+        if (hit) {
+            count += (size_t)__builtin_popcount(hit);
+            *last = i + 31 - (size_t)__builtin_clz(hit);
+        }
+    }
+    size_t tail_last = 0;
+    size_t tail = count_newlines_sse2(p + i, n - i, &tail_last);
+    if (tail) *last = i + tail_last;
+    return count + tail;
+}
+
+__attribute__((target("avx2")))
+static size_t index_newlines_avx2(const unsigned char *p, size_t n, size_t base, size_t *out) {
+    size_t i = 0;
+    size_t count = 0;
+    const __m256i nl = _mm256_set1_epi8('\n');
+    for (; i + 32 <= n; i += 32) {
+        unsigned hit = (unsigned)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + i)), nl));
+        while (hit) {
+            out[count++] = base + i + (size_t)__builtin_ctz(hit);
+            hit &= hit - 1;
+        }
+    }
+    return count + index_newlines_sse2(p + i, n - i, base + i, out + count);
+}
+#endif
+
+static const LexKernels lex_kernel_table[] = {
+#ifdef LEX_X86_KERNELS
+    {"avx2", skip_space_avx2, skip_ident_avx2, find_pair_avx2, find_either_avx2,
+     count_newlines_avx2, index_newlines_avx2},
+    {"sse2", skip_space_sse2, skip_ident_sse2, find_pair_sse2, find_either_sse2,
+     count_newlines_sse2, index_newlines_sse2},
+#endif
+    {"scalar", skip_space_scalar, skip_ident_scalar, find_pair_scalar, find_either_scalar,
+     count_newlines_scalar, index_newlines_scalar},
+};
+
+static const LexKernels *lex_kernels = &lex_kernel_table[sizeof(lex_kernel_table) / sizeof(lex_kernel_table[0]) - 1];
+
+static int lex_kernel_supported(const LexKernels *k) {
+#ifdef LEX_X86_KERNELS
+    __builtin_cpu_init();
+    if (strcmp(k->name, "avx2") == 0) return __builtin_cpu_supports("avx2");
+    if (strcmp(k->name, "sse2") == 0) return __builtin_cpu_supports("sse2");
+#endif
+    return strcmp(k->name, "scalar") == 0;
+}
+
+/* Picks the named kernel set, or the widest one the CPU supports when name is
+ * NULL.  Returns -1 if the named set is unknown or unsupported here. */
+static int lex_kernels_select(const char *name) {
+    size_t count = sizeof(lex_kernel_table) / sizeof(lex_kernel_table[0]);
+    for (size_t i = 0; i < count; ++i) {
+        const LexKernels *k = &lex_kernel_table[i];
+        if (name && strcmp(k->name, name) != 0) continue;
+        if (!lex_kernel_supported(k)) continue;
+        lex_kernels = k;
+        return 0;
+    }
+    return -1;
+}
+
+/* Line starts of an in-memory input, built with index_newlines: starts[k]
+ * is the offset of line k + 1, and starts[count] is a SIZE_MAX sentinel.
+ * Scanners in offsets-only mode leave line and column at 0 and the consumer
+ * resolves them here when it needs them.  Lookups in increasing offset
+ * order (the usual case) are answered from the hint line in O(1); anything
+ * else is a binary search. */
+typedef struct {
+    size_t *starts;
+    size_t count;
+    size_t hint;
+} LineIndex;
+
+static void line_index_build(LineIndex *idx, const char *buf, size_t len) {
+    size_t last = 0;
+    size_t newlines = len ? lex_kernels->count_newlines((const unsigned char *)buf, len, &last) : 0;
+    idx->starts = (size_t *)malloc((newlines + 2) * sizeof(*idx->starts));
+    if (!idx->starts) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    idx->starts[0] = 0;
+    idx->count = 1 + (len ? lex_kernels->index_newlines((const unsigned char *)buf, len, 1, idx->starts + 1) : 0);
+    idx->starts[idx->count] = (size_t)-1;
+    idx->hint = 0;
+}
+
+static void line_index_free(LineIndex *idx) {
+    free(idx->starts);
+    idx->starts = NULL;
+    idx->count = 0;
+}
+
+static void line_index_locate(LineIndex *idx, size_t offset, size_t *line, size_t *column) {
+    size_t k = idx->hint;
+    if (idx->starts[k] <= offset && offset < idx->starts[k + 1]) {
+        /* same line as last time */
+    } else if (idx->starts[k + 1] <= offset && offset < idx->starts[k + 2]) {
+        k++;
+    } else {
+        /* gallop forward from the hint, or search everything before it */
+        size_t lo = 0, hi = idx->count;    /* starts[lo] <= offset < starts[hi] */
+        if (idx->starts[k] <= offset) {
+            size_t step = 1;
+            lo = k;
+            while (lo + step < idx->count && idx->starts[lo + step] <= offset) {
+                lo += step;
+                step *= 2;
+            }
+            if (lo + step < hi) hi = lo + step;
+        }
+        while (hi - lo > 1) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (idx->starts[mid] <= offset) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        k = lo;
+    }
+    idx->hint = k;
+    *line = k + 1;
+    *column = offset - idx->starts[k] + 1;
+}
+
+/* Byte offset where tok begins: string and char lexemes exclude the opening
+ * quote and comment lexemes the opening delimiter. */
+static size_t token_start(const Token *tok) {
+    switch (tok->kind) {
+        case TK_STRING_LITERAL:
+        case TK_CHAR_LITERAL: return tok->offset - 1;
+        case TK_COMMENT: return tok->offset - 2;
+        default: return tok->offset;
+    }
+}
+
+static void line_index_resolve(LineIndex *idx, Token *tok) {
+    line_index_locate(idx, token_start(tok), &tok->line, &tok->column);
+}
+
+/* Numeric literal values (Scanner.values / --values).  Decimal and hex
+ * integers are converted eight digits at a time with SWAR arithmetic on one
+ * 64-bit load; a leading 0 makes an INT octal, as in C.  Floats take the
+ * exact Clinger path when the digits fit in a double and |exponent| <= 22,
+ * then Eisel-Lemire (a 128-bit truncated power of five times the
+ * normalized digits, which settles the rounding in all but rare halfway
+ * cases), and strtod for those and for more than 19 significant digits. */
+static unsigned long long load_le64(const char *p) {
+    unsigned long long v;
+    memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static int swar_eight_digits(unsigned long long v) {
+    return ((v & 0xF0F0F0F0F0F0F0F0ull) |
+            (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+}
+
+/* Eight ASCII digits, first one most significant. */
+static unsigned long long swar_parse_digits(unsigned long long v) {
+    v -= 0x3030303030303030ull;
+    v = v * 10 + (v >> 8);
+    v = ((v & 0x000000FF000000FFull) * (100 + (1000000ull << 32)) +
+         ((v >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32))) >> 32;
+    return v;
+}
+
+/* Eight hex digits, first one most significant. */
+static unsigned long long swar_parse_hex(unsigned long long v) {
+    unsigned long long letter = (v >> 6) & 0x0101010101010101ull;
+    v = (v & 0x0F0F0F0F0F0F0F0Full) + letter * 9;
+    v = ((v << 4) | (v >> 8)) & 0x00FF00FF00FF00FFull;
+    v = ((v << 8) | (v >> 16)) & 0x0000FFFF0000FFFFull;
+    return ((v << 16) | (v >> 32)) & 0xFFFFFFFFull;
+}
+
+static int hex_value(int ch) {
+    return ch <= '9' ? ch - '0' : (ch | 0x20) - 'a' + 10;
+}
+
+static TokenValueStatus parse_int_literal(const char *p, size_t n, unsigned long long *out) {
+    unsigned long long v = 0;
+    size_t i = 0;
+    if (n > 1 && p[0] == '0') {
+        for (i = 1; i < n; ++i) {
+            unsigned d = (unsigned)(p[i] - '0');
+            if (d > 7) return TV_MALFORMED;
+            if (v >> 61) {
+                *out = ~0ull;
+                return TV_OVERFLOW;
+            }
+            v = v * 8 + d;
+        }
+        *out = v;
+        return TV_OK;
+    }
+    size_t safe = n < 19 ? n : 19;      /* 19 digits always fit */
+    for (; i + 8 <= safe; i += 8) {
+        v = v * 100000000 + swar_parse_digits(load_le64(p + i));
+    }
+    for (; i < safe; ++i) {
+        v = v * 10 + (unsigned)(p[i] - '0');
+    }
+    for (; i < n; ++i) {
+        if (__builtin_mul_overflow(v, 10, &v) || __builtin_add_overflow(v, (unsigned)(p[i] - '0'), &v)) {
+            *out = ~0ull;
+            return TV_OVERFLOW;
+        }
+    }
+    *out = v;
+    return TV_OK;
+}
+
+static TokenValueStatus parse_hex_literal(const char *p, size_t n, unsigned long long *out) {
+    size_t i = 2;
+    unsigned long long v = 0;
+    if (n == 2) return TV_MALFORMED;
+    while (i < n && p[i] == '0') i++;
+    if (n - i > 16) {
+        *out = ~0ull;
+        return TV_OVERFLOW;
+    }
+    for (; i + 8 <= n; i += 8) {
+        v = (v << 32) | swar_parse_hex(load_le64(p + i));
+    }
+    for (; i < n; ++i) {
+        v = (v << 4) | (unsigned)hex_value((unsigned char)p[i]);
+    }
+    *out = v;
+    return TV_OK;
+}
+
+#ifdef __SIZEOF_INT128__
+/* pow5_128[q + 342] holds the top 128 bits of 5^q for q in [-342, 308]:
+ * 5^q itself truncated for q >= 0, floor(2^b / 5^-q) + 1 truncated for
+ * q < 0 (b = z + 127 for q >= -27, else 2z + 128, with 2^z the first power
+ * of two above 5^-q).  It is built once with exact multiword arithmetic:
+ * floor(2^B / 5^n) = floor(floor(2^B / 5^(n-1)) / 5), so one division by 5
+ * per step suffices. */
+#define POW5_MIN (-342)
+#define POW5_MAX 308
+#define POW5_WORDS 58           /* 32-bit words, enough for 2^1792 */
+
+static unsigned long long pow5_128[POW5_MAX - POW5_MIN + 1][2];
+static pthread_once_t pow5_once = PTHREAD_ONCE_INIT;
+
+static int big_bit_length(const unsigned *a) {
+    for (int w = POW5_WORDS - 1; w >= 0; --w) {
+        if (a[w]) return w * 32 + 32 - __builtin_clz(a[w]);
+    }
+    return 0;
+}
+
+/* 32 bits of a starting at bit pos (which may be negative). */
+static unsigned big_bits32(const unsigned *a, int pos) {
+    unsigned long long v = 0;
+    for (int k = 0; k < 2; ++k) {
+        int w = (pos >> 5) + k;     /* floor division */
+        if (w >= 0 && w < POW5_WORDS) v |= (unsigned long long)a[w] << (32 * k);
+    }
+    return (unsigned)(v >> (pos & 31));
+}
+
+/* The 128 bits of a at [pos, pos + 128). */
+static void big_top128(const unsigned *a, int pos, unsigned long long *entry) {
+    entry[0] = (unsigned long long)big_bits32(a, pos + 96) << 32 | big_bits32(a, pos + 64);
+    entry[1] = (unsigned long long)big_bits32(a, pos + 32) << 32 | big_bits32(a, pos);
+}
+
+static void pow5_init(void) {
+    unsigned power[POW5_WORDS] = {1};      /* 5^n */
+    unsigned recip[POW5_WORDS] = {0};      /* floor(2^1792 / 5^n) */
+    recip[56] = 1;
+    for (int n = 0; n <= POW5_MAX || n <= -POW5_MIN; ++n) {
+        if (n > 0) {
+            unsigned long long carry = 0;
+            for (int w = 0; w < POW5_WORDS; ++w) {
+                carry += (unsigned long long)power[w] * 5;
+                power[w] = (unsigned)carry;
+                carry >>= 32;
+            }
+            unsigned long long rem = 0;
+            for (int w = POW5_WORDS - 1; w >= 0; --w) {
+                unsigned long long cur = rem << 32 | recip[w];
+                recip[w] = (unsigned)(cur / 5);
+                rem = cur % 5;
+            }
+        }
+        int z = big_bit_length(power);
+        if (n <= POW5_MAX) {
+            big_top128(power, z - 128, pow5_128[n - POW5_MIN]);
+        }
+        if (n > 0 && n <= -POW5_MIN) {
+            /* 2^z > 5^n > 2^(z-1) since 5^n is never a power of two */
+            int b = n <= 27 ? z + 127 : 2 * z + 128;
+            unsigned c[POW5_WORDS] = {0};
+            int shift = 1792 - b;
+            for (int w = 0; w < POW5_WORDS; ++w) c[w] = big_bits32(recip, shift + 32 * w);
+            for (int w = 0; w < POW5_WORDS; ++w) {
+                if (++c[w] != 0) break;
+            }
+            int len = big_bit_length(c);
+            big_top128(c, len > 128 ? len - 128 : 0, pow5_128[-n - POW5_MIN]);
+        }
+    }
+}
+
+/* Decimal w * 10^q rounded to nearest even; -1 when the product cannot
+ * settle the rounding and the caller must fall back. */
+static int eisel_lemire(unsigned long long w, int q, double *out) {
+    if (q < POW5_MIN) {
+        *out = 0.0;
+        return 0;
+    }
+    if (q > POW5_MAX) {
+        *out = HUGE_VAL;
+        return 0;
+    }
+    pthread_once(&pow5_once, pow5_init);
+    const unsigned long long *t = pow5_128[q - POW5_MIN];
+    int lz = __builtin_clzll(w);
+    w <<= lz;
+    unsigned __int128 first = (unsigned __int128)w * t[0];
+    unsigned long long hi = (unsigned long long)(first >> 64);
+    unsigned long long lo = (unsigned long long)first;
+    if ((hi & 0x1FF) == 0x1FF) {
+        unsigned long long second = (unsigned long long)(((unsigned __int128)w * t[1]) >> 64);
+        lo += second;
+        if (second > lo) hi++;
+    }
+    if (lo == ~0ull && (q < -27 || q > 55)) {
+        return -1;
+    }
+    int upper = (int)(hi >> 63);
+    unsigned long long mantissa = hi >> (upper + 9);
+    int power2 = (((152170 + 65536) * q) >> 16) + 63 + upper - lz + 1023;
+    unsigned long long bits;
+    if (power2 <= 0) {
+        if (-power2 + 1 >= 64) {
+            *out = 0.0;
+            return 0;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        bits = mantissa;        /* rounding up to 2^52 yields the smallest normal */
+    } else {
+        if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 &&
+            (mantissa << (upper + 9)) == hi) {
+            mantissa &= ~1ull;  /* exactly halfway: round to even */
+        }
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        if (mantissa >= (2ull << 52)) {
+            mantissa = 1ull << 52;
+            power2++;
+        }
+        if (power2 >= 0x7FF) {
+            *out = HUGE_VAL;
+            return 0;
+        }
+        bits = (mantissa & ~(1ull << 52)) | (unsigned long long)power2 << 52;
+    }
+    memcpy(out, &bits, sizeof(bits));
+    return 0;
+}
+#endif
+
+static double strtod_slice(const char *p, size_t n) {
+    char small[128];
+    char *buf = n < sizeof(small) ? small : (char *)malloc(n + 1);
+    if (!buf) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(buf, p, n);
+    buf[n] = '\0';
+    double v = strtod(buf, NULL);
+    if (buf != small) free(buf);
+    return v;
+}
+
+/* Lexeme grammar: digits ['.' digits] [('e'|'E') ['+'|'-'] digits]. */
+static TokenValueStatus parse_float_literal(const char *p, size_t n, double *out) {
+    static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    unsigned long long w = 0;
+    int digits = 0;             /* significant digits in w */
+    long exp10 = 0;
+    int inexact = 0;            /* nonzero digits dropped past the 19th */
+    size_t i = 0;
+    while (i < n && p[i] == '0') i++;
+    for (int frac = 0; frac < 2; ++frac) {
+        if (frac) {
+            if (i >= n || p[i] != '.') break;
+            i++;
+            if (digits == 0) {
+                while (i < n && p[i] == '0') {
+                    i++;
+                    exp10--;
+                }
+            }
+        }
+        while (digits + 8 <= 19 && i + 8 <= n && swar_eight_digits(load_le64(p + i))) {
+            w = w * 100000000 + swar_parse_digits(load_le64(p + i));
+            digits += 8;
+            i += 8;
+            if (frac) exp10 -= 8;
+        }
+        for (; i < n && isdigit((unsigned char)p[i]); ++i) {
+            if (digits < 19) {
+                w = w * 10 + (unsigned)(p[i] - '0');
+                digits++;
+                if (frac) exp10--;
+            } else {
+                if (p[i] != '0') inexact = 1;
+                if (!frac) exp10++;
+            }
+        }
+    }
+    if (i < n && (p[i] == 'e' || p[i] == 'E')) {
+        int negative = 0;
+        long e = 0;
+        i++;
+        if (i < n && (p[i] == '+' || p[i] == '-')) negative = p[i++] == '-';
+        if (i == n) {
+            *out = 0.0;
+            return TV_MALFORMED;
+        }
+        for (; i < n; ++i) {
+            if (e < 100000) e = e * 10 + (p[i] - '0');
+        }
+        exp10 += negative ? -e : e;
+    }
+    if (w == 0) {
+        *out = 0.0;
+        return TV_OK;
+    }
+    double v;
+    if (inexact) {
+        v = strtod_slice(p, n);
+#if FLT_EVAL_METHOD == 0
+    } else if (w <= (1ull << 53) && exp10 >= -22 && exp10 <= 22) {
+        v = exp10 < 0 ? (double)w / pow10[-exp10] : (double)w * pow10[exp10];
+#endif
+    } else {
+#ifdef __SIZEOF_INT128__
+        int q = exp10 < -100000 ? -100000 : exp10 > 100000 ? 100000 : (int)exp10;
+        if (eisel_lemire(w, q, &v) != 0) v = strtod_slice(p, n);
+#else
+        v = strtod_slice(p, n);
+#endif
+    }
+    *out = v;
+    return isinf(v) ? TV_OVERFLOW : TV_OK;
+}
+
+/* Fills tok->value for INT, HEX and FLOAT tokens. */
+static void token_decode_value(Token *tok) {
+    switch (tok->kind) {
+        case TK_INT_LITERAL: tok->value_status = parse_int_literal(tok->lexeme, tok->length, &tok->value.u); break;
+        case TK_HEX_LITERAL: tok->value_status = parse_hex_literal(tok->lexeme, tok->length, &tok->value.u); break;
+        case TK_FLOAT_LITERAL: tok->value_status = parse_float_literal(tok->lexeme, tok->length, &tok->value.d); break;
+        default: break;
+    }
+}
+
+/* Streaming input for pipes, stdin and files that cannot be mapped.  A
+ * reader thread fills two LEX_STREAM_BLOCK buffers in turn with plain
+ * blocking reads, so the next block is read while the current one is
+ * lexed.  Each buffer keeps LEX_STREAM_CARRY bytes free in front of its
+ * data: when the scanner moves on to the next block it copies the
+ * unfinished token there and keeps running over one contiguous window.
+ * Memory stays at two blocks regardless of input size; only a single token
+ * longer than LEX_STREAM_CARRY needs a separate, larger window, which grows
+ * to that token plus one block and is freed once the token is done. */
+#define LEX_STREAM_BLOCK (1u << 20)
+#define LEX_STREAM_CARRY (64u << 10)
+
+typedef struct {
+    int fd;
+    int close_fd;
+    char *mem[2];               /* LEX_STREAM_CARRY + LEX_STREAM_BLOCK each */
+    size_t filled[2];
+    int full[2];                /* owned by the scanner until it hands the buffer back */
+    int last[2];                /* block ends the input */
+    int error;                  /* errno of a failed read */
+    int stop;
+    int next;                   /* block the scanner takes next */
+    int held;                   /* block under the current window, -1 for wide */
+    char *wide;                 /* window for tokens that outgrow the carry area */
+    size_t wide_cap;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} LexStream;
+
+static long lex_stream_read(int fd, char *dst, size_t n) {
+#ifdef _WIN32
+    return _read(fd, dst, (unsigned)n);
+#else
+    return (long)read(fd, dst, n);
+#endif
+}
+
+static void *lex_stream_reader(void *arg) {
+    LexStream *st = (LexStream *)arg;
+    for (int k = 0;; k ^= 1) {
+        pthread_mutex_lock(&st->lock);
+        while (st->full[k] && !st->stop) {
+            pthread_cond_wait(&st->changed, &st->lock);
+        }
+        int stop = st->stop;
+        pthread_mutex_unlock(&st->lock);
+        if (stop) {
+            return NULL;
+        }
+        char *dst = st->mem[k] + LEX_STREAM_CARRY;
+        size_t got = 0;
+        int error = 0;
+        while (got < LEX_STREAM_BLOCK) {
+            long n = lex_stream_read(st->fd, dst + got, LEX_STREAM_BLOCK - got);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                error = n < 0 ? errno : 0;
+                break;
+            }
+            got += (size_t)n;
+        }
+        pthread_mutex_lock(&st->lock);
+        st->filled[k] = got;
+        st->last[k] = got < LEX_STREAM_BLOCK;
+        if (error) st->error = error;
+        st->full[k] = 1;
+        pthread_cond_broadcast(&st->changed);
+        pthread_mutex_unlock(&st->lock);
+        if (got < LEX_STREAM_BLOCK) {
+            return NULL;
+        }
+    }
+}
+
+/* Starts the reader on fd when it is open already (the caller keeps it),
+ * otherwise on path ("-" is stdin).  Returns -1 with errno set when the
+ * input cannot be opened. */
+static int lex_stream_open(LexStream *st, const char *path, int fd) {
+    memset(st, 0, sizeof(*st));
+    st->held = -1;
+    st->fd = fd;
+    if (fd >= 0) {
+        /* owned by the caller */
+    } else if (strcmp(path, "-") == 0) {
+        st->fd = fileno(stdin);
+#ifdef _WIN32
+        _setmode(st->fd, _O_BINARY);
+#endif
+    } else {
+#ifdef _WIN32
+        st->fd = _open(path, _O_RDONLY | _O_BINARY);
+#else
+        st->fd = open(path, O_RDONLY);
+#endif
+        if (st->fd < 0) {
+            return -1;
+        }
+        st->close_fd = 1;
+    }
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(st->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    st->mem[0] = (char *)malloc(LEX_STREAM_CARRY + LEX_STREAM_BLOCK);
+    st->mem[1] = (char *)malloc(LEX_STREAM_CARRY + LEX_STREAM_BLOCK);
+    if (!st->mem[0] || !st->mem[1]) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    pthread_mutex_init(&st->lock, NULL);
+    pthread_cond_init(&st->changed, NULL);
+    if (pthread_create(&st->thread, NULL, lex_stream_reader, st) != 0) {
+        fprintf(stderr, "cannot start the reader thread\n");
+        exit(EXIT_FAILURE);
+    }
+    return 0;
+}
+
+/* Stops the reader; closing before the end of input waits for the read in
+ * progress to return. */
+static void lex_stream_close(LexStream *st) {
+    pthread_mutex_lock(&st->lock);
+    st->stop = 1;
+    pthread_cond_broadcast(&st->changed);
+    pthread_mutex_unlock(&st->lock);
+    pthread_join(st->thread, NULL);
+    pthread_cond_destroy(&st->changed);
+    pthread_mutex_destroy(&st->lock);
+    if (st->close_fd) {
+#ifdef _WIN32
+        _close(st->fd);
+#else
+        close(st->fd);
+#endif
+    }
+    free(st->mem[0]);
+    free(st->mem[1]);
+    free(st->wide);
+}
+
+/* The scanner walks a pointer over buf when the whole input is in memory,
+ * or over a window of a LexStream (see scanner_stream_refill).  With fp set
+ * it falls back to fgetc and records the bytes consumed since scanner_mark
+ * in text, so lexemes can still be handed out as slices. */
+typedef struct {
+    FILE *fp;
+    const char *buf;
+    size_t len;
+    size_t pos;
+    int current;
+    size_t line;
+    size_t column;
+    size_t mark;
+    char *text;
+    size_t text_len;
+    size_t text_cap;
+    SymbolTable *symbols;   /* optional: set Token.symbol for names and literals */
+    int offsets_only;       /* buffer mode without line/column tracking */
+    int values;             /* decode numeric literals into Token.value */
+    LexStream *stream;      /* stream mode: buf is a window starting at base */
+    size_t base;
+    int stream_end;         /* the window reaches the end of the input */
+    int resume;             /* stream mode: LEX_RESUME_* of a token cut by the window end */
+    size_t resume_pos;      /* how far its scan got, from the token start */
+    size_t resume_line;     /* position there */
+    size_t resume_column;
+    int resume_escape;      /* a literal was cut right after a backslash */
+} Scanner;
+
+#ifdef LEXER_NO_MAIN
+static void scanner_init(Scanner *s, FILE *fp) {
+    memset(s, 0, sizeof(*s));
+    s->fp = fp;
+    s->current = fgetc(fp);
+    s->line = 1;
+    s->column = 1;
+}
+#endif
+
+/* Resumes scanning buf at pos with the given position.  The scanner keeps no
+ * other state between tokens, so starting at a token boundary reproduces
+ * exactly what a scan from the beginning would produce from there on. */
+static void scanner_init_buffer_at(Scanner *s, const char *buf, size_t len,
+                                   size_t pos, size_t line, size_t column) {
+    memset(s, 0, sizeof(*s));
+    s->buf = buf;
+    s->len = len;
+    s->pos = pos;
+    s->current = pos < len ? (unsigned char)buf[pos] : EOF;
+    s->line = line;
+    s->column = column;
+}
+
+static void scanner_init_buffer(Scanner *s, const char *buf, size_t len) {
+    scanner_init_buffer_at(s, buf, len, 0, 1, 1);
+}
+
+/* Tracks byte offsets only: tokens come out with line and column 0, to be
+ * filled in from a LineIndex by the consumers that print them. */
+static void scanner_init_offsets(Scanner *s, const char *buf, size_t len) {
+    scanner_init_buffer_at(s, buf, len, 0, 0, 0);
+    s->offsets_only = 1;
+}
+
+/* Stream mode: buf is a window over the input starting at byte base.  The
+ * window moves on when a token ends within LEX_STREAM_LOOKAHEAD bytes of
+ * its end (more than the one byte of lookahead any token needs, so a token
+ * that ends earlier cannot change once more input arrives); the token is
+ * then scanned again in the new window.  Comments and literals, the tokens
+ * that can run for megabytes, continue from where the window cut them off
+ * instead of from their first byte (see scanner_stream_resume). */
+#define LEX_STREAM_LOOKAHEAD 16
+
+static void scanner_stream_refill(Scanner *s) {
+    LexStream *st = s->stream;
+    int k = st->next;
+    pthread_mutex_lock(&st->lock);
+    while (!st->full[k]) {
+        pthread_cond_wait(&st->changed, &st->lock);
+    }
+    pthread_mutex_unlock(&st->lock);
+    const char *data = st->mem[k] + LEX_STREAM_CARRY;
+    size_t filled = st->filled[k];
+    int last = st->last[k];
+    size_t carry = s->len - s->pos;
+    char *window;
+    int held = k;
+    if (carry <= LEX_STREAM_CARRY) {
+        window = st->mem[k] + LEX_STREAM_CARRY - carry;
+        memcpy(window, s->buf + s->pos, carry);
+        if (st->held < 0) {
+            /* the long token is done: give its window back */
+            free(st->wide);
+            st->wide = NULL;
+            st->wide_cap = 0;
+        }
+    } else if (s->buf + s->pos == st->wide) {
+        /* the token already starts the wide window: append the block only */
+        if (carry + filled > st->wide_cap) {
+            size_t cap = (carry + filled) * 2;
+            char *grown = (char *)realloc(st->wide, cap);
+            if (!grown) {
+                fprintf(stderr, "out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+            st->wide = grown;
+            st->wide_cap = cap;
+        }
+        memcpy(st->wide + carry, data, filled);
+        window = st->wide;
+        held = -1;
+    } else {
+        /* a token longer than the carry area: both parts go to the wide window */
+        if (carry + filled > st->wide_cap) {
+            size_t cap = (carry + filled) * 2;
+            char *grown = (char *)malloc(cap);
+            if (!grown) {
+                fprintf(stderr, "out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+            memcpy(grown, s->buf + s->pos, carry);
+            free(st->wide);
+            st->wide = grown;
+            st->wide_cap = cap;
+        } else {
+            memmove(st->wide, s->buf + s->pos, carry);
+        }
+        memcpy(st->wide + carry, data, filled);
+        window = st->wide;
+        held = -1;
+    }
+    pthread_mutex_lock(&st->lock);
+    if (st->held >= 0) st->full[st->held] = 0;
+    if (held < 0) st->full[k] = 0;
+    pthread_cond_broadcast(&st->changed);
+    pthread_mutex_unlock(&st->lock);
+    st->held = held;
+    st->next = k ^ 1;
+    s->stream_end = last;
+    s->base += s->pos;
+    s->buf = window;
+    s->len = carry + filled;
+    s->pos = 0;
+    s->current = s->len ? (unsigned char)window[0] : EOF;
+}
+
+static void scanner_init_stream(Scanner *s, LexStream *st) {
+    scanner_init_buffer(s, "", 0);
+    s->stream = st;
+    scanner_stream_refill(s);
+}
+
+static void scanner_free(Scanner *s) {
+    free(s->text);
+    s->text = NULL;
+    s->text_len = s->text_cap = 0;
+}
+
+static void scanner_record(Scanner *s, int ch) {
+    if (s->text_len == s->text_cap) {
+        size_t cap = s->text_cap ? s->text_cap * 2 : 256;
+        char *grown = (char *)realloc(s->text, cap);
+        if (!grown) {
+            fprintf(stderr, "out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        s->text = grown;
+        s->text_cap = cap;
+    }
+    s->text[s->text_len++] = (char)ch;
+}
+
+static void scanner_advance(Scanner *s) {
+    if (s->offsets_only) {
+        /* positions come from a LineIndex */
+    } else if (s->current == '\n') {
+        s->line++;
+        s->column = 1;
+    } else {
+        s->column++;
+    }
+    s->pos++;
+    if (s->fp) {
+        scanner_record(s, s->current);
+        s->current = fgetc(s->fp);
+    } else {
+        s->current = s->pos < s->len ? (unsigned char)s->buf[s->pos] : EOF;
+    }
+}
+
+static int scanner_peek(Scanner *s) {
+    return s->current;
+}
+
+/* Buffer mode: moves to target, counting the newlines in between. */
+static void scanner_jump(Scanner *s, size_t target) {
+    if (s->offsets_only) {
+        s->pos = target;
+        s->current = target < s->len ? (unsigned char)s->buf[target] : EOF;
+        return;
+    }
+    size_t last = 0;
+    size_t lines = lex_kernels->count_newlines((const unsigned char *)s->buf + s->pos,
+                                               target - s->pos, &last);
+    if (lines) {
+        s->line += lines;
+        s->column = target - (s->pos + last);
+    } else {
+        s->column += target - s->pos;
+    }
+    s->pos = target;
+    s->current = target < s->len ? (unsigned char)s->buf[target] : EOF;
+}
+
+/* Buffer mode: skips n bytes known to contain no newline. */
+static void scanner_skip_span(Scanner *s, size_t n) {
+    s->pos += n;
+    if (!s->offsets_only) s->column += n;
+    s->current = s->pos < s->len ? (unsigned char)s->buf[s->pos] : EOF;
+}
+
+static const unsigned char *scanner_cursor(const Scanner *s) {
+    return (const unsigned char *)s->buf + s->pos;
+}
+
+static void scanner_skip_whitespace(Scanner *s) {
+    if (!s->fp) {
+        scanner_jump(s, s->pos + lex_kernels->skip_space(scanner_cursor(s), s->len - s->pos));
+        return;
+    }
+    while (isspace(scanner_peek(s))) {
+        scanner_advance(s);
+    }
+}
+
+/* Starts a lexeme at the current position. */
+static void scanner_mark(Scanner *s) {
+    s->mark = s->pos;
+    s->text_len = 0;
+}
+
+static Token make_simple_token(TokenKind kind, const char *lexeme, size_t length,
+                               size_t offset, size_t line, size_t col) {
+    Token tok;
+    tok.kind = kind;
+    tok.lexeme = lexeme;
+    tok.length = length;
+    tok.offset = offset;
+    tok.line = line;
+    tok.column = col;
+    tok.keyword = KW_NONE;
+    tok.symbol = SYMBOL_NONE;
+    tok.value_status = TV_NONE;
+    tok.value.u = 0;
+    return tok;
+}
+
+/* Token whose lexeme is the first length bytes from the last scanner_mark. */
+static Token make_token(Scanner *s, TokenKind kind, size_t length, size_t line, size_t col) {
+    const char *lexeme = s->fp ? s->text : s->buf + s->mark;
+    return make_simple_token(kind, lexeme ? lexeme : "", length, s->mark, line, col);
+}
+
+static Token lex_error(const char *message, size_t offset, size_t line, size_t col) {
+    return make_simple_token(TK_ERROR, message, strlen(message), offset, line, col);
+}
+
+static Token scan_string_literal(Scanner *s, size_t start_line, size_t start_col) {
+    size_t start = s->pos;
+    size_t idx = 0;
+    scanner_advance(s);
+    scanner_mark(s);
+    while (scanner_peek(s) != EOF && scanner_peek(s) != '"') {
+        if (scanner_peek(s) == '\\') {
+            idx++;
+            scanner_advance(s);
+            if (scanner_peek(s) == EOF) break;
+        }
+        idx++;
+        scanner_advance(s);
+    }
+    if (scanner_peek(s) != '"') {
+        return lex_error("Unterminated string literal", start, start_line, start_col);
+    }
+    scanner_advance(s);
+    return make_token(s, TK_STRING_LITERAL, idx, start_line, start_col);
+}
+
+static Token scan_char_literal(Scanner *s, size_t start_line, size_t start_col) {
+    size_t start = s->pos;
+    size_t idx = 0;
+    scanner_advance(s);
+    scanner_mark(s);
+    while (scanner_peek(s) != EOF && scanner_peek(s) != '\'') {
+        if (scanner_peek(s) == '\\') {
+            idx++;
+            scanner_advance(s);
+            if (scanner_peek(s) == EOF) break;
+        }
+        idx++;
+        scanner_advance(s);
+    }
+    if (scanner_peek(s) != '\'') {
+        return lex_error("Unterminated char literal", start, start_line, start_col);
+    }
+    scanner_advance(s);
+    return make_token(s, TK_CHAR_LITERAL, idx, start_line, start_col);
+}
+
+static Token scan_identifier_or_keyword(Scanner *s, size_t start_line, size_t start_col) {
+    size_t idx = 0;
+    scanner_mark(s);
+    if (!s->fp) {
+        idx = lex_kernels->skip_ident(scanner_cursor(s), s->len - s->pos);
+        scanner_skip_span(s, idx);
+    }
+    while (scanner_peek(s) != EOF &&
+           (isalnum(scanner_peek(s)) || scanner_peek(s) == '_')) {
+        idx++;
+        scanner_advance(s);
+    }
+    Token tok = make_token(s, TK_IDENTIFIER, idx, start_line, start_col);
+    tok.keyword = keyword_lookup(tok.lexeme, tok.length);
+    if (tok.keyword != KW_NONE) {
+        tok.kind = TK_KEYWORD;
+    }
+    return tok;
+}
+
+static int is_hex_digit(int ch) {
+    return isdigit(ch) || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F');
+}
+
+static Token scan_number(Scanner *s, size_t start_line, size_t start_col) {
+    size_t idx = 0;
+    int ch = scanner_peek(s);
+    int saw_dot = 0;
+    int saw_exp = 0;
+    scanner_mark(s);
+    if (ch == '0') {
+        idx++;
+        scanner_advance(s);
+        if (scanner_peek(s) == 'x' || scanner_peek(s) == 'X') {
+            idx++;
+            scanner_advance(s);
+            while (is_hex_digit(scanner_peek(s))) {
+                idx++;
+                scanner_advance(s);
+            }
+            return make_token(s, TK_HEX_LITERAL, idx, start_line, start_col);
+        }
+    }
+    while (isdigit(scanner_peek(s))) {
+        idx++;
+        scanner_advance(s);
+    }
+    if (scanner_peek(s) == '.') {
+        saw_dot = 1;
+        idx++;
+        scanner_advance(s);
+        while (isdigit(scanner_peek(s))) {
+            idx++;
+            scanner_advance(s);
+        }
+    }
+    if (scanner_peek(s) == 'e' || scanner_peek(s) == 'E') {
+        saw_exp = 1;
+        idx++;
+        scanner_advance(s);
+        if (scanner_peek(s) == '+' || scanner_peek(s) == '-') {
+            idx++;
+            scanner_advance(s);
+        }
+        while (isdigit(scanner_peek(s))) {
+            idx++;
+            scanner_advance(s);
+        }
+    }
+    if (saw_dot || saw_exp) {
+        return make_token(s, TK_FLOAT_LITERAL, idx, start_line, start_col);
+    }
+    return make_token(s, TK_INT_LITERAL, idx, start_line, start_col);
+}
+
+static Token scan_comment_or_operator(Scanner *s, size_t start_line, size_t start_col) {
+    int ch = scanner_peek(s);
+    size_t start = s->pos;
+    scanner_mark(s);
+    scanner_advance(s);
+    if (ch == '/') {
+        if (scanner_peek(s) == '/') {
+            scanner_advance(s);
+            size_t idx = 0;
+            scanner_mark(s);
+            if (!s->fp) {
+                const unsigned char *nl = (const unsigned char *)memchr(scanner_cursor(s), '\n', s->len - s->pos);
+                idx = nl ? (size_t)(nl - scanner_cursor(s)) : s->len - s->pos;
+                scanner_skip_span(s, idx);
+                return make_token(s, TK_COMMENT, idx, start_line, start_col);
+            }
+            while (scanner_peek(s) != EOF && scanner_peek(s) != '\n') {
+                idx++;
+                scanner_advance(s);
+            }
+            return make_token(s, TK_COMMENT, idx, start_line, start_col);
+        } else if (scanner_peek(s) == '*') {
+            scanner_advance(s);
+            size_t idx = 0;
+            int terminated = 0;
+            scanner_mark(s);
+            if (!s->fp) {
+                idx = lex_kernels->find_pair(scanner_cursor(s), s->len - s->pos, '*', '/');
+                if (idx == s->len - s->pos) {
+                    scanner_jump(s, s->len);
+                    return lex_error("Unterminated block comment", start, start_line, start_col);
+                }
+                scanner_jump(s, s->pos + idx + 2);
+                return make_token(s, TK_COMMENT, idx, start_line, start_col);
+            }
+            while (scanner_peek(s) != EOF) {
+                if (scanner_peek(s) == '*') {
+                    scanner_advance(s);
+                    if (scanner_peek(s) == '/') {
+                        scanner_advance(s);
+                        terminated = 1;
+                        break;
+                    }
+                    idx++;
+                    continue;
+                }
+                idx++;
+                scanner_advance(s);
+            }
+            if (!terminated) {
+                return lex_error("Unterminated block comment", start, start_line, start_col);
+            }
+            return make_token(s, TK_COMMENT, idx, start_line, start_col);
+        }
+        return make_token(s, TK_OPERATOR, 1, start_line, start_col);
+    }
+    size_t length = 1;
+    if ((ch == '+' || ch == '-' || ch == '=' || ch == '!' || ch == '<' || ch == '>') &&
+        (scanner_peek(s) == '=' || (ch == '+' && scanner_peek(s) == '+') ||
+         (ch == '-' && scanner_peek(s) == '-'))) {
+        length = 2;
+        scanner_advance(s);
+    }
+    return make_token(s, TK_OPERATOR, length, start_line, start_col);
+}
+
+/* Buffer mode runs the token DFA generated into lexer_dfa.h; the scan_*
+ * routines above remain the reference and handle stream mode. */
+static int lex_use_table = 1;
+
+/* Runs the generated DFA from the current position with longest-match
+ * semantics.  Returns 0 and leaves the scanner untouched when no rule
+ * matches or the match would need backtracking (unterminated strings, chars
+ * and comments); the hand-written routines then produce the token or error. */
+static int scan_with_table(Scanner *s, Token *out) {
+    const unsigned char *p = (const unsigned char *)s->buf;
+    size_t start = s->pos;
+    size_t end = s->len;
+    size_t i = start;
+    size_t match_end = start;
+    int state = LEXER_DFA_START;
+    int tag = 0;
+    while (i < end) {
+        state = lexer_dfa_next[state][p[i]];
+        if (state == LEXER_DFA_DEAD) break;
+        i++;
+        if (lexer_dfa_accel[state][0] == LEXER_ACCEL_IDENT) {
+            i += lex_kernels->skip_ident(p + i, end - i);
+        } else if (lexer_dfa_accel[state][0] == LEXER_ACCEL_UNTIL) {
+            i += lex_kernels->find_either(p + i, end - i, lexer_dfa_accel[state][1],
+                                          lexer_dfa_accel[state][2]);
+        } else if (lexer_dfa_accel[state][0] == LEXER_ACCEL_PAIR) {
+            i += lex_kernels->find_pair(p + i, end - i, lexer_dfa_accel[state][1],
+                                        lexer_dfa_accel[state][2]);
+        }
+        if (lexer_dfa_accept[state]) {
+            tag = lexer_dfa_accept[state];
+            match_end = i;
+        }
+    }
+    if (tag == 0 || match_end != i) {
+        return 0;
+    }
+
+    size_t line = s->line;
+    size_t col = s->column;
+    size_t lexeme = start;
+    size_t length = i - start;
+    TokenKind kind = TK_OPERATOR;
+    int multiline = 0;
+    switch (tag) {
+        case LEXER_TAG_IDENT: kind = TK_IDENTIFIER; break;
+        case LEXER_TAG_INT: kind = TK_INT_LITERAL; break;
+        case LEXER_TAG_HEX: kind = TK_HEX_LITERAL; break;
+        case LEXER_TAG_FLOAT: kind = TK_FLOAT_LITERAL; break;
+        case LEXER_TAG_OP: kind = TK_OPERATOR; break;
+        case LEXER_TAG_PUNC: kind = TK_PUNCTUATION; break;
+        case LEXER_TAG_STRING:
+        case LEXER_TAG_CHAR:
+            kind = tag == LEXER_TAG_STRING ? TK_STRING_LITERAL : TK_CHAR_LITERAL;
+            lexeme += 1;
+            length -= 2;
+            multiline = 1;
+            break;
+        case LEXER_TAG_LINE_COMMENT:
+            kind = TK_COMMENT;
+            lexeme += 2;
+            length -= 2;
+            break;
+        case LEXER_TAG_BLOCK_COMMENT:
+            kind = TK_COMMENT;
+            lexeme += 2;
+            length -= 4;
+            multiline = 1;
+            break;
+        default:
+            return 0;
+    }
+    if (multiline) {
+        scanner_jump(s, i);
+    } else {
+        scanner_skip_span(s, i - start);
+    }
+    *out = make_simple_token(kind, s->buf + lexeme, length, lexeme, line, col);
+    if (kind == TK_IDENTIFIER) {
+        out->keyword = keyword_lookup(out->lexeme, out->length);
+        if (out->keyword != KW_NONE) {
+            out->kind = TK_KEYWORD;
+        }
+    }
+    return 1;
+}
+
+static Token scanner_scan_token(Scanner *s) {
+    scanner_skip_whitespace(s);
+    if (scanner_peek(s) == EOF) {
+        return make_simple_token(TK_EOF, "EOF", 3, s->pos, s->line, s->column);
+    }
+    if (!s->fp && lex_use_table) {
+        Token tok;
+        if (scan_with_table(s, &tok)) {
+            return tok;
+        }
+    }
+    size_t start_line = s->line;
+    size_t start_col = s->column;
+    int ch = scanner_peek(s);
+    if (isalpha(ch) || ch == '_') {
+        return scan_identifier_or_keyword(s, start_line, start_col);
+    }
+    if (isdigit(ch)) {
+        return scan_number(s, start_line, start_col);
+    }
+    if (ch == '"') {
+        return scan_string_literal(s, start_line, start_col);
+    }
+    if (ch == '\'') {
+        return scan_char_literal(s, start_line, start_col);
+    }
+    if (ch == '/' || ch == '+' || ch == '-' || ch == '*' || ch == '%' ||
+        ch == '=' || ch == '!' || ch == '<' || ch == '>') {
+        return scan_comment_or_operator(s, start_line, start_col);
+    }
+    scanner_mark(s);
+    scanner_advance(s);
+    if (strchr("(){}[];,.:?&|^~#", ch)) {
+        return make_token(s, TK_PUNCTUATION, 1, start_line, start_col);
+    }
+    return make_token(s, TK_ERROR, 1, start_line, start_col);
+}
+
+/* Tokens whose scan stream mode can pick up mid-way after a refill. */
+enum {
+    LEX_RESUME_NONE, LEX_RESUME_LINE_COMMENT, LEX_RESUME_BLOCK_COMMENT, LEX_RESUME_LITERAL
+};
+
+static void scanner_stream_suspend_at_end(Scanner *s, size_t start) {
+    s->resume_pos = s->len - start;
+    s->resume_line = s->line;
+    s->resume_column = s->column;
+}
+
+/* Records where the scan of tok, the token at start, stopped when it ran
+ * into the window end with no terminator seen.  Called once per token;
+ * scanner_stream_resume keeps the record up to date after that. */
+static void scanner_stream_suspend(Scanner *s, size_t start, const Token *tok) {
+    const char *p = s->buf + start;
+    size_t n = s->len - start;
+    s->resume = LEX_RESUME_NONE;
+    if (s->pos != s->len || n < 2) {
+        return;
+    }
+    if (p[0] == '/' && p[1] == '/') {
+        s->resume = LEX_RESUME_LINE_COMMENT;
+    } else if (tok->kind != TK_ERROR) {
+        return;     /* the terminator is the window's last byte */
+    } else if (p[0] == '/' && p[1] == '*') {
+        s->resume = LEX_RESUME_BLOCK_COMMENT;
+    } else if (p[0] == '"' || p[0] == '\'') {
+        /* an odd run of backslashes at the end escapes the next byte */
+        size_t run = 0;
+        while (run < n - 1 && p[n - 1 - run] == '\\') run++;
+        s->resume = LEX_RESUME_LITERAL;
+        s->resume_escape = (int)(run & 1);
+    } else {
+        return;
+    }
+    scanner_stream_suspend_at_end(s, start);
+}
+
+/* Scans the token at pos whose first resume_pos bytes are known to hold no
+ * terminator, producing what scanner_scan_token would.  When the window
+ * ends first, the record moves to the window end. */
+static Token scanner_stream_resume(Scanner *s) {
+    size_t start = s->pos;
+    size_t start_line = s->line;
+    size_t start_col = s->column;
+    int quote = s->buf[start];
+    size_t from = start + s->resume_pos;
+    s->pos = from;
+    s->line = s->resume_line;
+    s->column = s->resume_column;
+    s->current = from < s->len ? (unsigned char)s->buf[from] : EOF;
+    Token tok;
+    if (s->resume == LEX_RESUME_LINE_COMMENT) {
+        const char *nl = (const char *)memchr(s->buf + from, '\n', s->len - from);
+        size_t end = nl ? (size_t)(nl - s->buf) : s->len;
+        scanner_skip_span(s, end - from);
+        if (!nl) scanner_stream_suspend_at_end(s, start);
+        s->mark = start + 2;
+        tok = make_token(s, TK_COMMENT, end - s->mark, start_line, start_col);
+    } else if (s->resume == LEX_RESUME_BLOCK_COMMENT) {
+        /* the '*' of the terminator may be the last byte already scanned */
+        size_t at = from - 1 > start + 2 ? from - 1 : start + 2;
+        size_t idx = lex_kernels->find_pair((const unsigned char *)s->buf + at, s->len - at, '*', '/');
+        if (at + idx == s->len) {
+            scanner_jump(s, s->len);
+            scanner_stream_suspend_at_end(s, start);
+            tok = lex_error("Unterminated block comment", start, start_line, start_col);
+        } else {
+            scanner_jump(s, at + idx + 2);
+            s->mark = start + 2;
+            tok = make_token(s, TK_COMMENT, at + idx - s->mark, start_line, start_col);
+        }
+    } else {
+        int escape = s->resume_escape;
+        while (scanner_peek(s) != EOF && (escape || scanner_peek(s) != quote)) {
+            escape = !escape && scanner_peek(s) == '\\';
+            scanner_advance(s);
+        }
+        if (scanner_peek(s) == EOF) {
+            scanner_stream_suspend_at_end(s, start);
+            s->resume_escape = escape;
+            tok = lex_error(quote == '"' ? "Unterminated string literal" : "Unterminated char literal",
+                            start, start_line, start_col);
+        } else {
+            s->mark = start + 1;
+            tok = make_token(s, quote == '"' ? TK_STRING_LITERAL : TK_CHAR_LITERAL, s->pos - s->mark,
+                             start_line, start_col);
+            scanner_advance(s);
+        }
+    }
+    return tok;
+}
+
+static Token scanner_stream_token(Scanner *s) {
+    for (;;) {
+        /* blanks are no token: a long run of them is never carried */
+        scanner_skip_whitespace(s);
+        size_t pos = s->pos;
+        size_t line = s->line;
+        size_t column = s->column;
+        Token tok = s->resume ? scanner_stream_resume(s) : scanner_scan_token(s);
+        if (s->stream_end || s->len - s->pos >= LEX_STREAM_LOOKAHEAD) {
+            s->resume = LEX_RESUME_NONE;
+            tok.offset += s->base;
+            return tok;
+        }
+        if (!s->resume) {
+            scanner_stream_suspend(s, pos, &tok);
+        }
+        s->pos = pos;
+        s->line = line;
+        s->column = column;
+        scanner_stream_refill(s);
+    }
+}
+
+static Token scanner_next_token(Scanner *s) {
+    Token tok = s->stream ? scanner_stream_token(s) : scanner_scan_token(s);
+    if (s->symbols) {
+        symbol_assign(s->symbols, &tok);
+    }
+    if (s->values) {
+        token_decode_value(&tok);
+    }
+    return tok;
+}
+
+#ifdef LEXER_NO_MAIN
+/* Pull API for parsers: fills batch[0..max) and returns the count; the batch
+ * ends early with TK_EOF.  Buffer-mode lexemes stay valid for the life of
+ * the buffer.  In FILE and stream mode a lexeme lives in the scanner's
+ * scratch text or window only until the next token, so batches there hold
+ * a single token. */
+#define LEX_BATCH 4096
+
+static size_t scanner_next_batch(Scanner *s, Token *batch, size_t max) {
+    size_t n = 0;
+    if ((s->fp || s->stream) && max > 1) {
+        max = 1;
+    }
+    while (n < max) {
+        batch[n] = scanner_next_token(s);
+        if (batch[n++].kind == TK_EOF) break;
+    }
+    return n;
+}
+
+/* Lexing on its own thread.  The producer fills LEX_BATCH-token slots of a
+ * single-producer/single-consumer ring and publishes them by advancing head;
+ * the consumer advances tail when it is done with a slot.  Each index is
+ * written by one side only, so acquire/release ordering is all the
+ * synchronization needed.  A side with nothing to do spins briefly and then
+ * yields.  Buffer mode only (see scanner_next_batch). */
+#define LEX_RING_SLOTS 8
+
+typedef struct {
+    Scanner *scanner;
+    Token *tokens;              /* LEX_RING_SLOTS * LEX_BATCH */
+    size_t counts[LEX_RING_SLOTS];
+    pthread_t thread;
+    int eof;                    /* consumer has taken the EOF batch */
+    int stop;                   /* consumer gave up; producer should exit */
+    size_t head __attribute__((aligned(64)));
+    size_t tail __attribute__((aligned(64)));
+} LexProducer;
+
+static void lex_ring_wait(unsigned *spins) {
+    if (++*spins < 64) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        __builtin_ia32_pause();
+#endif
+    } else {
+        sched_yield();
+    }
+}
+
+static void *lex_producer_main(void *arg) {
+    LexProducer *p = (LexProducer *)arg;
+    size_t head = p->head;
+    for (;;) {
+        unsigned spins = 0;
+        while (head - __atomic_load_n(&p->tail, __ATOMIC_ACQUIRE) == LEX_RING_SLOTS) {
+            if (__atomic_load_n(&p->stop, __ATOMIC_RELAXED)) return NULL;
+            lex_ring_wait(&spins);
+        }
+        size_t slot = head % LEX_RING_SLOTS;
+        Token *batch = p->tokens + slot * LEX_BATCH;
+        size_t n = scanner_next_batch(p->scanner, batch, LEX_BATCH);
+        p->counts[slot] = n;
+        __atomic_store_n(&p->head, ++head, __ATOMIC_RELEASE);
+        if (batch[n - 1].kind == TK_EOF) return NULL;
+    }
+}
+
+/* Starts lexing s on a new thread.  Returns -1 for a FILE-mode or
+ * stream-mode scanner, whose lexemes do not outlive the next refill while
+ * the ring holds batches, or when the thread cannot be started. */
+static int lex_producer_start(LexProducer *p, Scanner *s) {
+    memset(p, 0, sizeof(*p));
+    if (s->fp || s->stream) {
+        return -1;
+    }
+    p->scanner = s;
+    p->tokens = (Token *)malloc(LEX_RING_SLOTS * LEX_BATCH * sizeof(Token));
+    if (!p->tokens) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    if (pthread_create(&p->thread, NULL, lex_producer_main, p) != 0) {
+        free(p->tokens);
+        p->tokens = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/* Next batch, waiting for the producer if needed; NULL once the batch
+ * holding TK_EOF has been released.  The batch stays valid until
+ * lex_producer_release. */
+static const Token *lex_producer_acquire(LexProducer *p, size_t *count) {
+    unsigned spins = 0;
+    if (p->eof) {
+        return NULL;
+    }
+    while (__atomic_load_n(&p->head, __ATOMIC_ACQUIRE) == p->tail) {
+        lex_ring_wait(&spins);
+    }
+    size_t slot = p->tail % LEX_RING_SLOTS;
+    *count = p->counts[slot];
+    const Token *batch = p->tokens + slot * LEX_BATCH;
+    p->eof = batch[*count - 1].kind == TK_EOF;
+    return batch;
+}
+
+static void lex_producer_release(LexProducer *p) {
+    __atomic_store_n(&p->tail, p->tail + 1, __ATOMIC_RELEASE);
+}
+
+/* Joins the producer; safe to call before EOF was reached. */
+static void lex_producer_finish(LexProducer *p) {
+    __atomic_store_n(&p->stop, 1, __ATOMIC_RELAXED);
+    pthread_join(p->thread, NULL);
+    free(p->tokens);
+    p->tokens = NULL;
+}
+#endif
+
+#ifdef LEXER_NO_MAIN
+/* Incremental re-lexing for editors.  A LexDocument owns the text and its
+ * token array, both kept as gap buffers so an edit costs the bytes and tokens
+ * it touches plus the distance from the previous edit, not the file size.
+ * Tokens after the token gap store start and line counted back from len and
+ * line_count, so an edit shifts them without touching them; only tokens on
+ * the line where the new stream rejoins the old one need a column fix.
+ *
+ * A token's extent is decided by its bytes plus one byte of lookahead, so the
+ * first token that can change is the first one with end >= offset; lexing
+ * restarts where the token before it ended.  The text gap is parked at that
+ * token boundary, so the scanner sees everything after it as one buffer.
+ * Lexing from an offset depends only on the text from there on, so once the
+ * new stream reaches the (shifted) start of an old token past the edit, the
+ * rest is unchanged. */
+#define LEX_DOC_GAP 4096
+
+typedef struct {
+    size_t start;       /* absolute, or len - start after the gap */
+    size_t extent;      /* bytes from start to the end of the token */
+    size_t line;        /* absolute, or line_count - line after the gap */
+    size_t column;
+    size_t lexeme_at;   /* lexeme offset - start */
+    size_t length;
+    const char *fixed;  /* static lexeme of error/EOF tokens, NULL for slices */
+    TokenKind kind;
+    int keyword;
+} LexDocToken;
+
+typedef struct {
+    char *text;         /* text[0, gap_at), gap_len free bytes, then the rest */
+    size_t len;
+    size_t gap_at;
+    size_t gap_len;
+    size_t line_count;  /* 1 + number of newlines */
+    LexDocToken *toks;
+    size_t gap;         /* toks[0, gap) before the gap */
+    size_t gap_end;     /* toks[gap_end, tok_cap) after it */
+    size_t tok_cap;
+} LexDocument;
+
+/* Result of an edit: tokens [first, first + removed) of the old array were
+ * replaced by tokens [first, first + inserted) of the new one. */
+typedef struct {
+    size_t first;
+    size_t removed;
+    size_t inserted;
+} LexEdit;
+
+static size_t lex_doc_count(const LexDocument *doc) {
+    return doc->gap + (doc->tok_cap - doc->gap_end);
+}
+
+static const LexDocToken *lex_doc_slot(const LexDocument *doc, size_t i) {
+    return i < doc->gap ? &doc->toks[i] : &doc->toks[doc->gap_end + (i - doc->gap)];
+}
+
+static size_t lex_doc_start(const LexDocument *doc, size_t i) {
+    const LexDocToken *t = lex_doc_slot(doc, i);
+    return i < doc->gap ? t->start : doc->len - t->start;
+}
+
+static size_t lex_doc_line(const LexDocument *doc, size_t i) {
+    const LexDocToken *t = lex_doc_slot(doc, i);
+    return i < doc->gap ? t->line : doc->line_count - t->line;
+}
+
+/* Text at pos; a range starting there is contiguous as long as it does not
+ * cross the gap, which holds for every token. */
+static const char *lex_doc_at(const LexDocument *doc, size_t pos) {
+    return doc->text + pos + (pos < doc->gap_at ? 0 : doc->gap_len);
+}
+
+/* Token i with absolute position; slices point into the document and stay
+ * valid until the next edit. */
+static Token lex_doc_token(const LexDocument *doc, size_t i) {
+    const LexDocToken *t = lex_doc_slot(doc, i);
+    size_t start = lex_doc_start(doc, i);
+    Token tok = make_simple_token(t->kind, t->fixed ? t->fixed : lex_doc_at(doc, start + t->lexeme_at),
+                                  t->length, start + t->lexeme_at, lex_doc_line(doc, i), t->column);
+    tok.keyword = t->keyword;
+    return tok;
+}
+
+/* Moves the token gap so that it sits before token i. */
+static void lex_doc_move_gap(LexDocument *doc, size_t i) {
+    while (doc->gap > i) {
+        LexDocToken *t = &doc->toks[--doc->gap_end];
+        *t = doc->toks[--doc->gap];
+        t->start = doc->len - t->start;
+        t->line = doc->line_count - t->line;
+    }
+    while (doc->gap < i) {
+        LexDocToken *t = &doc->toks[doc->gap++];
+        *t = doc->toks[doc->gap_end++];
+        t->start = doc->len - t->start;
+        t->line = doc->line_count - t->line;
+    }
+}
+
+static void lex_doc_move_text_gap(LexDocument *doc, size_t at) {
+    if (at < doc->gap_at) {
+        memmove(doc->text + at + doc->gap_len, doc->text + at, doc->gap_at - at);
+    } else {
+        memmove(doc->text + doc->gap_at, doc->text + doc->gap_at + doc->gap_len, at - doc->gap_at);
+    }
+    doc->gap_at = at;
+}
+
+/* The whole text as one buffer (moves the text gap to the end). */
+static const char *lex_doc_text(LexDocument *doc) {
+    lex_doc_move_text_gap(doc, doc->len);
+    return doc->text;
+}
+
+/* Appends a token before the gap, growing the array when the gap is full. */
+static void lex_doc_push(LexDocument *doc, const Scanner *s, const Token *tok, size_t start) {
+    if (doc->gap == doc->gap_end) {
+        size_t cap = doc->tok_cap ? doc->tok_cap * 2 : 1024;
+        LexDocToken *grown = (LexDocToken *)realloc(doc->toks, cap * sizeof(*grown));
+        if (!grown) {
+            fprintf(stderr, "out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        size_t after = doc->tok_cap - doc->gap_end;
+        memmove(grown + cap - after, grown + doc->gap_end, after * sizeof(*grown));
+        doc->toks = grown;
+        doc->gap_end = cap - after;
+        doc->tok_cap = cap;
+    }
+    LexDocToken *t = &doc->toks[doc->gap++];
+    t->start = start;
+    t->extent = s->pos - start;
+    t->line = tok->line;
+    t->column = tok->column;
+    t->lexeme_at = tok->offset - start;
+    t->length = tok->length;
+    t->fixed = tok->lexeme == s->buf + tok->offset ? NULL : tok->lexeme;
+    t->kind = tok->kind;
+    t->keyword = tok->keyword;
+}
+
+static size_t lex_doc_newlines(const char *p, size_t n, size_t *last) {
+    *last = 0;
+    return n ? lex_kernels->count_newlines((const unsigned char *)p, n, last) : 0;
+}
+
+/* Lexes from pos (which must be the text gap) and pushes tokens until the
+ * stream meets an old token start at or after sync_from.  Returns the number
+ * of tokens pushed and sets *dropped to the old tokens it passed. */
+static size_t lex_doc_relex(LexDocument *doc, size_t pos, size_t line, size_t column,
+                            size_t sync_from, size_t *dropped) {
+    Scanner scanner;
+    size_t pushed = 0;
+    scanner_init_buffer_at(&scanner, doc->text + doc->gap_len, doc->len, pos, line, column);
+    for (;;) {
+        scanner_skip_whitespace(&scanner);
+        size_t start = scanner.pos;
+        while (doc->gap_end < doc->tok_cap && doc->len - doc->toks[doc->gap_end].start < start) {
+            doc->gap_end++;
+            (*dropped)++;
+        }
+        if (doc->gap_end < doc->tok_cap && doc->len - doc->toks[doc->gap_end].start == start &&
+            start >= sync_from) {
+            /* later tokens on the rejoin line moved sideways */
+            size_t rel_line = doc->toks[doc->gap_end].line;
+            size_t old_col = doc->toks[doc->gap_end].column;
+            for (size_t k = doc->gap_end; k < doc->tok_cap && doc->toks[k].line == rel_line; ++k) {
+                doc->toks[k].column = doc->toks[k].column - old_col + scanner.column;
+            }
+            return pushed;
+        }
+        Token tok = scanner_next_token(&scanner);
+        lex_doc_push(doc, &scanner, &tok, start);
+        pushed++;
+        if (tok.kind == TK_EOF) break;
+    }
+    *dropped += doc->tok_cap - doc->gap_end;
+    doc->gap_end = doc->tok_cap;
+    return pushed;
+}
+
+static void lex_doc_init(LexDocument *doc, const char *text, size_t len) {
+    size_t last = 0;
+    memset(doc, 0, sizeof(*doc));
+    doc->gap_len = LEX_DOC_GAP;
+    doc->text = (char *)malloc(doc->gap_len + len);
+    if (!doc->text) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(doc->text + doc->gap_len, text, len);
+    doc->len = len;
+    doc->line_count = 1 + lex_doc_newlines(text, len, &last);
+    size_t dropped = 0;
+    lex_doc_relex(doc, 0, 1, 1, len + 1, &dropped);
+}
+
+static void lex_doc_free(LexDocument *doc) {
+    free(doc->text);
+    free(doc->toks);
+    memset(doc, 0, sizeof(*doc));
+}
+
+/* Replaces removed bytes at offset with inserted bytes of text and re-lexes
+ * the tokens that changed.  Returns -1 (document unchanged) for a range
+ * outside the text. */
+static int lex_doc_edit(LexDocument *doc, size_t offset, size_t removed,
+                        const char *text, size_t inserted, LexEdit *edit) {
+    if (offset > doc->len || removed > doc->len - offset) {
+        return -1;
+    }
+
+    /* first token that can change: binary search on end >= offset */
+    size_t lo = 0, hi = lex_doc_count(doc) - 1;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (lex_doc_start(doc, mid) + lex_doc_slot(doc, mid)->extent < offset) lo = mid + 1; else hi = mid;
+    }
+    size_t first = lo;
+
+    /* restart where the previous token ended; it does not reach the edit */
+    size_t pos = 0, line = 1, column = 1;
+    if (first > 0) {
+        const LexDocToken *t = lex_doc_slot(doc, first - 1);
+        size_t start = lex_doc_start(doc, first - 1);
+        size_t last = 0;
+        size_t lines = lex_doc_newlines(lex_doc_at(doc, start), t->extent, &last);
+        pos = start + t->extent;
+        line = lex_doc_line(doc, first - 1) + lines;
+        column = lines ? t->extent - last : t->column + t->extent;
+    }
+
+    /* drop old tokens that overlap the replaced bytes */
+    lex_doc_move_gap(doc, first);
+    size_t dropped = 0;
+    while (doc->gap_end < doc->tok_cap && doc->len - doc->toks[doc->gap_end].start < offset + removed) {
+        doc->gap_end++;
+        dropped++;
+    }
+
+    /* splice the text at the gap */
+    size_t last = 0;
+    lex_doc_move_text_gap(doc, offset);
+    doc->line_count -= lex_doc_newlines(doc->text + doc->gap_at + doc->gap_len, removed, &last);
+    doc->gap_len += removed;
+    doc->len -= removed;
+    if (doc->gap_len < inserted) {
+        size_t after = doc->len - doc->gap_at;
+        size_t cap = 2 * (doc->len + inserted) + LEX_DOC_GAP;
+        char *grown = (char *)realloc(doc->text, cap);
+        if (!grown) {
+            fprintf(stderr, "out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        memmove(grown + cap - after, grown + doc->gap_at + doc->gap_len, after);
+        doc->text = grown;
+        doc->gap_len = cap - doc->len;
+    }
+    memcpy(doc->text + doc->gap_at, text, inserted);
+    doc->gap_at += inserted;
+    doc->gap_len -= inserted;
+    doc->len += inserted;
+    doc->line_count += lex_doc_newlines(text, inserted, &last);
+    lex_doc_move_text_gap(doc, pos);
+
+    size_t pushed = lex_doc_relex(doc, pos, line, column, offset + inserted, &dropped);
+    if (edit) {
+        edit->first = first;
+        edit->removed = dropped;
+        edit->inserted = pushed;
+    }
+    return 0;
+}
+#endif
+
+#ifndef LEXER_NO_MAIN
+/* --profile: exact per-kind token counts and byte totals, plus cycle counts
+ * for a random 1-in-LEX_PROFILE_RATE sample of tokens.  Reading the cycle
+ * counter around every token would cost more than scanning most of them, so
+ * the sampled cycles are scaled up by count / samples in the report. */
+#define LEX_PROFILE_RATE 16
+
+typedef struct {
+    size_t count[TK_EOF + 1];
+    size_t bytes[TK_EOF + 1];
+    size_t samples[TK_EOF + 1];
+    unsigned long long cycles[TK_EOF + 1];
+    size_t space_bytes;             /* whitespace skipped before tokens */
+    unsigned long long space_cycles;
+    unsigned long long output_cycles;
+    size_t sampled;                 /* tokens timed, all kinds */
+    unsigned rng;
+} LexProfile;
+
+static int lex_profile = 0;
+
+static unsigned long long lex_cycles(void) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_ia32_rdtsc();
+#elif defined(__GNUC__) && defined(__aarch64__)
+    unsigned long long v;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return (unsigned long long)(lex_now() * 1e9);
+#endif
+}
+
+/* Random rather than every Nth token, so periodic input cannot line the
+ * samples up with one token kind. */
+static int lex_profile_sample(LexProfile *prof) {
+    prof->rng = prof->rng * 1103515245u + 12345u;
+    return (prof->rng >> 16) % LEX_PROFILE_RATE == 0;
+}
+
+static void lex_profile_add(LexProfile *into, const LexProfile *from) {
+    for (int k = 0; k <= TK_EOF; ++k) {
+        into->count[k] += from->count[k];
+        into->bytes[k] += from->bytes[k];
+        into->samples[k] += from->samples[k];
+        into->cycles[k] += from->cycles[k];
+    }
+    into->space_bytes += from->space_bytes;
+    into->space_cycles += from->space_cycles;
+    into->output_cycles += from->output_cycles;
+    into->sampled += from->sampled;
+}
+
+/* Hand-written routine behind each kind when the DFA table is off. */
+static const char *lex_profile_routine(TokenKind kind) {
+    if (lex_use_table) return "scan_with_table";
+    switch (kind) {
+        case TK_IDENTIFIER:
+        case TK_KEYWORD: return "scan_identifier_or_keyword";
+        case TK_INT_LITERAL:
+        case TK_HEX_LITERAL:
+        case TK_FLOAT_LITERAL: return "scan_number";
+        case TK_STRING_LITERAL: return "scan_string_literal";
+        case TK_CHAR_LITERAL: return "scan_char_literal";
+        case TK_OPERATOR:
+        case TK_COMMENT: return "scan_comment_or_operator";
+        default: return "scanner_scan_token";
+    }
+}
+
+/* cycles_per_sec comes from timing the whole run against lex_now(). */
+static void lex_profile_report(FILE *out, const LexProfile *prof, double cycles_per_sec) {
+    size_t tokens = 0;
+    for (int k = 0; k <= TK_EOF; ++k) tokens += prof->count[k];
+    if (tokens == 0 || prof->sampled == 0 || cycles_per_sec <= 0) {
+        fprintf(out, "profile: too few tokens sampled\n");
+        return;
+    }
+    double scale = (double)tokens / (double)prof->sampled;
+    double est[TK_EOF + 1];
+    double space = (double)prof->space_cycles * scale;
+    double output = (double)prof->output_cycles * scale;
+    double total = space + output;
+    for (int k = 0; k <= TK_EOF; ++k) {
+        est[k] = prof->samples[k] ? (double)prof->cycles[k] * (double)prof->count[k] / (double)prof->samples[k] : 0;
+        total += est[k];
+    }
+    fprintf(out, "profile: %zu of %zu tokens sampled, cycle counter %.2f GHz\n",
+            prof->sampled, tokens, cycles_per_sec / 1e9);
+    fprintf(out, "  %-8s %-27s %12s %12s %10s %9s %6s\n",
+            "kind", "routine", "tokens", "bytes", "cyc/token", "est. ms", "share");
+    for (int k = 0; k <= TK_EOF; ++k) {
+        if (prof->count[k] == 0) continue;
+        fprintf(out, "  %-8s %-27s %12zu %12zu %10.1f %9.2f %5.1f%%\n",
+                token_kind_name((TokenKind)k), lex_profile_routine((TokenKind)k),
+                prof->count[k], prof->bytes[k],
+                prof->samples[k] ? (double)prof->cycles[k] / (double)prof->samples[k] : 0.0,
+                est[k] / cycles_per_sec * 1e3, 100.0 * est[k] / total);
+    }
+    fprintf(out, "  %-8s %-27s %12s %12zu %10.1f %9.2f %5.1f%%\n", "space", "scanner_skip_whitespace", "-",
+            prof->space_bytes, (double)prof->space_cycles / (double)prof->sampled,
+            space / cycles_per_sec * 1e3, 100.0 * space / total);
+    fprintf(out, "  %-8s %-27s %12s %12s %10.1f %9.2f %5.1f%%\n", "output", "print_token", "-", "-",
+            (double)prof->output_cycles / (double)prof->sampled,
+            output / cycles_per_sec * 1e3, 100.0 * output / total);
+}
+
+/* --cache DIR: a content-addressed token cache shared by runs and by
+ * parallel build jobs.  An entry is named after a 64-bit key, the hash of the
+ * file contents seeded with lex_cache_config (cache/stream versions, keyword
+ * table, DFA tables), and holds the file's binary token records behind a
+ * small header.  Entries are written to a temporary name and renamed into
+ * place, so readers only ever see complete files.  A hit bumps the entry's
+ * mtime, which makes mtime order LRU order for eviction; eviction runs after
+ * a run that stored something and trims the directory back under
+ * lex_cache_limit.  A concurrent reader keeps its mapping when an entry is
+ * evicted under it (POSIX); every failure just means a miss. */
+#define LEX_CACHE_MAGIC "CTOC"
+#define LEX_CACHE_VERSION 1
+#define LEX_CACHE_HEADER 48     /* magic, version, 3 pad, key, size, tokens, errors, checksum */
+
+static const char *lex_cache_dir = NULL;
+static size_t lex_cache_limit = 256u << 20;
+static unsigned long long lex_cache_config = 0;
+static size_t lex_cache_written = 0;   /* bytes stored this run, atomically */
+static unsigned lex_cache_serial = 0;
+
+/* XXH64: four independent lanes of 8-byte multiply-rotate rounds. */
+#define HASH_P1 0x9E3779B185EBCA87ull
+#define HASH_P2 0xC2B2AE3D27D4EB4Full
+#define HASH_P3 0x165667B19E3779F9ull
+#define HASH_P4 0x85EBCA77C2B2AE63ull
+#define HASH_P5 0x27D4EB2F165667C5ull
+#define HASH_ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static unsigned long long hash_load64(const unsigned char *p) {
+    unsigned long long v;
+    memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static unsigned long long hash_round(unsigned long long acc, unsigned long long input) {
+    acc += input * HASH_P2;
+    acc = HASH_ROTL(acc, 31);
+    return acc * HASH_P1;
+}
+
+static unsigned long long hash_merge(unsigned long long acc, unsigned long long lane) {
+    acc ^= hash_round(0, lane);
+    return acc * HASH_P1 + HASH_P4;
+}
+
+static unsigned long long lex_hash64(const void *data, size_t len, unsigned long long seed) {
+    const unsigned char *p = (const unsigned char *)data;
+    const unsigned char *end = p + len;
+    unsigned long long h;
+    if (len >= 32) {
+        unsigned long long v1 = seed + HASH_P1 + HASH_P2;
+        unsigned long long v2 = seed + HASH_P2;
+        unsigned long long v3 = seed;
+        unsigned long long v4 = seed - HASH_P1;
+        do {
+            v1 = hash_round(v1, hash_load64(p));
+            v2 = hash_round(v2, hash_load64(p + 8));
+            v3 = hash_round(v3, hash_load64(p + 16));
+            v4 = hash_round(v4, hash_load64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+        h = HASH_ROTL(v1, 1) + HASH_ROTL(v2, 7) + HASH_ROTL(v3, 12) + HASH_ROTL(v4, 18);
+        h = hash_merge(h, v1);
+        h = hash_merge(h, v2);
+        h = hash_merge(h, v3);
+        h = hash_merge(h, v4);
+    } else {
+        h = seed + HASH_P5;
+    }
+    h += (unsigned long long)len;
+    for (; end - p >= 8; p += 8) {
+        h ^= hash_round(0, hash_load64(p));
+        h = HASH_ROTL(h, 27) * HASH_P1 + HASH_P4;
+    }
+    if (end - p >= 4) {
+        unsigned long long w = (unsigned long long)p[0] | (unsigned long long)p[1] << 8 |
+                               (unsigned long long)p[2] << 16 | (unsigned long long)p[3] << 24;
+        h ^= w * HASH_P1;
+        h = HASH_ROTL(h, 23) * HASH_P2 + HASH_P3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= *p * HASH_P5;
+        h = HASH_ROTL(h, 11) * HASH_P1;
+    }
+    h ^= h >> 33;
+    h *= HASH_P2;
+    h ^= h >> 29;
+    h *= HASH_P3;
+    h ^= h >> 32;
+    return h;
+}
+
+/* Everything besides the input that decides the token records. */
+static void lex_cache_init_config(void) {
+    unsigned long long h = lex_hash64(LEX_CACHE_MAGIC, 4, LEX_CACHE_VERSION * 0x100 + TOKSTREAM_VERSION);
+    for (size_t i = 0; keywords[i]; ++i) {
+        h = lex_hash64(keywords[i], strlen(keywords[i]) + 1, h);
+    }
+    h = lex_hash64(lexer_dfa_accept, sizeof(lexer_dfa_accept), h);
+    h = lex_hash64(lexer_dfa_accel, sizeof(lexer_dfa_accel), h);
+    h = lex_hash64(lexer_dfa_next, sizeof(lexer_dfa_next), h);
+    lex_cache_config = h;
+}
+
+static void lex_store_u64(unsigned char *p, unsigned long long v) {
+    for (int i = 0; i < 8; ++i) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static unsigned long long lex_load_u64(const unsigned char *p) {
+    unsigned long long v = 0;
+    for (int i = 0; i < 8; ++i) v |= (unsigned long long)p[i] << (8 * i);
+    return v;
+}
+
+typedef struct {
+    unsigned long long key;
+    size_t size;            /* source bytes */
+    size_t tokens;
+    size_t errors;
+    const unsigned char *records;
+    size_t records_len;
+    SourceBuffer file;
+} LexCacheEntry;
+
+static void lex_cache_entry_path(char *dst, size_t cap, unsigned long long key) {
+    snprintf(dst, cap, "%s/%016llx.tok", lex_cache_dir, key);
+}
+
+/* Maps the entry for key; 0 on a hit. */
+static int lex_cache_lookup(LexCacheEntry *entry, unsigned long long key, size_t size) {
+    char path[4096];
+    lex_cache_entry_path(path, sizeof(path), key);
+    if (source_open(&entry->file, path) != 0) {
+        /* 1 leaves the descriptor of an unmappable entry open */
+        source_close(&entry->file);
+        return -1;
+    }
+    const unsigned char *p = (const unsigned char *)entry->file.data;
+    if (entry->file.size < LEX_CACHE_HEADER || memcmp(p, LEX_CACHE_MAGIC, 4) != 0 ||
+        p[4] != LEX_CACHE_VERSION || lex_load_u64(p + 8) != key || lex_load_u64(p + 16) != size ||
+        lex_load_u64(p + 40) != lex_hash64(p + LEX_CACHE_HEADER, entry->file.size - LEX_CACHE_HEADER, key)) {
+        source_close(&entry->file);
+        return -1;
+    }
+    entry->key = key;
+    entry->size = size;
+    entry->tokens = (size_t)lex_load_u64(p + 24);
+    entry->errors = (size_t)lex_load_u64(p + 32);
+    entry->records = p + LEX_CACHE_HEADER;
+    entry->records_len = entry->file.size - LEX_CACHE_HEADER;
+#ifdef _WIN32
+    _utime(path, NULL);
+#else
+    utime(path, NULL);
+#endif
+    return 0;
+}
+
+static void lex_cache_store(unsigned long long key, size_t size, size_t tokens, size_t errors,
+                            const OutBuf *records) {
+    char path[4096], tmp[4096];
+    lex_cache_entry_path(path, sizeof(path), key);
+    unsigned serial = __atomic_fetch_add(&lex_cache_serial, 1, __ATOMIC_RELAXED);
+    snprintf(tmp, sizeof(tmp), "%s/.tmp-%ld-%u-%016llx", lex_cache_dir, (long)getpid(), serial, key);
+    unsigned char header[LEX_CACHE_HEADER] = {0};
+    memcpy(header, LEX_CACHE_MAGIC, 4);
+    header[4] = LEX_CACHE_VERSION;
+    lex_store_u64(header + 8, key);
+    lex_store_u64(header + 16, size);
+    lex_store_u64(header + 24, tokens);
+    lex_store_u64(header + 32, errors);
+    lex_store_u64(header + 40, lex_hash64(records->data, records->len, key));
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        return;
+    }
+    int ok = fwrite(header, 1, sizeof(header), fp) == sizeof(header) &&
+             fwrite(records->data, 1, records->len, fp) == records->len;
+    ok = fclose(fp) == 0 && ok;
+#ifdef _WIN32
+    ok = ok && MoveFileExA(tmp, path, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(tmp, path) == 0;
+#endif
+    if (!ok) {
+        remove(tmp);
+        return;
+    }
+    __atomic_fetch_add(&lex_cache_written, sizeof(header) + records->len, __ATOMIC_RELAXED);
+}
+
+typedef struct {
+    char *name;
+    size_t size;
+    time_t mtime;
+} LexCacheFile;
+
+static int lex_cache_file_older(const void *a, const void *b) {
+    const LexCacheFile *x = (const LexCacheFile *)a;
+    const LexCacheFile *y = (const LexCacheFile *)b;
+    return (x->mtime > y->mtime) - (x->mtime < y->mtime);
+}
+
+/* Deletes least recently used entries until the directory is back under
+ * 7/8 of the limit, and temporary files a crashed writer left behind. */
+static void lex_cache_evict(void) {
+    DIR *dir = opendir(lex_cache_dir);
+    if (!dir) {
+        return;
+    }
+    LexCacheFile *files = NULL;
+    size_t count = 0, cap = 0, total = 0;
+    time_t now = time(NULL);
+    char path[4096];
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        size_t n = strlen(ent->d_name);
+        int temp = strncmp(ent->d_name, ".tmp-", 5) == 0;
+        if (!temp && (n < 4 || strcmp(ent->d_name + n - 4, ".tok") != 0)) continue;
+        snprintf(path, sizeof(path), "%s/%s", lex_cache_dir, ent->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0) continue;
+        if (temp) {
+            if (now - st.st_mtime > 3600) remove(path);
+            continue;
+        }
+        if (count == cap) {
+            cap = cap ? cap * 2 : 256;
+            LexCacheFile *grown = (LexCacheFile *)realloc(files, cap * sizeof(*files));
+            if (!grown) {
+                fprintf(stderr, "out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+            files = grown;
+        }
+        files[count].name = strdup(ent->d_name);
+        files[count].size = (size_t)st.st_size;
+        files[count].mtime = st.st_mtime;
+        total += (size_t)st.st_size;
+        count++;
+    }
+    closedir(dir);
+    if (total > lex_cache_limit) {
+        qsort(files, count, sizeof(*files), lex_cache_file_older);
+        size_t target = lex_cache_limit - lex_cache_limit / 8;
+        for (size_t i = 0; i < count && total > target; ++i) {
+            snprintf(path, sizeof(path), "%s/%s", lex_cache_dir, files[i].name);
+            if (remove(path) == 0 || errno == ENOENT) {
+                total -= files[i].size;
+            }
+        }
+    }
+    for (size_t i = 0; i < count; ++i) free(files[i].name);
+    free(files);
+}
+
+/* One input of a lexer run.  Tokens and diagnostics are formatted into out
+ * and err so parallel jobs can be written back in input order. */
+typedef struct {
+    const char *path;
+    OutBuf out;
+    OutBuf err;
+    size_t bytes;
+    size_t tokens;
+    int failed;
+    size_t symbols;         /* interning figures, with lex_intern set */
+    size_t lookups;
+    size_t hits;
+    size_t arena_bytes;
+    LexProfile profile;     /* with lex_profile set */
+    OutBuf *records;        /* --cache miss: binary records for the entry */
+    size_t errors;
+    int cache_hit;
+    int cache_bypass;       /* --cache set but not consulted: a stream, or --profile */
+} LexJob;
+
+/* Intern names and literals per input (--stats reports the table). */
+static int lex_intern = 0;
+/* Decode numeric literals (--values); out-of-range ones get a warning. */
+static int lex_values = 0;
+
+static void lex_job_fail(LexJob *job) {
+    const char *reason = strerror(errno);
+    outbuf_printf(&job->err, strlen(job->path) + strlen(reason) + 4, "%s: %s\n", job->path, reason);
+    job->failed = 1;
+}
+
+static void lex_job_warn_value(LexJob *job, const Token *tok, int prefix_errors) {
+    const char *what = tok->value_status == TV_MALFORMED ? "malformed" : "out of range";
+    const char *kind = tok->kind == TK_FLOAT_LITERAL ? "floating" : "integer";
+    outbuf_printf(&job->err, tok->length + strlen(job->path) + 96,
+                  "%s%sLexical warning at line %zu col %zu: %s literal %s: %.*s\n",
+                  prefix_errors ? job->path : "", prefix_errors ? ": " : "",
+                  tok->line, tok->column, kind, what, (int)tok->length, tok->lexeme);
+    if (job->err.sink) {
+        outbuf_flush(&job->out);
+        outbuf_flush(&job->err);
+    }
+}
+
+static void lex_job_error(LexJob *job, const Token *tok, int prefix_errors) {
+    job->errors++;
+    outbuf_printf(&job->err, tok->length + strlen(job->path) + 96,
+                  "%s%sLexical error at line %zu col %zu: %.*s\n",
+                  prefix_errors ? job->path : "", prefix_errors ? ": " : "",
+                  tok->line, tok->column, (int)tok->length, tok->lexeme);
+    if (job->err.sink) {
+        outbuf_flush(&job->out);
+        outbuf_flush(&job->err);
+    }
+}
+
+/* The token loop, specialised by inlining: with prof a constant NULL every
+ * profiling branch folds away and the plain loop carries no extra work. */
+static inline __attribute__((always_inline))
+void lex_job_scan(LexJob *job, Scanner *s, LineIndex *lines, int prefix_errors, LexProfile *prof) {
+    for (;;) {
+        Token tok;
+        if (prof) {
+            size_t ws = s->pos;
+            int timed = lex_profile_sample(prof);
+            unsigned long long c0 = timed ? lex_cycles() : 0;
+            scanner_skip_whitespace(s);
+            unsigned long long c1 = timed ? lex_cycles() : 0;
+            size_t start = s->pos;
+            tok = scanner_next_token(s);
+            if (lines) line_index_resolve(lines, &tok);
+            prof->count[tok.kind]++;
+            prof->bytes[tok.kind] += s->pos - start;
+            prof->space_bytes += start - ws;
+            if (timed) {
+                unsigned long long c2 = lex_cycles();
+                print_token(&job->out, &tok);
+                prof->output_cycles += lex_cycles() - c2;
+                prof->space_cycles += c1 - c0;
+                prof->cycles[tok.kind] += c2 - c1;
+                prof->samples[tok.kind]++;
+                prof->sampled++;
+            } else {
+                print_token(&job->out, &tok);
+            }
+        } else {
+            tok = scanner_next_token(s);
+            if (lines) line_index_resolve(lines, &tok);
+            print_token(&job->out, &tok);
+        }
+        if (job->records) print_token_binary(job->records, &tok);
+        job->tokens++;
+        if (tok.kind == TK_EOF) {
+            break;
+        }
+        if (tok.kind == TK_ERROR) {
+            lex_job_error(job, &tok, prefix_errors);
+        } else if (tok.value_status > TV_OK) {
+            lex_job_warn_value(job, &tok, prefix_errors);
+        }
+    }
+}
+
+/* Output for a cache hit.  Binary output is the stored records verbatim
+ * unless diagnostics or interning need the tokens decoded. */
+static void lex_job_replay(LexJob *job, const LexCacheEntry *entry, int prefix_errors, SymbolTable *symbols) {
+    job->bytes = entry->size;
+    job->tokens = entry->tokens;
+    job->cache_hit = 1;
+    if (lex_format == LEX_FORMAT_BINARY && entry->errors == 0 && !symbols && !lex_values) {
+        outbuf_write(&job->out, (const char *)entry->records, entry->records_len);
+        return;
+    }
+    TokenReader reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.p = entry->records;
+    reader.end = entry->records + entry->records_len;
+    Token tok;
+    while (token_reader_next(&reader, &tok) == TOKSTREAM_TOKEN) {
+        if (symbols) symbol_assign(symbols, &tok);
+        if (lex_values) token_decode_value(&tok);
+        if (lex_format != LEX_FORMAT_BINARY) print_token(&job->out, &tok);
+        if (tok.kind == TK_ERROR) {
+            lex_job_error(job, &tok, prefix_errors);
+        } else if (tok.value_status > TV_OK) {
+            lex_job_warn_value(job, &tok, prefix_errors);
+        }
+    }
+    if (lex_format == LEX_FORMAT_BINARY) {
+        outbuf_write(&job->out, (const char *)entry->records, entry->records_len);
+    }
+}
+
+/* Scans an opened input (mapped when rc is 0, streamed when 1).  With key
+ * set, the binary records are collected and stored in the cache. */
+static void lex_job_lex(LexJob *job, const SourceBuffer *src, int rc, int prefix_errors,
+                        SymbolTable *symbols, const unsigned long long *key) {
+    Scanner scanner;
+    LexStream stream;
+    LineIndex lines = {0};
+    if (rc == 0) {
+        /* positions come from a newline index, off the scanning loop */
+        scanner_init_offsets(&scanner, src->data, src->size);
+        line_index_build(&lines, src->data, src->size);
+    } else {
+        if (lex_stream_open(&stream, job->path, src->fd) != 0) {
+            lex_job_fail(job);
+            return;
+        }
+        scanner_init_stream(&scanner, &stream);
+    }
+    scanner.symbols = symbols;
+    scanner.values = lex_values;
+    OutBuf records;
+    if (key) {
+        outbuf_init(&records, NULL);
+        job->records = &records;
+    }
+
+    if (lex_profile) {
+        job->profile.rng = 0x2545f491u;
+        lex_job_scan(job, &scanner, rc ? NULL : &lines, prefix_errors, &job->profile);
+    } else {
+        lex_job_scan(job, &scanner, rc ? NULL : &lines, prefix_errors, NULL);
+    }
+
+    job->bytes = scanner.base + scanner.pos;
+    if (key) {
+        lex_cache_store(*key, src->size, job->tokens, job->errors, &records);
+        outbuf_free(&records);
+        job->records = NULL;
+    }
+    scanner_free(&scanner);
+    if (rc) {
+        int error = stream.error;
+        lex_stream_close(&stream);
+        if (error) {
+            errno = error;
+            lex_job_fail(job);
+        }
+    } else {
+        line_index_free(&lines);
+    }
+}
+
+static void lex_job_run(LexJob *job, int prefix_errors) {
+    SourceBuffer src;
+    int rc = source_open(&src, job->path);
+    if (rc < 0) {
+        lex_job_fail(job);
+        return;
+    }
+    SymbolTable symbols;
+    if (lex_intern) {
+        symbol_table_init(&symbols);
+    }
+    /* pipes are not cached, and profiling wants the scan */
+    if (lex_cache_dir && rc == 0 && !lex_profile) {
+        unsigned long long key = lex_hash64(src.data, src.size, lex_cache_config);
+        LexCacheEntry entry;
+        if (lex_cache_lookup(&entry, key, src.size) == 0) {
+            lex_job_replay(job, &entry, prefix_errors, lex_intern ? &symbols : NULL);
+            source_close(&entry.file);
+        } else {
+            lex_job_lex(job, &src, rc, prefix_errors, lex_intern ? &symbols : NULL, &key);
+        }
+    } else {
+        job->cache_bypass = lex_cache_dir != NULL;
+        lex_job_lex(job, &src, rc, prefix_errors, lex_intern ? &symbols : NULL, NULL);
+    }
+    source_close(&src);
+    if (lex_intern) {
+        job->symbols = symbols.count;
+        job->lookups = symbols.lookups;
+        job->hits = symbols.hits;
+        job->arena_bytes = symbols.arena_bytes;
+        symbol_table_free(&symbols);
+    }
+}
+
+typedef struct {
+    char **paths;
+    size_t count;
+    size_t cap;
+} PathList;
+
+static void path_list_add(PathList *list, const char *path) {
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 64;
+        char **grown = (char **)realloc(list->paths, cap * sizeof(*grown));
+        if (!grown) {
+            fprintf(stderr, "out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        list->paths = grown;
+        list->cap = cap;
+    }
+    size_t len = strlen(path);
+    char *copy = (char *)malloc(len + 1);
+    if (!copy) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, path, len + 1);
+    list->paths[list->count++] = copy;
+}
+
+static void path_list_free(PathList *list) {
+    for (size_t i = 0; i < list->count; ++i) {
+        free(list->paths[i]);
+    }
+    free(list->paths);
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int is_source_name(const char *name) {
+    const char *dot = strrchr(name, '.');
+    return dot && (strcmp(dot, ".c") == 0 || strcmp(dot, ".h") == 0);
+}
+
+/* Adds the .c/.h files below dir, sorted by name at every level so the
+ * order (and therefore the output) does not depend on readdir. */
+static void collect_directory(PathList *list, const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        perror(dir);
+        return;
+    }
+    PathList entries = {0};
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+        size_t len = strlen(dir) + strlen(ent->d_name) + 2;
+        char *full = (char *)malloc(len);
+        if (!full) {
+            fprintf(stderr, "out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        size_t dir_len = strlen(dir);
+        int has_slash = dir_len > 0 && (dir[dir_len - 1] == '/' || dir[dir_len - 1] == '\\');
+        snprintf(full, len, "%s%s%s", dir, has_slash ? "" : "/", ent->d_name);
+        path_list_add(&entries, full);
+        free(full);
+    }
+    closedir(d);
+    if (entries.count) {
+        qsort(entries.paths, entries.count, sizeof(*entries.paths), compare_paths);
+    }
+    for (size_t i = 0; i < entries.count; ++i) {
+        struct stat st;
+        if (stat(entries.paths[i], &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            collect_directory(list, entries.paths[i]);
+        } else if (is_source_name(entries.paths[i])) {
+            path_list_add(list, entries.paths[i]);
+        }
+    }
+    path_list_free(&entries);
+}
+
+/* A path argument is a file, a directory, or @list: one path per line. */
+static void collect_inputs(PathList *list, const char *arg) {
+    if (arg[0] == '@') {
+        FILE *fp = fopen(arg + 1, "r");
+        if (!fp) {
+            perror(arg + 1);
+            return;
+        }
+        char line[4096];
+        while (fgets(line, sizeof(line), fp)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0]) collect_inputs(list, line);
+        }
+        fclose(fp);
+        return;
+    }
+    struct stat st;
+    if (stat(arg, &st) == 0 && S_ISDIR(st.st_mode)) {
+        collect_directory(list, arg);
+    } else {
+        path_list_add(list, arg);
+    }
+}
+#endif
+
+static int lex_default_threads(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+#ifndef LEXER_NO_MAIN
+/* Workers claim jobs in input order; the writer thread waits for job i
+ * before writing it, so output order never depends on scheduling.  A
+ * finished job holds its whole output until it is written, so workers stay
+ * at most LEX_POOL_AHEAD jobs per thread ahead of the writer; one slow file
+ * then cannot make every later file's output pile up in memory. */
+#define LEX_POOL_AHEAD 4
+
+typedef struct {
+    LexJob *jobs;
+    unsigned char *done;
+    size_t count;
+    size_t next;
+    size_t written;         /* jobs the writer has written and freed */
+    size_t window;          /* claimed but unwritten jobs allowed */
+    int prefix_errors;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+    pthread_cond_t progress;    /* the writer moved on */
+} LexPool;
+
+static void *lex_pool_worker(void *arg) {
+    LexPool *pool = (LexPool *)arg;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->next < pool->count && pool->next - pool->written >= pool->window) {
+            pthread_cond_wait(&pool->progress, &pool->lock);
+        }
+        size_t i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        if (i >= pool->count) {
+            return NULL;
+        }
+        lex_job_run(&pool->jobs[i], pool->prefix_errors);
+        pthread_mutex_lock(&pool->lock);
+        pool->done[i] = 1;
+        pthread_cond_broadcast(&pool->finished);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+typedef struct {
+    size_t files;
+    size_t failed;
+    size_t bytes;
+    size_t tokens;
+    size_t symbols;
+    size_t lookups;
+    size_t hits;
+    size_t arena_bytes;
+    size_t cache_hits;
+    size_t cache_bypassed;
+    LexProfile profile;
+} LexTotals;
+
+static void lex_totals_add(LexTotals *totals, const LexJob *job) {
+    totals->files++;
+    totals->failed += (size_t)job->failed;
+    totals->bytes += job->bytes;
+    totals->tokens += job->tokens;
+    totals->symbols += job->symbols;
+    totals->lookups += job->lookups;
+    totals->hits += job->hits;
+    totals->arena_bytes += job->arena_bytes;
+    totals->cache_hits += (size_t)job->cache_hit;
+    totals->cache_bypassed += (size_t)(job->cache_bypass && !job->failed);
+    if (lex_profile) {
+        lex_profile_add(&totals->profile, &job->profile);
+    }
+}
+
+static void lex_write_job(LexJob *job, int multi) {
+    print_input_header(stdout, job->path, multi);
+    fwrite(job->out.data, 1, job->out.len, stdout);
+    fwrite(job->err.data, 1, job->err.len, stderr);
+    outbuf_free(&job->out);
+    outbuf_free(&job->err);
+}
+
+static void lex_run_parallel(const PathList *inputs, int threads, LexTotals *totals) {
+    int multi = inputs->count > 1;
+    LexPool pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.jobs = (LexJob *)calloc(inputs->count, sizeof(*pool.jobs));
+    pool.done = (unsigned char *)calloc(inputs->count, 1);
+    pthread_t *workers = (pthread_t *)calloc((size_t)threads, sizeof(*workers));
+    if (!pool.jobs || !pool.done || !workers) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    pool.count = inputs->count;
+    pool.window = (size_t)threads * LEX_POOL_AHEAD;
+    pool.prefix_errors = multi;
+    for (size_t i = 0; i < inputs->count; ++i) {
+        pool.jobs[i].path = inputs->paths[i];
+        outbuf_init(&pool.jobs[i].out, NULL);
+        outbuf_init(&pool.jobs[i].err, NULL);
+    }
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.finished, NULL);
+    pthread_cond_init(&pool.progress, NULL);
+    int started = 0;
+    for (; started < threads; ++started) {
+        if (pthread_create(&workers[started], NULL, lex_pool_worker, &pool) != 0) break;
+    }
+    if (started == 0) {
+        pool.window = pool.count;   /* no writer runs until this returns */
+        lex_pool_worker(&pool);
+    }
+
+    for (size_t i = 0; i < inputs->count; ++i) {
+        pthread_mutex_lock(&pool.lock);
+        while (!pool.done[i]) {
+            pthread_cond_wait(&pool.finished, &pool.lock);
+        }
+        pthread_mutex_unlock(&pool.lock);
+        lex_totals_add(totals, &pool.jobs[i]);
+        lex_write_job(&pool.jobs[i], multi);
+        pthread_mutex_lock(&pool.lock);
+        pool.written = i + 1;
+        pthread_cond_broadcast(&pool.progress);
+        pthread_mutex_unlock(&pool.lock);
+    }
+
+    for (int t = 0; t < started; ++t) {
+        pthread_join(workers[t], NULL);
+    }
+    pthread_cond_destroy(&pool.progress);
+    pthread_cond_destroy(&pool.finished);
+    pthread_mutex_destroy(&pool.lock);
+    free(workers);
+    free(pool.done);
+    free(pool.jobs);
+}
+
+/* Intra-file parallelism for one large mapped input.  The file is cut into
+ * chunks that each begin at a line start; workers lex their chunk
+ * speculatively (line numbers come from a parallel newline count, columns
+ * are exact because a chunk starts at column 1) and format the tokens whose
+ * start falls inside it.  A chunk that began inside a string or comment
+ * yields garbage at first, but once the exact token stream reaches a start
+ * offset the speculative stream also produced, both are identical from
+ * there on.  The writer follows the exact stream: it takes each chunk's
+ * output from that synchronization point and lexes any gap sequentially. */
+#ifndef LEX_CHUNK_BYTES
+#define LEX_CHUNK_BYTES (4u << 20)
+#endif
+
+typedef struct {
+    size_t begin;
+    size_t end;
+    size_t newlines;
+    size_t line;
+    size_t *starts;
+    size_t *out_pos;
+    size_t *err_pos;
+    size_t count;
+    size_t cap;
+    size_t stop;
+    size_t stop_line;
+    size_t stop_col;
+    OutBuf out;
+    OutBuf err;
+    int done;
+} LexChunk;
+
+typedef struct {
+    const char *buf;
+    size_t len;
+    const char *path;
+    LexChunk *chunks;
+    size_t count;
+    size_t next;
+    size_t written;
+    size_t window;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} ChunkPool;
+
+static void lex_chunk_record(LexChunk *chunk, size_t start) {
+    if (chunk->count == chunk->cap) {
+        size_t cap = chunk->cap ? chunk->cap * 2 : 4096;
+        size_t *starts = (size_t *)realloc(chunk->starts, cap * sizeof(size_t));
+        size_t *out_pos = starts ? (size_t *)realloc(chunk->out_pos, cap * sizeof(size_t)) : NULL;
+        size_t *err_pos = out_pos ? (size_t *)realloc(chunk->err_pos, cap * sizeof(size_t)) : NULL;
+        if (starts) chunk->starts = starts;
+        if (out_pos) chunk->out_pos = out_pos;
+        if (!err_pos) {
+            fprintf(stderr, "out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        chunk->err_pos = err_pos;
+        chunk->cap = cap;
+    }
+    chunk->starts[chunk->count] = start;
+    chunk->out_pos[chunk->count] = chunk->out.len;
+    chunk->err_pos[chunk->count] = chunk->err.len;
+    chunk->count++;
+}
+
+static void lex_format_error(OutBuf *err, const Token *tok) {
+    outbuf_printf(err, tok->length + 96, "Lexical error at line %zu col %zu: %.*s\n",
+                  tok->line, tok->column, (int)tok->length, tok->lexeme);
+}
+
+/* Lexes the tokens starting in [begin, end).  The last chunk's end lies past
+ * the input so that it also emits EOF. */
+static void lex_chunk_run(const ChunkPool *pool, LexChunk *chunk) {
+    Scanner scanner;
+    scanner_init_buffer_at(&scanner, pool->buf, pool->len, chunk->begin, chunk->line, 1);
+    for (;;) {
+        scanner_skip_whitespace(&scanner);
+        if (scanner.pos >= chunk->end) break;
+        lex_chunk_record(chunk, scanner.pos);
+        Token tok = scanner_next_token(&scanner);
+        print_token(&chunk->out, &tok);
+        if (tok.kind == TK_EOF) break;
+        if (tok.kind == TK_ERROR) lex_format_error(&chunk->err, &tok);
+    }
+    chunk->stop = scanner.pos;
+    chunk->stop_line = scanner.line;
+    chunk->stop_col = scanner.column;
+}
+
+static void *chunk_count_worker(void *arg) {
+    ChunkPool *pool = (ChunkPool *)arg;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        size_t i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        if (i >= pool->count) return NULL;
+        LexChunk *chunk = &pool->chunks[i];
+        size_t end = chunk->end < pool->len ? chunk->end : pool->len;
+        size_t last = 0;
+        chunk->newlines = lex_kernels->count_newlines((const unsigned char *)pool->buf + chunk->begin,
+                                                      end - chunk->begin, &last);
+    }
+}
+
+/* Claims chunks in order, staying at most window chunks ahead of the writer
+ * so memory use does not grow with the file size. */
+static void *chunk_lex_worker(void *arg) {
+    ChunkPool *pool = (ChunkPool *)arg;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        size_t i = pool->next;
+        while (i < pool->count && i >= pool->written + pool->window) {
+            pthread_cond_wait(&pool->changed, &pool->lock);
+            i = pool->next;
+        }
+        pool->next = i + 1;
+        pthread_mutex_unlock(&pool->lock);
+        if (i >= pool->count) return NULL;
+        LexChunk *chunk = &pool->chunks[i];
+        outbuf_init(&chunk->out, NULL);
+        outbuf_init(&chunk->err, NULL);
+        lex_chunk_run(pool, chunk);
+        pthread_mutex_lock(&pool->lock);
+        chunk->done = 1;
+        pthread_cond_broadcast(&pool->changed);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static size_t chunk_find_start(const LexChunk *chunk, size_t pos) {
+    size_t lo = 0, hi = chunk->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (chunk->starts[mid] < pos) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static void lex_run_threads(ChunkPool *pool, void *(*worker)(void *), int threads) {
+    pthread_t *ids = (pthread_t *)calloc((size_t)threads, sizeof(*ids));
+    int started = 0;
+    while (ids && started < threads &&
+           pthread_create(&ids[started], NULL, worker, pool) == 0) {
+        started++;
+    }
+    if (started == 0) {
+        worker(pool);
+    }
+    for (int t = 0; t < started; ++t) {
+        pthread_join(ids[t], NULL);
+    }
+    free(ids);
+}
+
+/* Returns 0 when the input was lexed in chunks, 1 when it is too small or
+ * not a regular file (the caller then lexes it normally). */
+static int lex_run_chunked(const char *path, int threads, LexTotals *totals) {
+    struct stat st;
+    /* streams are left unopened: the sequential run reads them exactly once */
+    if (strcmp(path, "-") == 0 || stat(path, &st) != 0 || !S_ISREG(st.st_mode) ||
+        (size_t)st.st_size < 2 * (size_t)LEX_CHUNK_BYTES) {
+        return 1;
+    }
+    SourceBuffer src;
+    if (source_open(&src, path) != 0) {
+        source_close(&src);
+        return 1;
+    }
+    if (src.size < 2 * (size_t)LEX_CHUNK_BYTES) {
+        source_close(&src);
+        return 1;
+    }
+
+    ChunkPool pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.buf = src.data;
+    pool.len = src.size;
+    pool.path = path;
+    size_t max_chunks = src.size / LEX_CHUNK_BYTES + 1;
+    pool.chunks = (LexChunk *)calloc(max_chunks, sizeof(*pool.chunks));
+    if (!pool.chunks) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t begin = 0;
+    while (begin < src.size) {
+        pool.chunks[pool.count].begin = begin;
+        size_t cut = begin + LEX_CHUNK_BYTES;
+        const char *nl = cut < src.size ? (const char *)memchr(src.data + cut, '\n', src.size - cut) : NULL;
+        begin = nl ? (size_t)(nl - src.data) + 1 : src.size;
+        pool.chunks[pool.count].end = begin < src.size ? begin : src.size + 1;
+        pool.count++;
+    }
+    pool.window = (size_t)threads * 2;
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.changed, NULL);
+
+    lex_run_threads(&pool, chunk_count_worker, threads);
+    pool.next = 0;
+    size_t line = 1;
+    for (size_t k = 0; k < pool.count; ++k) {
+        pool.chunks[k].line = line;
+        line += pool.chunks[k].newlines;
+    }
+
+    pthread_t *ids = (pthread_t *)calloc((size_t)threads, sizeof(*ids));
+    int started = 0;
+    while (ids && started < threads &&
+           pthread_create(&ids[started], NULL, chunk_lex_worker, &pool) == 0) {
+        started++;
+    }
+
+    /* Writer: follows the exact token stream from (pos, line, col). */
+    OutBuf out, err;
+    outbuf_init(&out, stdout);
+    outbuf_init(&err, stderr);
+    print_input_header(stdout, path, 0);
+    Scanner exact;
+    scanner_init_buffer(&exact, src.data, src.size);
+    scanner_skip_whitespace(&exact);
+    int finished = 0;
+    for (size_t k = 0; k < pool.count; ++k) {
+        LexChunk *chunk = &pool.chunks[k];
+        if (started == 0) {
+            outbuf_init(&chunk->out, NULL);
+            outbuf_init(&chunk->err, NULL);
+            lex_chunk_run(&pool, chunk);
+        } else {
+            pthread_mutex_lock(&pool.lock);
+            while (!chunk->done) pthread_cond_wait(&pool.changed, &pool.lock);
+            pthread_mutex_unlock(&pool.lock);
+        }
+        while (!finished && exact.pos < chunk->end) {
+            size_t idx = chunk_find_start(chunk, exact.pos);
+            if (idx < chunk->count && chunk->starts[idx] == exact.pos) {
+                if (lex_format == LEX_FORMAT_BINARY) {
+                    /* the chunk's deltas continue from its own token idx-1 */
+                    TokenReader reader;
+                    Token skipped;
+                    memset(&reader, 0, sizeof(reader));
+                    reader.p = (const unsigned char *)chunk->out.data;
+                    reader.end = reader.p + chunk->out_pos[idx];
+                    while (token_reader_next(&reader, &skipped) == TOKSTREAM_TOKEN) {
+                    }
+                    print_stream_anchor(&out, reader.offset, reader.line, reader.column);
+                }
+                outbuf_flush(&out);
+                outbuf_flush(&err);
+                fwrite(chunk->out.data + chunk->out_pos[idx], 1, chunk->out.len - chunk->out_pos[idx], stdout);
+                fwrite(chunk->err.data + chunk->err_pos[idx], 1, chunk->err.len - chunk->err_pos[idx], stderr);
+                totals->tokens += chunk->count - idx;
+                out.prev_offset = chunk->out.prev_offset;
+                out.prev_line = chunk->out.prev_line;
+                out.prev_column = chunk->out.prev_column;
+                finished = chunk->end > src.size;
+                scanner_init_buffer_at(&exact, src.data, src.size, chunk->stop,
+                                       chunk->stop_line, chunk->stop_col);
+                break;
+            }
+            Token tok = scanner_next_token(&exact);
+            totals->tokens++;
+            print_token(&out, &tok);
+            if (tok.kind == TK_ERROR) lex_format_error(&err, &tok);
+            if (tok.kind == TK_EOF) finished = 1;
+            scanner_skip_whitespace(&exact);
+        }
+        free(chunk->starts);
+        free(chunk->out_pos);
+        free(chunk->err_pos);
+        outbuf_free(&chunk->out);
+        outbuf_free(&chunk->err);
+        pthread_mutex_lock(&pool.lock);
+        pool.written = k + 1;
+        pthread_cond_broadcast(&pool.changed);
+        pthread_mutex_unlock(&pool.lock);
+    }
+    outbuf_free(&out);
+    outbuf_free(&err);
+
+    for (int t = 0; t < started; ++t) {
+        pthread_join(ids[t], NULL);
+    }
+    free(ids);
+    pthread_cond_destroy(&pool.changed);
+    pthread_mutex_destroy(&pool.lock);
+    free(pool.chunks);
+    totals->files++;
+    totals->bytes += src.size;
+    source_close(&src);
+    return 0;
+}
+
+/* Single thread: output streams to stdout as it is produced. */
+static void lex_run_sequential(const PathList *inputs, LexTotals *totals) {
+    int multi = inputs->count > 1;
+    for (size_t i = 0; i < inputs->count; ++i) {
+        LexJob job;
+        memset(&job, 0, sizeof(job));
+        job.path = inputs->paths[i];
+        outbuf_init(&job.out, stdout);
+        outbuf_init(&job.err, stderr);
+        print_input_header(stdout, job.path, multi);
+        lex_job_run(&job, multi);
+        lex_totals_add(totals, &job);
+        outbuf_free(&job.out);
+        outbuf_free(&job.err);
+    }
+}
+
+/* Converts a binary token stream back to the text output (tokens on stdout,
+ * diagnostics on stderr) of a run that produced it. */
+static int lex_decode_stream(const char *data, size_t len) {
+    TokenReader reader;
+    Token tok;
+    TokenReadResult rc;
+    if (token_reader_init(&reader, data, len) != 0) {
+        fprintf(stderr, "not a token stream\n");
+        return -1;
+    }
+    OutBuf out, err;
+    outbuf_init(&out, stdout);
+    outbuf_init(&err, stderr);
+    while ((rc = token_reader_next(&reader, &tok)) != TOKSTREAM_END && rc != TOKSTREAM_CORRUPT) {
+        if (rc == TOKSTREAM_NEW_FILE) {
+            if (reader.multi) {
+                outbuf_write(&out, "==> ", 4);
+                outbuf_write(&out, reader.path, reader.path_len);
+                outbuf_write(&out, " <==\n", 5);
+            }
+            continue;
+        }
+        print_token_text(&out, &tok);
+        if (tok.kind == TK_ERROR) {
+            outbuf_flush(&out);
+            outbuf_printf(&err, tok.length + reader.path_len + 96,
+                          "%.*s%sLexical error at line %zu col %zu: %.*s\n",
+                          reader.multi ? (int)reader.path_len : 0, reader.path ? reader.path : "",
+                          reader.multi ? ": " : "", tok.line, tok.column, (int)tok.length, tok.lexeme);
+            outbuf_flush(&err);
+        }
+    }
+    outbuf_free(&out);
+    outbuf_free(&err);
+    if (rc == TOKSTREAM_CORRUPT) {
+        fprintf(stderr, "corrupt token stream\n");
+        return -1;
+    }
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-j threads] [--stats] [--profile] [--values] [--format text|binary|ndjson]\n"
+                    "       [--cache dir] [--cache-size bytes[K|M|G]] <source-file|directory|@list|->...\n"
+                    "       %s --decode <token-stream>\n", prog, prog);
+}
+
+static int lex_decode_file(const char *path) {
+    SourceBuffer src;
+    int rc = source_open(&src, path);
+    if (rc < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (rc == 0) {
+        rc = lex_decode_stream(src.data, src.size);
+        source_close(&src);
+        return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    /* pipe or stdin: read it all first */
+    FILE *fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    OutBuf data;
+    outbuf_init(&data, NULL);
+    if (!fp) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+#ifdef _WIN32
+    if (fp == stdin) _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    size_t n;
+    while ((n = fread(outbuf_reserve(&data, OUTBUF_FLUSH), 1, OUTBUF_FLUSH, fp)) > 0) {
+        data.len += n;
+    }
+    fclose(fp);
+    rc = lex_decode_stream(data.data ? data.data : "", data.len);
+    outbuf_free(&data);
+    return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char **argv) {
+    int threads = 0;
+    int stats = 0;
+    PathList inputs = {0};
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+            if (threads <= 0) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = 1;
+            lex_intern = 1;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            lex_profile = 1;
+        } else if (strcmp(argv[i], "--values") == 0) {
+            lex_values = 1;
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+            if (strcmp(name, "text") == 0) {
+                lex_format = LEX_FORMAT_TEXT;
+            } else if (strcmp(name, "binary") == 0) {
+                lex_format = LEX_FORMAT_BINARY;
+            } else if (strcmp(name, "ndjson") == 0) {
+                lex_format = LEX_FORMAT_NDJSON;
+            } else {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            lex_cache_dir = argv[++i];
+        } else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc) {
+            char *end = NULL;
+            unsigned long long limit = strtoull(argv[++i], &end, 10);
+            switch (*end) {
+                case 'k': case 'K': limit <<= 10; break;
+                case 'm': case 'M': limit <<= 20; break;
+                case 'g': case 'G': limit <<= 30; break;
+                default: break;
+            }
+            if (limit == 0) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            lex_cache_limit = (size_t)limit;
+        } else if (strcmp(argv[i], "--decode") == 0 && i + 1 < argc) {
+            lex_kernels_select(NULL);
+            return lex_decode_file(argv[i + 1]);
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            collect_inputs(&inputs, argv[i]);
+        }
+    }
+    if (inputs.count == 0) {
+        usage(argv[0]);
+        path_list_free(&inputs);
+        return EXIT_FAILURE;
+    }
+    if (threads == 0) {
+        threads = lex_default_threads();
+    }
+
+    lex_kernels_select(NULL);
+    if (lex_cache_dir) {
+#ifdef _WIN32
+        _mkdir(lex_cache_dir);
+#else
+        mkdir(lex_cache_dir, 0777);
+#endif
+        lex_cache_init_config();
+    }
+    if (lex_format == LEX_FORMAT_BINARY) {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        print_stream_header(stdout, inputs.count > 1);
+    }
+
+    LexTotals totals = {0};
+    double t0 = lex_now();
+    unsigned long long cycles0 = lex_cycles();
+    /* the chunked writer has no per-token loop to profile, cache or decode values in */
+    if (inputs.count == 1 && threads > 1 && !lex_profile && !lex_cache_dir && !lex_values && lex_run_chunked(inputs.paths[0], threads, &totals) == 0) {
+        /* one large file, lexed in parallel chunks */
+    } else if (threads == 1 || inputs.count == 1) {
+        threads = 1;
+        lex_run_sequential(&inputs, &totals);
+    } else {
+        if ((size_t)threads > inputs.count) {
+            threads = (int)inputs.count;
+        }
+        lex_run_parallel(&inputs, threads, &totals);
+    }
+    fflush(stdout);
+    if (lex_cache_written) {
+        lex_cache_evict();
+    }
+    double elapsed = lex_now() - t0;
+    unsigned long long cycles = lex_cycles() - cycles0;
+
+    if (stats) {
+        double secs = elapsed > 0 ? elapsed : 1e-9;
+        fprintf(stderr, "lexed %zu file(s) (%zu failed) with %d thread(s): %zu bytes, %zu tokens in %.3f s\n",
+                totals.files, totals.failed, threads, totals.bytes, totals.tokens, elapsed);
+        fprintf(stderr, "throughput: %.1f MB/s, %.2f Mtokens/s\n",
+                (double)totals.bytes / secs / 1e6, (double)totals.tokens / secs / 1e6);
+        if (totals.lookups) {
+            fprintf(stderr, "interning: %zu distinct spellings, %zu lookups, %.1f%% hits, %zu arena bytes\n",
+                    totals.symbols, totals.lookups, 100.0 * (double)totals.hits / (double)totals.lookups,
+                    totals.arena_bytes);
+        }
+        if (lex_cache_dir) {
+            fprintf(stderr, "cache: %zu hit(s), %zu miss(es), %zu bypassed, %zu bytes stored\n", totals.cache_hits,
+                    totals.files - totals.failed - totals.cache_hits - totals.cache_bypassed, totals.cache_bypassed,
+                    lex_cache_written);
+        }
+    }
+    if (lex_profile) {
+        lex_profile_report(stderr, &totals.profile, elapsed > 0 ? (double)cycles / elapsed : 0);
+    }
+    path_list_free(&inputs);
+    return totals.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
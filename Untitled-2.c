@@ -1,364 +1,3134 @@
 #include <stdio.h>
+#include <limits.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-#define MAX_STATES 32
+#define MAX_SYMBOLS 256
 #define ALPHABET_SIZE 2 /* 0=letter, 1=digit */
 
+/* Automata grow as states are added.  NFA states keep sparse edge lists:
+ * a move covers a range of symbols, and a state may have any number of
+ * moves on the same symbol.  DFA transitions hold state_count rows of
+ * symbol_count targets (-1 for none), reached through dfa_row. */
 typedef struct {
-    int transitions[MAX_STATES][ALPHABET_SIZE];
-    int epsilon[MAX_STATES][MAX_STATES];
+    int *items;
+    int count;
+    int cap;
+} IntList;
+
+typedef struct {
+    int lo;                 /* symbols lo..hi go to target */
+    int hi;
+    int target;
+} NfaMove;
+
+typedef struct {
+    NfaMove *items;
+    int count;
+    int cap;
+} MoveList;
+
+/* tag[s] != 0 marks s as accepting; an NFA may have any number of
+ * accepting states, one or more per rule.  When one DFA state contains
+ * several accepting NFA states the smallest tag wins, so tags double as
+ * rule priorities.  Single-pattern NFAs use tag 1 on their accept state. */
+typedef struct {
+    MoveList *moves;        /* moves[s]: s's moves on symbols */
+    IntList *epsilon;       /* epsilon[s]: targets of s's epsilon moves */
+    int *tag;
     int state_count;
+    int cap;
+    int symbol_count;
     int start;
-    int accept;
 } NFA;
 
+/* accept[s] holds the winning tag, 0 for non-accepting states. */
 typedef struct {
-    int transitions[MAX_STATES][ALPHABET_SIZE];
-    int accept[MAX_STATES];
+    int *transitions;
+    int *accept;
     int state_count;
+    int cap;
+    int symbol_count;
     int start;
 } DFA;
 
-static void nfa_init(NFA *nfa) {
+/* --stats: work counters (plain increments at per-call granularity, never
+ * inside the inner loops) and per-phase wall time.  The clock is only read
+ * when stats_enabled is set. */
+typedef enum {
+    PHASE_BUILD, PHASE_SUBSET, PHASE_TOTAL, PHASE_MINIMIZE, PHASE_EMIT, PHASE_COUNT
+} Phase;
+
+typedef struct {
+    size_t closures;        /* epsilon closures computed, one per epsilon SCC */
+    size_t closure_states;  /* states in those closures */
+    size_t set_lookups;     /* DFA state sets compared while deduplicating */
+    size_t splitters;       /* (block, symbol) splitters minimization took off its worklist */
+    size_t splits;          /* blocks split off during refinement */
+    double seconds[PHASE_COUNT];
+} AutomataStats;
+
+static AutomataStats stats;
+
+/* -j: threads the program's own determinizations run on. */
+static int subset_threads = 1;
+
+#ifndef NFA_NO_MAIN
+static int stats_enabled = 0;
+
+static double stats_clock(void) {
+    if (!stats_enabled) return 0;
+#ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+static void stats_phase(Phase phase, double start) {
+    if (stats_enabled) {
+        stats.seconds[phase] += stats_clock() - start;
+    }
+}
+#endif
+
+static void *automata_alloc(void *old, size_t bytes) {
+    void *p = realloc(old, bytes ? bytes : 1);
+    if (!p) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void int_list_push(IntList *list, int value) {
+    if (list->count == list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 4;
+        list->items = (int *)automata_alloc(list->items, (size_t)list->cap * sizeof(int));
+    }
+    list->items[list->count++] = value;
+}
+
+static int *dfa_row(const DFA *dfa, int state) {
+    return dfa->transitions + (size_t)state * (size_t)dfa->symbol_count;
+}
+
+static void nfa_init(NFA *nfa, int symbol_count) {
+    memset(nfa, 0, sizeof(*nfa));
+    nfa->symbol_count = symbol_count;
+}
+
+static void nfa_free(NFA *nfa) {
+    for (int i = 0; i < nfa->state_count; ++i) {
+        free(nfa->moves[i].items);
+        free(nfa->epsilon[i].items);
+    }
+    free(nfa->moves);
+    free(nfa->epsilon);
+    free(nfa->tag);
     memset(nfa, 0, sizeof(*nfa));
-    for (int i = 0; i < MAX_STATES; ++i) {
-        for (int j = 0; j < ALPHABET_SIZE; ++j) {
-            nfa->transitions[i][j] = -1;
+}
+
+static int nfa_add_state(NFA *nfa, int tag) {
+    if (nfa->state_count == nfa->cap) {
+        nfa->cap = nfa->cap ? nfa->cap * 2 : 16;
+        nfa->moves = (MoveList *)automata_alloc(nfa->moves, (size_t)nfa->cap * sizeof(MoveList));
+        nfa->epsilon = (IntList *)automata_alloc(nfa->epsilon, (size_t)nfa->cap * sizeof(IntList));
+        nfa->tag = (int *)automata_alloc(nfa->tag, (size_t)nfa->cap * sizeof(int));
+    }
+    int s = nfa->state_count++;
+    memset(&nfa->moves[s], 0, sizeof(MoveList));
+    memset(&nfa->epsilon[s], 0, sizeof(IntList));
+    nfa->tag[s] = tag;
+    return s;
+}
+
+static void nfa_add_epsilon(NFA *nfa, int from, int to) {
+    int_list_push(&nfa->epsilon[from], to);
+}
+
+/* from --c--> to for every symbol c in [lo, hi].  A range that continues
+ * the state's last move to the same target extends it. */
+static void nfa_add_range(NFA *nfa, int from, int lo, int hi, int to) {
+    MoveList *list = &nfa->moves[from];
+    if (list->count > 0) {
+        NfaMove *last = &list->items[list->count - 1];
+        if (last->target == to && last->hi + 1 == lo) {
+            last->hi = hi;
+            return;
+        }
+    }
+    if (list->count == list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 4;
+        list->items = (NfaMove *)automata_alloc(list->items, (size_t)list->cap * sizeof(NfaMove));
+    }
+    list->items[list->count].lo = lo;
+    list->items[list->count].hi = hi;
+    list->items[list->count].target = to;
+    list->count++;
+}
+
+/* First target of state on symbol, or -1. */
+static int nfa_target(const NFA *nfa, int state, int symbol) {
+    const MoveList *list = &nfa->moves[state];
+    for (int i = 0; i < list->count; ++i) {
+        if (list->items[i].lo <= symbol && symbol <= list->items[i].hi) {
+            return list->items[i].target;
         }
     }
+    return -1;
+}
+
+static void dfa_init(DFA *dfa, int symbol_count) {
+    memset(dfa, 0, sizeof(*dfa));
+    dfa->symbol_count = symbol_count;
+}
+
+static void dfa_free(DFA *dfa) {
+    free(dfa->transitions);
+    free(dfa->accept);
+    memset(dfa, 0, sizeof(*dfa));
+}
+
+/* Appends a state with no transitions and returns its index. */
+static int dfa_add_state(DFA *dfa, int accept) {
+    if (dfa->state_count == dfa->cap) {
+        dfa->cap = dfa->cap ? dfa->cap * 2 : 16;
+        dfa->transitions = (int *)automata_alloc(dfa->transitions,
+                                                 (size_t)dfa->cap * (size_t)dfa->symbol_count * sizeof(int));
+        dfa->accept = (int *)automata_alloc(dfa->accept, (size_t)dfa->cap * sizeof(int));
+    }
+    int s = dfa->state_count++;
+    int *row = dfa_row(dfa, s);
+    for (int c = 0; c < dfa->symbol_count; ++c) {
+        row[c] = -1;
+    }
+    dfa->accept[s] = accept;
+    return s;
 }
 
 static void build_identifier_nfa(NFA *nfa) {
-    nfa_init(nfa);
-    nfa->state_count = 2;
-    nfa->start = 0;
-    nfa->accept = 1;
+    nfa_init(nfa, ALPHABET_SIZE);
+    nfa->start = nfa_add_state(nfa, 0);
+    nfa_add_state(nfa, 1);
 
     /* q0 --letter--> q1; q1 loops on letter/digit to model [A-Za-z][A-Za-z0-9]* */
-    nfa->transitions[0][0] = 1;     /* letter */
-    nfa->transitions[1][0] = 1;     /* letter loop */
-    nfa->transitions[1][1] = 1;     /* digit loop */
+    nfa_add_range(nfa, 0, 0, 0, 1);     /* letter */
+    nfa_add_range(nfa, 1, 0, 1, 1);     /* letter/digit loop */
 }
 
+#ifndef NFA_NO_MAIN
 static void print_nfa(const NFA *nfa, const char *title) {
     printf("%s\n", title);
-    printf("States: %d, Start: q%d, Accept: q%d\n", nfa->state_count, nfa->start, nfa->accept);
+    printf("States: %d, Start: q%d, Accept:", nfa->state_count, nfa->start);
+    for (int i = 0; i < nfa->state_count; ++i) {
+        if (nfa->tag[i]) {
+            printf(" q%d", i);
+        }
+    }
+    printf("\n");
     printf("Transition table (letter=0, digit=1):\n");
     printf(" State | letter | digit | epsilon\n");
     for (int i = 0; i < nfa->state_count; ++i) {
+        int letter = nfa_target(nfa, i, 0);
+        int digit = nfa_target(nfa, i, 1);
         printf("  q%-3d|  ", i);
-        if (nfa->transitions[i][0] != -1) {
-            printf("q%-3d", nfa->transitions[i][0]);
+        if (letter != -1) {
+            printf("q%-3d", letter);
         } else {
             printf(" -- ");
         }
         printf("|  ");
-        if (nfa->transitions[i][1] != -1) {
-            printf("q%-3d", nfa->transitions[i][1]);
+        if (digit != -1) {
+            printf("q%-3d", digit);
         } else {
             printf(" -- ");
         }
         printf("| ");
-        int eps_printed = 0;
-        for (int j = 0; j < nfa->state_count; ++j) {
-            if (nfa->epsilon[i][j]) {
-                printf("q%d ", j);
-                eps_printed = 1;
-            }
+        for (int j = 0; j < nfa->epsilon[i].count; ++j) {
+            printf("q%d ", nfa->epsilon[i].items[j]);
         }
-        if (!eps_printed) {
+        if (nfa->epsilon[i].count == 0) {
             printf("--");
         }
         printf("\n");
     }
     printf("\n");
 }
+#endif
 
-static int epsilon_closure(const NFA *nfa, int state, int *closure) {
-    int stack[MAX_STATES];
-    int top = -1;
-    int visited[MAX_STATES] = {0};
-    stack[++top] = state;
-    visited[state] = 1;
-    int count = 0;
+/* DFA states are sets of NFA states.  A set under construction is a bitset
+ * over all NFA states plus the list of its non-zero words; a finished set is
+ * stored as just those (index, word) pairs, so hashing, comparing and
+ * walking a set cost its size, not the NFA's.  An open-addressing hash
+ * table maps stored sets to DFA states. */
+typedef unsigned long long SetWord;
+#define SET_WORD_BITS 64
 
-    while (top >= 0) {
-        int s = stack[top--];
-        closure[count++] = s;
-        for (int t = 0; t < nfa->state_count; ++t) {
-            if (nfa->epsilon[s][t] && !visited[t]) {
-                visited[t] = 1;
-                stack[++top] = t;
-            }
+typedef struct {
+    SetWord *bits;
+    int *words;             /* indices of the non-zero words of bits */
+    int word_count;
+} WorkSet;
+
+typedef struct {
+    int *index;             /* word indices of every stored set, back to back */
+    SetWord *bits;          /* the matching words */
+    size_t pool_count;
+    size_t pool_cap;
+    size_t *offset;         /* set i is pool[offset[i] .. offset[i + 1]) */
+    int count;
+    int cap;
+    int *slots;             /* set per slot, -1 when empty */
+    size_t slot_mask;
+    size_t probes;          /* stored sets compared while looking up */
+} StateSetTable;
+
+static int work_set_has(const WorkSet *set, int state) {
+    return (int)((set->bits[state / SET_WORD_BITS] >> (state % SET_WORD_BITS)) & 1u);
+}
+
+static void work_set_add(WorkSet *set, int state) {
+    SetWord *word = &set->bits[state / SET_WORD_BITS];
+    if (*word == 0) {
+        set->words[set->word_count++] = state / SET_WORD_BITS;
+    }
+    *word |= 1ull << (state % SET_WORD_BITS);
+}
+
+static void work_set_clear(WorkSet *set) {
+    for (int i = 0; i < set->word_count; ++i) {
+        set->bits[set->words[i]] = 0;
+    }
+    set->word_count = 0;
+}
+
+static int compare_ints(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/* Puts the word list in ascending order, the canonical form that
+ * state_set_find_or_add hashes and stores.  Most sets span a few words and
+ * an insertion sort beats qsort's call overhead there; larger lists go to
+ * qsort so sets over big NFAs do not sort in quadratic time. */
+#define WORK_SET_SORT_SMALL 16
+
+static void work_set_sort(WorkSet *set) {
+    if (set->word_count > WORK_SET_SORT_SMALL) {
+        qsort(set->words, (size_t)set->word_count, sizeof(int), compare_ints);
+        return;
+    }
+    for (int i = 1; i < set->word_count; ++i) {
+        int w = set->words[i];
+        int j = i;
+        while (j > 0 && set->words[j - 1] > w) {
+            set->words[j] = set->words[j - 1];
+            j--;
         }
+        set->words[j] = w;
     }
-    return count;
 }
 
-static int move(const NFA *nfa, int state, int symbol, int *dest) {
-    int next = nfa->transitions[state][symbol];
-    if (next == -1) return 0;
-    dest[0] = next;
-    return 1;
+static void state_set_table_init(StateSetTable *t) {
+    memset(t, 0, sizeof(*t));
+    t->slot_mask = 63;
+    t->slots = (int *)automata_alloc(NULL, (t->slot_mask + 1) * sizeof(int));
+    memset(t->slots, 0xff, (t->slot_mask + 1) * sizeof(int));
+    t->offset = (size_t *)automata_alloc(NULL, sizeof(size_t));
+    t->offset[0] = 0;
 }
 
-static int subset_construction(const NFA *nfa, DFA *dfa) {
-    memset(dfa, 0, sizeof(*dfa));
-    for (int i = 0; i < MAX_STATES; ++i) {
-        for (int j = 0; j < ALPHABET_SIZE; ++j) {
-            dfa->transitions[i][j] = -1;
+/* Empties the table, keeping its storage. */
+static void state_set_table_reset(StateSetTable *t) {
+    memset(t->slots, 0xff, (t->slot_mask + 1) * sizeof(int));
+    t->count = 0;
+    t->pool_count = 0;
+    t->offset[0] = 0;
+}
+
+static void state_set_table_free(StateSetTable *t) {
+    free(t->index);
+    free(t->bits);
+    free(t->offset);
+    free(t->slots);
+    memset(t, 0, sizeof(*t));
+}
+
+#define STATE_SET_HASH_SEED 0x9e3779b97f4a7c15ull
+
+static unsigned long long state_set_mix(unsigned long long h, int index, SetWord bits) {
+    h = (h ^ bits ^ ((unsigned long long)index << 40)) * 0xff51afd7ed558ccdull;
+    return h ^ (h >> 32);
+}
+
+static size_t state_set_stored_hash(const StateSetTable *t, int set) {
+    unsigned long long h = STATE_SET_HASH_SEED;
+    for (size_t k = t->offset[set]; k < t->offset[set + 1]; ++k) {
+        h = state_set_mix(h, t->index[k], t->bits[k]);
+    }
+    return (size_t)h;
+}
+
+static void state_set_table_grow(StateSetTable *t) {
+    size_t mask = t->slot_mask * 2 + 1;
+    int *slots = (int *)automata_alloc(NULL, (mask + 1) * sizeof(int));
+    memset(slots, 0xff, (mask + 1) * sizeof(int));
+    for (int i = 0; i < t->count; ++i) {
+        size_t h = state_set_stored_hash(t, i) & mask;
+        while (slots[h] >= 0) h = (h + 1) & mask;
+        slots[h] = i;
+    }
+    free(t->slots);
+    t->slots = slots;
+    t->slot_mask = mask;
+}
+
+/* Hash of the sorted set's (index, word) pairs. */
+static unsigned long long state_set_hash(const WorkSet *set) {
+    unsigned long long h = STATE_SET_HASH_SEED;
+    for (int i = 0; i < set->word_count; ++i) {
+        h = state_set_mix(h, set->words[i], set->bits[set->words[i]]);
+    }
+    return h;
+}
+
+/* Index of the sorted set with hash h, adding it as the next DFA state when
+ * it is new (*added). */
+static int state_set_find_or_add_hashed(StateSetTable *t, const WorkSet *set, unsigned long long h,
+                                        int *added) {
+    size_t count = (size_t)set->word_count;
+    size_t slot = (size_t)h & t->slot_mask;
+    *added = 0;
+    for (; t->slots[slot] >= 0; slot = (slot + 1) & t->slot_mask) {
+        int candidate = t->slots[slot];
+        size_t begin = t->offset[candidate];
+        t->probes++;
+        if (t->offset[candidate + 1] - begin != count) continue;
+        size_t i = 0;
+        while (i < count && t->index[begin + i] == set->words[i] &&
+               t->bits[begin + i] == set->bits[set->words[i]]) {
+            i++;
+        }
+        if (i == count) {
+            return candidate;
         }
     }
+    if (t->pool_count + count > t->pool_cap) {
+        t->pool_cap = t->pool_cap * 2 > t->pool_count + count ? t->pool_cap * 2 : t->pool_count + count + 64;
+        t->index = (int *)automata_alloc(t->index, t->pool_cap * sizeof(int));
+        t->bits = (SetWord *)automata_alloc(t->bits, t->pool_cap * sizeof(SetWord));
+    }
+    if (t->count == t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 64;
+        t->offset = (size_t *)automata_alloc(t->offset, ((size_t)t->cap + 1) * sizeof(size_t));
+    }
+    for (size_t i = 0; i < count; ++i) {
+        t->index[t->pool_count + i] = set->words[i];
+        t->bits[t->pool_count + i] = set->bits[set->words[i]];
+    }
+    t->pool_count += count;
+    int index = t->count++;
+    t->offset[t->count] = t->pool_count;
+    t->slots[slot] = index;
+    if ((size_t)t->count * 2 > t->slot_mask) {
+        state_set_table_grow(t);
+    }
+    *added = 1;
+    return index;
+}
 
-    int state_sets[MAX_STATES];
-    int queue[MAX_STATES];
-    int head = 0, tail = 0;
+static int state_set_find_or_add(StateSetTable *t, const WorkSet *set, int *added) {
+    return state_set_find_or_add_hashed(t, set, state_set_hash(set), added);
+}
 
-    int closure[MAX_STATES];
-    int count = epsilon_closure(nfa, nfa->start, closure);
-    int initial = 0;
-    for (int i = 0; i < count; ++i) {
-        initial |= (1 << closure[i]);
+/* Adds the stored set index of table to set: a word-wide OR over its
+ * non-zero words. */
+static void work_set_or(WorkSet *set, const StateSetTable *table, int index) {
+    for (size_t k = table->offset[index]; k < table->offset[index + 1]; ++k) {
+        int w = table->index[k];
+        if (set->bits[w] == 0) {
+            set->words[set->word_count++] = w;
+        }
+        set->bits[w] |= table->bits[k];
     }
+}
 
-    state_sets[0] = initial;
-    queue[tail++] = 0;
-    dfa->start = 0;
-    dfa->state_count = 1;
+/* Epsilon closures of every NFA state, computed once.  States on an
+ * epsilon cycle share a closure, so the epsilon graph is condensed into
+ * strongly connected components (Tarjan); components complete in reverse
+ * topological order, so each closure is its members plus the OR of the
+ * already finished closures its epsilon moves lead to.  Equal closures are
+ * stored once; a closure that is just the state itself, the common case
+ * away from Thompson glue states, is not stored at all. */
+#define CLOSURE_SELF (-1)
 
-    if (initial & (1 << nfa->accept)) {
-        dfa->accept[0] = 1;
+typedef struct {
+    StateSetTable sets;
+    int *of;                /* closure of each state, an index into sets or CLOSURE_SELF */
+} Closures;
+
+static void closure_or(WorkSet *set, const Closures *closures, int state) {
+    if (closures->of[state] == CLOSURE_SELF) {
+        work_set_add(set, state);
+    } else {
+        work_set_or(set, &closures->sets, closures->of[state]);
     }
+}
 
-    while (head < tail) {
-        int current_index = queue[head++];
-        int current_set = state_sets[current_index];
+static void closures_build(const NFA *nfa, Closures *closures) {
+    int n = nfa->state_count;
+    size_t width = ((size_t)n + SET_WORD_BITS - 1) / SET_WORD_BITS;
+    int *order = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    int *low = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    int *component = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    int *component_closure = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    int *merged = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    int *stack = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    int *frames = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    int *next_edge = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    WorkSet set;
+    set.bits = (SetWord *)automata_alloc(NULL, (width ? width : 1) * sizeof(SetWord));
+    set.words = (int *)automata_alloc(NULL, (width ? width : 1) * sizeof(int));
+    set.word_count = 0;
+    memset(set.bits, 0, width * sizeof(SetWord));
+    for (int v = 0; v < n; ++v) {
+        order[v] = component[v] = merged[v] = -1;
+    }
+    state_set_table_init(&closures->sets);
+    closures->of = (int *)automata_alloc(NULL, (size_t)(n ? n : 1) * sizeof(int));
 
-        for (int symbol = 0; symbol < ALPHABET_SIZE; ++symbol) {
-            int dest_mask = 0;
-            for (int state = 0; state < nfa->state_count; ++state) {
-                if (!(current_set & (1 << state))) {
-                    continue;
+    int visited = 0, top = 0, depth = 0, components = 0;
+    for (int root = 0; root < n; ++root) {
+        if (order[root] >= 0) continue;
+        order[root] = low[root] = visited++;
+        stack[top++] = root;
+        frames[depth] = root;
+        next_edge[depth++] = 0;
+        while (depth > 0) {
+            int v = frames[depth - 1];
+            const IntList *eps = &nfa->epsilon[v];
+            if (next_edge[depth - 1] < eps->count) {
+                int w = eps->items[next_edge[depth - 1]++];
+                if (order[w] < 0) {
+                    order[w] = low[w] = visited++;
+                    stack[top++] = w;
+                    frames[depth] = w;
+                    next_edge[depth++] = 0;
+                } else if (component[w] < 0 && order[w] < low[v]) {
+                    low[v] = order[w];      /* w is still on the stack */
                 }
-                int dest_states[MAX_STATES];
-                int dest_count = move(nfa, state, symbol, dest_states);
-                for (int i = 0; i < dest_count; ++i) {
-                    int closure_states[MAX_STATES];
-                    int closure_count = epsilon_closure(nfa, dest_states[i], closure_states);
-                    for (int j = 0; j < closure_count; ++j) {
-                        dest_mask |= (1 << closure_states[j]);
+                continue;
+            }
+            depth--;
+            if (depth > 0 && low[v] < low[frames[depth - 1]]) {
+                low[frames[depth - 1]] = low[v];
+            }
+            if (low[v] != order[v]) continue;
+
+            /* v roots a component: pop it and close it */
+            int c = components++;
+            int first = top;
+            do {
+                first--;
+                component[stack[first]] = c;
+                work_set_add(&set, stack[first]);
+            } while (stack[first] != v);
+            for (int i = first; i < top; ++i) {
+                const IntList *out = &nfa->epsilon[stack[i]];
+                for (int j = 0; j < out->count; ++j) {
+                    int d = component[out->items[j]];
+                    if (d != c && merged[d] != c) {
+                        merged[d] = c;
+                        if (component_closure[d] == CLOSURE_SELF) {
+                            work_set_add(&set, out->items[j]);
+                        } else {
+                            work_set_or(&set, &closures->sets, component_closure[d]);
+                        }
                     }
                 }
             }
-            if (dest_mask == 0) {
-                continue;
+            top = first;
+            size_t members = 0;
+            for (int i = 0; i < set.word_count; ++i) {
+                members += (size_t)__builtin_popcountll(set.bits[set.words[i]]);
+            }
+            stats.closure_states += members;
+            if (members == 1) {
+                component_closure[c] = CLOSURE_SELF;
+            } else {
+                work_set_sort(&set);
+                int added;
+                component_closure[c] = state_set_find_or_add(&closures->sets, &set, &added);
+            }
+            work_set_clear(&set);
+        }
+    }
+    for (int v = 0; v < n; ++v) {
+        closures->of[v] = component_closure[component[v]];
+    }
+    stats.closures += (size_t)components;
+    free(set.words);
+    free(set.bits);
+    free(next_edge);
+    free(frames);
+    free(stack);
+    free(merged);
+    free(component_closure);
+    free(component);
+    free(low);
+    free(order);
+}
+
+static void closures_free(Closures *closures) {
+    state_set_table_free(&closures->sets);
+    free(closures->of);
+}
+
+/* Winning tag of a set of NFA states: the smallest non-zero tag. */
+static int set_tag(const NFA *nfa, const WorkSet *set) {
+    int best = 0;
+    for (int i = 0; i < set->word_count; ++i) {
+        int w = set->words[i];
+        for (SetWord bits = set->bits[w]; bits; bits &= bits - 1) {
+            int tag = nfa->tag[w * SET_WORD_BITS + __builtin_ctzll(bits)];
+            if (tag && (best == 0 || tag < best)) {
+                best = tag;
             }
+        }
+    }
+    return best;
+}
+
+/* DFA states are numbered in discovery order and processed in that order,
+ * so the state index doubles as the work queue.  Following a move ORs the
+ * target's precomputed closure into the destination set, unless the target
+ * is already there: destination sets are unions of closures, so then its
+ * closure is too. */
+static void subset_construction(const NFA *nfa, DFA *dfa) {
+    dfa_init(dfa, nfa->symbol_count);
+    int symbols = nfa->symbol_count;
+    size_t width = ((size_t)nfa->state_count + SET_WORD_BITS - 1) / SET_WORD_BITS;
+    Closures closures;
+    closures_build(nfa, &closures);
+    StateSetTable sets;
+    state_set_table_init(&sets);
+    /* one work set per symbol, plus dest[symbols] for the start state */
+    WorkSet *dest = (WorkSet *)automata_alloc(NULL, ((size_t)symbols + 1) * sizeof(WorkSet));
+    SetWord *bits = (SetWord *)automata_alloc(NULL, ((size_t)symbols + 1) * width * sizeof(SetWord));
+    int *words = (int *)automata_alloc(NULL, ((size_t)symbols + 1) * width * sizeof(int));
+    memset(bits, 0, ((size_t)symbols + 1) * width * sizeof(SetWord));
+    for (int symbol = 0; symbol <= symbols; ++symbol) {
+        dest[symbol].bits = bits + (size_t)symbol * width;
+        dest[symbol].words = words + (size_t)symbol * width;
+        dest[symbol].word_count = 0;
+    }
 
-            int target_index = -1;
-            for (int i = 0; i < dfa->state_count; ++i) {
-                if (state_sets[i] == dest_mask) {
-                    target_index = i;
-                    break;
+    WorkSet *initial = &dest[symbols];
+    closure_or(initial, &closures, nfa->start);
+    int added;
+    state_set_find_or_add(&sets, initial, &added);
+    dfa->start = dfa_add_state(dfa, set_tag(nfa, initial));
+    work_set_clear(initial);
+
+    for (int index = 0; index < sets.count; ++index) {
+        for (size_t k = sets.offset[index]; k < sets.offset[index + 1]; ++k) {
+            int base = sets.index[k] * SET_WORD_BITS;
+            for (SetWord b = sets.bits[k]; b; b &= b - 1) {
+                const MoveList *moves = &nfa->moves[base + __builtin_ctzll(b)];
+                for (int m = 0; m < moves->count; ++m) {
+                    int target = moves->items[m].target;
+                    for (int symbol = moves->items[m].lo; symbol <= moves->items[m].hi; ++symbol) {
+                        if (!work_set_has(&dest[symbol], target)) {
+                            closure_or(&dest[symbol], &closures, target);
+                        }
+                    }
                 }
             }
+        }
+        for (int symbol = 0; symbol < symbols; ++symbol) {
+            WorkSet *target = &dest[symbol];
+            if (target->word_count == 0) continue;
+            work_set_sort(target);
+            int next = state_set_find_or_add(&sets, target, &added);
+            if (added) {
+                dfa_add_state(dfa, set_tag(nfa, target));
+            }
+            dfa_row(dfa, index)[symbol] = next;
+            work_set_clear(target);
+        }
+    }
+
+    stats.set_lookups += sets.probes;
+    free(words);
+    free(bits);
+    free(dest);
+    state_set_table_free(&sets);
+    closures_free(&closures);
+}
+
+/* Parallel subset construction (-j).  Each worker owns a deque of
+ * unexpanded DFA states: it pushes the states it discovers and pops them
+ * from the same end, and an idle worker steals from the other end of
+ * someone else's deque.  State sets are deduplicated in a table split into
+ * shards by hash, each behind its own lock; a state's provisional id is
+ * its index within its shard times SUBSET_SHARDS plus the shard.  Workers
+ * record (id, tag, successor ids) for every state they expand, and once
+ * all are done the DFA is renumbered breadth first from the start state,
+ * symbols in order: the numbering subset_construction produces, so the
+ * result does not depend on the thread count or on scheduling. */
+#define SUBSET_SHARDS 64
+
+typedef struct {
+    int id;
+    int tag;
+    int count;              /* non-zero words of the set */
+    int *index;
+    SetWord *bits;
+} SubsetItem;
+
+typedef struct {
+    pthread_mutex_t lock;
+    SubsetItem **items;     /* items[head .. tail) */
+    int head;
+    int tail;
+    int cap;
+} SubsetDeque;
+
+typedef struct {
+    pthread_mutex_t lock;
+    StateSetTable sets;
+} SubsetShard;
+
+struct SubsetPool;
+
+typedef struct {
+    struct SubsetPool *pool;
+    SubsetDeque deque;
+    WorkSet *dest;          /* one work set per symbol */
+    SetWord *bits;
+    int *words;
+    int *records;           /* per expanded state: id, tag, then a successor id per symbol */
+    size_t record_count;
+    size_t record_cap;
+} SubsetWorker;
+
+typedef struct SubsetPool {
+    const NFA *nfa;
+    const Closures *closures;
+    int symbols;
+    int threads;
+    int pending;            /* states discovered but not yet expanded */
+    SubsetShard shards[SUBSET_SHARDS];
+    SubsetWorker *workers;
+} SubsetPool;
+
+static void subset_deque_push(SubsetDeque *deque, SubsetItem *item) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail == deque->cap) {
+        if (deque->head > 0) {
+            memmove(deque->items, deque->items + deque->head,
+                    (size_t)(deque->tail - deque->head) * sizeof(SubsetItem *));
+            deque->tail -= deque->head;
+            deque->head = 0;
+        } else {
+            deque->cap = deque->cap ? deque->cap * 2 : 64;
+            deque->items = (SubsetItem **)automata_alloc(deque->items, (size_t)deque->cap * sizeof(SubsetItem *));
+        }
+    }
+    deque->items[deque->tail++] = item;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+/* The owner takes its newest state, a thief the oldest. */
+static SubsetItem *subset_deque_take(SubsetDeque *deque, int steal) {
+    SubsetItem *item = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail) {
+        item = steal ? deque->items[deque->head++] : deque->items[--deque->tail];
+        if (deque->head == deque->tail) {
+            deque->head = deque->tail = 0;
+        }
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return item;
+}
+
+/* Id of the sorted set; a new set is queued on worker's deque. */
+static int subset_intern(SubsetWorker *worker, WorkSet *set) {
+    SubsetPool *pool = worker->pool;
+    work_set_sort(set);
+    unsigned long long h = state_set_hash(set);
+    int shard = (int)(h >> 58) % SUBSET_SHARDS;
+    int added;
+    pthread_mutex_lock(&pool->shards[shard].lock);
+    int local = state_set_find_or_add_hashed(&pool->shards[shard].sets, set, h, &added);
+    pthread_mutex_unlock(&pool->shards[shard].lock);
+    int id = local * SUBSET_SHARDS + shard;
+    if (added) {
+        size_t count = (size_t)set->word_count;
+        SubsetItem *item = (SubsetItem *)automata_alloc(NULL, sizeof(SubsetItem) +
+                                                        count * (sizeof(SetWord) + sizeof(int)));
+        item->id = id;
+        item->tag = set_tag(pool->nfa, set);
+        item->count = set->word_count;
+        item->bits = (SetWord *)(item + 1);
+        item->index = (int *)(item->bits + count);
+        for (size_t i = 0; i < count; ++i) {
+            item->index[i] = set->words[i];
+            item->bits[i] = set->bits[set->words[i]];
+        }
+        __atomic_fetch_add(&pool->pending, 1, __ATOMIC_RELAXED);
+        subset_deque_push(&worker->deque, item);
+    }
+    return id;
+}
 
-            if (target_index == -1) {
-                target_index = dfa->state_count;
-                state_sets[dfa->state_count] = dest_mask;
-                queue[tail++] = target_index;
-                if (dest_mask & (1 << nfa->accept)) {
-                    dfa->accept[dfa->state_count] = 1;
+static void subset_expand(SubsetWorker *worker, const SubsetItem *item) {
+    SubsetPool *pool = worker->pool;
+    const NFA *nfa = pool->nfa;
+    WorkSet *dest = worker->dest;
+    size_t stride = (size_t)pool->symbols + 2;
+    if (worker->record_count == worker->record_cap) {
+        worker->record_cap = worker->record_cap ? worker->record_cap * 2 : 256;
+        worker->records = (int *)automata_alloc(worker->records, worker->record_cap * stride * sizeof(int));
+    }
+    for (int k = 0; k < item->count; ++k) {
+        int base = item->index[k] * SET_WORD_BITS;
+        for (SetWord b = item->bits[k]; b; b &= b - 1) {
+            const MoveList *moves = &nfa->moves[base + __builtin_ctzll(b)];
+            for (int m = 0; m < moves->count; ++m) {
+                int target = moves->items[m].target;
+                for (int symbol = moves->items[m].lo; symbol <= moves->items[m].hi; ++symbol) {
+                    if (!work_set_has(&dest[symbol], target)) {
+                        closure_or(&dest[symbol], pool->closures, target);
+                    }
                 }
-                dfa->state_count++;
             }
+        }
+    }
+    int *record = worker->records + worker->record_count++ * stride;
+    record[0] = item->id;
+    record[1] = item->tag;
+    for (int symbol = 0; symbol < pool->symbols; ++symbol) {
+        record[2 + symbol] = -1;
+        if (dest[symbol].word_count == 0) continue;
+        record[2 + symbol] = subset_intern(worker, &dest[symbol]);
+        work_set_clear(&dest[symbol]);
+    }
+}
+
+static void *subset_worker_main(void *arg) {
+    SubsetWorker *worker = (SubsetWorker *)arg;
+    SubsetPool *pool = worker->pool;
+    int self = (int)(worker - pool->workers);
+    for (;;) {
+        SubsetItem *item = subset_deque_take(&worker->deque, 0);
+        for (int k = 1; !item && k < pool->threads; ++k) {
+            item = subset_deque_take(&pool->workers[(self + k) % pool->threads].deque, 1);
+        }
+        if (!item) {
+            if (__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) == 0) {
+                return NULL;
+            }
+            sched_yield();
+            continue;
+        }
+        subset_expand(worker, item);
+        free(item);
+        __atomic_fetch_sub(&pool->pending, 1, __ATOMIC_RELEASE);
+    }
+}
 
-            dfa->transitions[current_index][symbol] = target_index;
+static void parallel_subset_construction(const NFA *nfa, DFA *dfa, int threads) {
+    if (threads <= 1) {
+        subset_construction(nfa, dfa);
+        return;
+    }
+    int symbols = nfa->symbol_count;
+    size_t width = ((size_t)nfa->state_count + SET_WORD_BITS - 1) / SET_WORD_BITS;
+    Closures closures;
+    closures_build(nfa, &closures);
+    SubsetPool pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.nfa = nfa;
+    pool.closures = &closures;
+    pool.symbols = symbols;
+    pool.threads = threads;
+    for (int s = 0; s < SUBSET_SHARDS; ++s) {
+        pthread_mutex_init(&pool.shards[s].lock, NULL);
+        state_set_table_init(&pool.shards[s].sets);
+    }
+    pool.workers = (SubsetWorker *)automata_alloc(NULL, (size_t)threads * sizeof(SubsetWorker));
+    memset(pool.workers, 0, (size_t)threads * sizeof(SubsetWorker));
+    for (int t = 0; t < threads; ++t) {
+        SubsetWorker *worker = &pool.workers[t];
+        worker->pool = &pool;
+        pthread_mutex_init(&worker->deque.lock, NULL);
+        worker->dest = (WorkSet *)automata_alloc(NULL, (size_t)symbols * sizeof(WorkSet));
+        worker->bits = (SetWord *)automata_alloc(NULL, (size_t)symbols * width * sizeof(SetWord));
+        worker->words = (int *)automata_alloc(NULL, (size_t)symbols * width * sizeof(int));
+        memset(worker->bits, 0, (size_t)symbols * width * sizeof(SetWord));
+        for (int symbol = 0; symbol < symbols; ++symbol) {
+            worker->dest[symbol].bits = worker->bits + (size_t)symbol * width;
+            worker->dest[symbol].words = worker->words + (size_t)symbol * width;
+            worker->dest[symbol].word_count = 0;
         }
     }
 
-    return 0;
+    WorkSet initial;
+    initial.bits = (SetWord *)automata_alloc(NULL, (width ? width : 1) * sizeof(SetWord));
+    initial.words = (int *)automata_alloc(NULL, (width ? width : 1) * sizeof(int));
+    initial.word_count = 0;
+    memset(initial.bits, 0, width * sizeof(SetWord));
+    closure_or(&initial, &closures, nfa->start);
+    int start = subset_intern(&pool.workers[0], &initial);
+    free(initial.words);
+    free(initial.bits);
+
+    pthread_t *ids = (pthread_t *)automata_alloc(NULL, (size_t)threads * sizeof(pthread_t));
+    int started = 0;
+    while (started < threads &&
+           pthread_create(&ids[started], NULL, subset_worker_main, &pool.workers[started]) == 0) {
+        started++;
+    }
+    if (started < threads) {
+        /* the missing workers' deques are still stolen from; run one here */
+        subset_worker_main(&pool.workers[started]);
+    }
+    for (int t = 0; t < started; ++t) {
+        pthread_join(ids[t], NULL);
+    }
+    free(ids);
+
+    /* gather the records by provisional id, then number breadth first */
+    size_t stride = (size_t)symbols + 2;
+    size_t ids_bound = 0;
+    for (int s = 0; s < SUBSET_SHARDS; ++s) {
+        size_t bound = (size_t)pool.shards[s].sets.count * SUBSET_SHARDS + (size_t)s + 1;
+        if (bound > ids_bound) ids_bound = bound;
+        stats.set_lookups += pool.shards[s].sets.probes;
+    }
+    const int **record_of = (const int **)automata_alloc(NULL, ids_bound * sizeof(int *));
+    int *number = (int *)automata_alloc(NULL, ids_bound * sizeof(int));
+    for (size_t id = 0; id < ids_bound; ++id) {
+        number[id] = -1;
+    }
+    for (int t = 0; t < threads; ++t) {
+        for (size_t r = 0; r < pool.workers[t].record_count; ++r) {
+            const int *record = pool.workers[t].records + r * stride;
+            record_of[record[0]] = record;
+        }
+    }
+    dfa_init(dfa, symbols);
+    number[start] = dfa_add_state(dfa, record_of[start][1]);
+    int *order = (int *)automata_alloc(NULL, ids_bound * sizeof(int));
+    order[0] = start;
+    for (int index = 0; index < dfa->state_count; ++index) {
+        const int *record = record_of[order[index]];
+        for (int symbol = 0; symbol < symbols; ++symbol) {
+            int next = record[2 + symbol];
+            if (next < 0) continue;
+            if (number[next] < 0) {
+                order[dfa->state_count] = next;
+                number[next] = dfa_add_state(dfa, record_of[next][1]);
+            }
+            dfa_row(dfa, index)[symbol] = number[next];
+        }
+    }
+    dfa->start = 0;
+
+    free(order);
+    free(number);
+    free(record_of);
+    for (int t = 0; t < threads; ++t) {
+        SubsetWorker *worker = &pool.workers[t];
+        pthread_mutex_destroy(&worker->deque.lock);
+        free(worker->deque.items);
+        free(worker->records);
+        free(worker->words);
+        free(worker->bits);
+        free(worker->dest);
+    }
+    free(pool.workers);
+    for (int s = 0; s < SUBSET_SHARDS; ++s) {
+        pthread_mutex_destroy(&pool.shards[s].lock);
+        state_set_table_free(&pool.shards[s].sets);
+    }
+    closures_free(&closures);
 }
 
 static void ensure_total_dfa(DFA *dfa) {
     int trap_index = -1;
     for (int state = 0; state < dfa->state_count; ++state) {
-        for (int symbol = 0; symbol < ALPHABET_SIZE; ++symbol) {
-            if (dfa->transitions[state][symbol] != -1) {
+        for (int symbol = 0; symbol < dfa->symbol_count; ++symbol) {
+            if (dfa_row(dfa, state)[symbol] != -1) {
                 continue;
             }
             if (trap_index == -1) {
-                trap_index = dfa->state_count;
-                if (trap_index >= MAX_STATES) {
-                    fprintf(stderr, "DFA requires a trap state but MAX_STATES is too small.\n");
-                    return;
+                trap_index = dfa_add_state(dfa, 0);
+                int *trap = dfa_row(dfa, trap_index);
+                for (int sym = 0; sym < dfa->symbol_count; ++sym) {
+                    trap[sym] = trap_index;
                 }
-                dfa->state_count++;
-                for (int sym = 0; sym < ALPHABET_SIZE; ++sym) {
-                    dfa->transitions[trap_index][sym] = trap_index;
-                }
-                dfa->accept[trap_index] = 0;
             }
-            dfa->transitions[state][symbol] = trap_index;
+            dfa_row(dfa, state)[symbol] = trap_index;
+        }
+    }
+}
+
+/* Bytes no state tells apart form one class.  byte_classes_split refines a
+ * partition of symbols (classes[c] per symbol, count classes) by one
+ * state's moves, target[c]: symbols stay together only if they were
+ * together and go to the same place.  Classes come out numbered in order
+ * of their smallest symbol. */
+static int byte_classes_split(int *classes, int symbols, int count, const int *target) {
+    int head[MAX_SYMBOLS], chain[MAX_SYMBOLS], class_target[MAX_SYMBOLS];
+    for (int k = 0; k < count; ++k) {
+        head[k] = -1;
+    }
+    int split = 0;
+    for (int c = 0; c < symbols; ++c) {
+        int id = head[classes[c]];
+        while (id >= 0 && class_target[id] != target[c]) {
+            id = chain[id];
         }
+        if (id < 0) {
+            id = split++;
+            class_target[id] = target[c];
+            chain[id] = head[classes[c]];
+            head[classes[c]] = id;
+        }
+        classes[c] = id;
+    }
+    return split;
+}
+
+/* Hopcroft's algorithm over a refinable partition.  States are kept in
+ * elems grouped by block: block b is elems[first[b] .. end[b]), and marked
+ * states are swapped to the front of their block, up to mid[b].  A
+ * splitter (B, a) marks every state with an a-move into B (from the
+ * inverse transitions) and splits each block that is partly marked.  After
+ * a split, a block pair already waiting on symbol c both wait; otherwise
+ * only the smaller half is queued, so each state is reprocessed O(log n)
+ * times per symbol.  Time O(n k log n) and memory O(n k) for n states and
+ * k symbols.  The DFA must be total (ensure_total_dfa). */
+typedef struct {
+    int *elems;
+    int *loc;               /* position of each state in elems */
+    int *block;             /* block of each state */
+    int *first;
+    int *end;
+    int *mid;
+    int count;
+} Partition;
+
+static void partition_mark(Partition *p, int state, int *touched, int *touched_count) {
+    int b = p->block[state];
+    int i = p->loc[state];
+    int j = p->mid[b];
+    if (i < j) return;
+    if (j == p->first[b]) {
+        touched[(*touched_count)++] = b;
+    }
+    int other = p->elems[j];
+    p->elems[j] = state;
+    p->loc[state] = j;
+    p->elems[i] = other;
+    p->loc[other] = i;
+    p->mid[b] = j + 1;
+}
+
+/* Splits block b into its marked and unmarked states; the smaller part
+ * becomes the new block.  Returns the new block or -1 if b is unsplit. */
+static int partition_split(Partition *p, int b) {
+    int mid = p->mid[b];
+    p->mid[b] = p->first[b];
+    if (mid == p->end[b]) {
+        return -1;
+    }
+    int nb = p->count++;
+    if (mid - p->first[b] <= p->end[b] - mid) {
+        p->first[nb] = p->first[b];
+        p->end[nb] = mid;
+        p->first[b] = mid;
+    } else {
+        p->first[nb] = mid;
+        p->end[nb] = p->end[b];
+        p->end[b] = mid;
     }
+    p->mid[nb] = p->first[nb];
+    p->mid[b] = p->first[b];
+    for (int i = p->first[nb]; i < p->end[nb]; ++i) {
+        p->block[p->elems[i]] = nb;
+    }
+    return nb;
 }
 
 static void hopcroft_minimize(const DFA *dfa, DFA *minimized) {
-    int partition[MAX_STATES];
-    int block_count = 2;
-    int blocks[MAX_STATES][MAX_STATES];
-    int block_sizes[MAX_STATES];
+    int n = dfa->state_count;
+    int k = 1;
+    size_t nk;
+    Partition p;
+    p.elems = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    p.loc = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    p.block = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    p.first = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    p.end = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    p.mid = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    p.count = 0;
 
-    int accept_block = 0;
-    int non_accept_block = 1;
+    /* Symbols whose columns agree in every state split the same blocks, so
+     * only one symbol per column class is refined by: k becomes the class
+     * count and symbol[a] the class's smallest symbol. */
+    int *column = (int *)automata_alloc(NULL, (size_t)dfa->symbol_count * sizeof(int));
+    memset(column, 0, (size_t)dfa->symbol_count * sizeof(int));
+    for (int s = 0; s < n && k < dfa->symbol_count; ++s) {
+        k = byte_classes_split(column, dfa->symbol_count, k, dfa_row(dfa, s));
+    }
+    int *symbol = (int *)automata_alloc(NULL, (size_t)k * sizeof(int));
+    for (int c = dfa->symbol_count - 1; c >= 0; --c) {
+        symbol[column[c]] = c;
+    }
+    free(column);
+    nk = (size_t)n * (size_t)k;
 
-    block_sizes[accept_block] = 0;
-    block_sizes[non_accept_block] = 0;
+    /* Initial partition: one block per accept tag in ascending order, then
+     * the non-accepting states, so states recognising different tokens are
+     * never merged. */
+    int *tags = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    memcpy(tags, dfa->accept, (size_t)n * sizeof(int));
+    qsort(tags, (size_t)n, sizeof(int), compare_ints);
+    int tag_count = 0;
+    for (int i = 0; i < n; ++i) {
+        if (i == 0 || tags[i] != tags[i - 1]) tags[tag_count++] = tags[i];
+    }
+    if (tag_count > 0 && tags[0] == 0) {
+        memmove(tags, tags + 1, (size_t)(tag_count - 1) * sizeof(int));
+        tags[tag_count - 1] = 0;
+    }
+    int filled = 0;
+    for (int t = 0; t < tag_count; ++t) {
+        p.first[p.count] = p.mid[p.count] = filled;
+        for (int i = 0; i < n; ++i) {
+            if (dfa->accept[i] == tags[t]) {
+                p.loc[i] = filled;
+                p.elems[filled++] = i;
+                p.block[i] = p.count;
+            }
+        }
+        p.end[p.count++] = filled;
+    }
+    free(tags);
+    int *order = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    memcpy(order, p.elems, (size_t)n * sizeof(int));
 
-    for (int i = 0; i < dfa->state_count; ++i) {
-        if (dfa->accept[i]) {
-            blocks[accept_block][block_sizes[accept_block]++] = i;
-            partition[i] = accept_block;
-        } else {
-            blocks[non_accept_block][block_sizes[non_accept_block]++] = i;
-            partition[i] = non_accept_block;
-        }
-    }
-    if (block_sizes[accept_block] == 0) {
-        block_sizes[accept_block] = block_sizes[block_count - 1];
-        for (int i = 0; i < block_sizes[accept_block]; ++i) {
-            blocks[accept_block][i] = blocks[block_count - 1][i];
-        }
-        block_count--;
-    }
-    if (block_sizes[non_accept_block] == 0) {
-        block_sizes[non_accept_block] = block_sizes[block_count - 1];
-        for (int i = 0; i < block_sizes[non_accept_block]; ++i) {
-            blocks[non_accept_block][i] = blocks[block_count - 1][i];
-        }
-        block_count--;
-    }
-
-    int changed = 1;
-    while (changed) {
-        changed = 0;
-        for (int b = 0; b < block_count; ++b) {
-            if (block_sizes[b] <= 1) continue;
-            int representative = blocks[b][0];
-            int split[MAX_STATES];
-            int split_size = 0;
-            for (int i = 1; i < block_sizes[b]; ++i) {
-                int state = blocks[b][i];
-                int distinguishable = 0;
-                for (int symbol = 0; symbol < ALPHABET_SIZE; ++symbol) {
-                    int t1 = dfa->transitions[representative][symbol];
-                    int t2 = dfa->transitions[state][symbol];
-                    if (partition[t1] != partition[t2]) {
-                        distinguishable = 1;
-                        break;
-                    }
-                }
-                if (distinguishable) {
-                    split[split_size++] = state;
-                }
+    /* inverse transitions: the states entering t on a are
+     * inverse[start[a * n + t] .. start[a * n + t + 1]) */
+    size_t *start = (size_t *)automata_alloc(NULL, (nk + 1) * sizeof(size_t));
+    int *inverse = (int *)automata_alloc(NULL, nk * sizeof(int));
+    memset(start, 0, (nk + 1) * sizeof(size_t));
+    for (int s = 0; s < n; ++s) {
+        const int *row = dfa_row(dfa, s);
+        for (int a = 0; a < k; ++a) {
+            start[(size_t)a * (size_t)n + (size_t)row[symbol[a]] + 1]++;
+        }
+    }
+    for (size_t i = 0; i < nk; ++i) {
+        start[i + 1] += start[i];
+    }
+    size_t *fill = (size_t *)automata_alloc(NULL, nk * sizeof(size_t));
+    memcpy(fill, start, nk * sizeof(size_t));
+    for (int s = 0; s < n; ++s) {
+        const int *row = dfa_row(dfa, s);
+        for (int a = 0; a < k; ++a) {
+            inverse[fill[(size_t)a * (size_t)n + (size_t)row[symbol[a]]]++] = s;
+        }
+    }
+    free(fill);
+
+    /* Worklist of (block, symbol) splitters.  Queuing all initial blocks but
+     * the largest is enough: splitting by the rest implies splitting by it. */
+    unsigned char *waiting = (unsigned char *)automata_alloc(NULL, nk ? nk : 1);
+    int *work = (int *)automata_alloc(NULL, (nk ? nk : 1) * 2 * sizeof(int));
+    size_t work_count = 0;
+    memset(waiting, 0, nk);
+    int largest = 0;
+    for (int b = 1; b < p.count; ++b) {
+        if (p.end[b] - p.first[b] > p.end[largest] - p.first[largest]) largest = b;
+    }
+    for (int b = 0; b < p.count; ++b) {
+        if (b == largest) continue;
+        for (int a = 0; a < k; ++a) {
+            waiting[(size_t)b * (size_t)k + (size_t)a] = 1;
+            work[work_count * 2] = b;
+            work[work_count * 2 + 1] = a;
+            work_count++;
+        }
+    }
+
+    int *preds = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    int *touched = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    while (work_count > 0) {
+        work_count--;
+        int splitter = work[work_count * 2];
+        int a = work[work_count * 2 + 1];
+        waiting[(size_t)splitter * (size_t)k + (size_t)a] = 0;
+        stats.splitters++;
+
+        /* collect first: marking reorders states inside their blocks,
+         * including the splitter itself */
+        int pred_count = 0;
+        for (int i = p.first[splitter]; i < p.end[splitter]; ++i) {
+            size_t at = (size_t)a * (size_t)n + (size_t)p.elems[i];
+            for (size_t j = start[at]; j < start[at + 1]; ++j) {
+                preds[pred_count++] = inverse[j];
             }
-            if (split_size > 0) {
-                changed = 1;
-                block_sizes[b] -= split_size;
-                int new_block = block_count++;
-                block_sizes[new_block] = split_size;
-                for (int i = 0; i < split_size; ++i) {
-                    blocks[new_block][i] = split[i];
-                    for (int j = 0; j < block_sizes[b] + split_size; ++j) {
-                        if (blocks[b][j] == split[i]) {
-                            blocks[b][j] = blocks[b][block_sizes[b] + split_size - 1];
-                            break;
-                        }
-                    }
-                    partition[split[i]] = new_block;
+        }
+        int touched_count = 0;
+        for (int i = 0; i < pred_count; ++i) {
+            partition_mark(&p, preds[i], touched, &touched_count);
+        }
+        for (int i = 0; i < touched_count; ++i) {
+            int b = touched[i];
+            int nb = partition_split(&p, b);
+            if (nb < 0) continue;
+            stats.splits++;
+            for (int c = 0; c < k; ++c) {
+                int queue;
+                if (waiting[(size_t)b * (size_t)k + (size_t)c]) {
+                    queue = nb;
+                } else {
+                    queue = p.end[nb] - p.first[nb] <= p.end[b] - p.first[b] ? nb : b;
                 }
+                waiting[(size_t)queue * (size_t)k + (size_t)c] = 1;
+                work[work_count * 2] = queue;
+                work[work_count * 2 + 1] = c;
+                work_count++;
             }
         }
     }
+    free(touched);
+    free(preds);
+    free(work);
+    free(waiting);
+    free(inverse);
+    free(start);
 
-    memset(minimized, 0, sizeof(*minimized));
-    for (int i = 0; i < block_count; ++i) {
-        minimized->state_count++;
-        for (int j = 0; j < block_sizes[i]; ++j) {
-            if (blocks[i][j] == dfa->start) {
-                minimized->start = i;
-            }
-            if (dfa->accept[blocks[i][j]]) {
-                minimized->accept[i] = 1;
-            }
+    /* Number blocks by accept tag as in the initial partition, then by
+     * smallest state, so the result does not depend on the order splits
+     * happened in. */
+    int *number = (int *)automata_alloc(NULL, (size_t)(p.count ? p.count : 1) * sizeof(int));
+    for (int b = 0; b < p.count; ++b) {
+        number[b] = -1;
+    }
+    int numbered = 0;
+    dfa_init(minimized, dfa->symbol_count);
+    for (int i = 0; i < n; ++i) {
+        int b = p.block[order[i]];
+        if (number[b] < 0) {
+            number[b] = numbered++;
+            dfa_add_state(minimized, dfa->accept[order[i]]);
         }
     }
-    for (int i = 0; i < block_count; ++i) {
-        int representative = blocks[i][0];
-        for (int symbol = 0; symbol < ALPHABET_SIZE; ++symbol) {
-            int target = dfa->transitions[representative][symbol];
-            minimized->transitions[i][symbol] = partition[target];
+    minimized->start = n ? number[p.block[dfa->start]] : 0;
+    for (int b = 0; b < p.count; ++b) {
+        const int *row = dfa_row(dfa, p.elems[p.first[b]]);
+        int *out = dfa_row(minimized, number[b]);
+        for (int c = 0; c < dfa->symbol_count; ++c) {
+            out[c] = number[p.block[row[c]]];
         }
     }
+    free(number);
+    free(order);
+    free(symbol);
+    free(p.mid);
+    free(p.end);
+    free(p.first);
+    free(p.block);
+    free(p.loc);
+    free(p.elems);
 }
 
-static void print_dfa(const DFA *dfa, const char *title) {
+#ifndef NFA_NO_MAIN
+/* Column names for print_dfa and export_dfa_matrix; NULL names the
+ * symbols c0, c1, ... */
+static const char *const identifier_symbol_names[ALPHABET_SIZE] = {"letter", "digit"};
+
+static void print_symbol_name(const char *const *names, int symbol, const char *format) {
+    char name[16];
+    if (!names) {
+        snprintf(name, sizeof(name), "c%d", symbol);
+    }
+    printf(format, names ? names[symbol] : name);
+}
+
+/* Accepting states are listed by number, with the tag when it is not 1. */
+static void print_dfa(const DFA *dfa, const char *title, const char *const *names) {
     printf("%s\n", title);
     printf("States: %d, Start: q%d\n", dfa->state_count, dfa->start);
     printf("Accepting:");
     for (int i = 0; i < dfa->state_count; ++i) {
         if (dfa->accept[i]) {
-            printf(" q%d", i);
+            printf(dfa->accept[i] == 1 ? " q%d" : " q%d:%d", i, dfa->accept[i]);
         }
     }
     printf("\nTransition table:\n");
-    printf(" State | letter | digit\n");
+    printf(" State");
+    for (int c = 0; c < dfa->symbol_count; ++c) {
+        print_symbol_name(names, c, " | %s");
+    }
+    printf("\n");
     for (int i = 0; i < dfa->state_count; ++i) {
-        printf("  q%-3d|  ", i);
-        if (dfa->transitions[i][0] != -1) {
-            printf("q%-3d", dfa->transitions[i][0]);
-        } else {
-            printf(" -- ");
-        }
-        printf("|  ");
-        if (dfa->transitions[i][1] != -1) {
-            printf("q%-3d", dfa->transitions[i][1]);
-        } else {
-            printf(" -- ");
+        printf("  q%-3d", i);
+        for (int c = 0; c < dfa->symbol_count; ++c) {
+            printf("|  ");
+            if (dfa_row(dfa, i)[c] != -1) {
+                printf("q%-3d", dfa_row(dfa, i)[c]);
+            } else {
+                printf(" -- ");
+            }
         }
         printf("\n");
     }
     printf("\n");
 }
 
-static void export_dfa_matrix(const DFA *dfa) {
-    printf("Matrix form (rows=states, cols=letter,digit):\n");
-    for (int i = 0; i < dfa->state_count; ++i) {
-        printf("q%-3d -> [%2d %2d]%s\n", i,
-               dfa->transitions[i][0],
-               dfa->transitions[i][1],
-               dfa->accept[i] ? " *" : "");
+static void export_dfa_matrix(const DFA *dfa, const char *const *names) {
+    printf("Matrix form (rows=states, cols=");
+    for (int c = 0; c < dfa->symbol_count; ++c) {
+        print_symbol_name(names, c, c ? ",%s" : "%s");
+    }
+    printf("):\n");
+    for (int i = 0; i < dfa->state_count; ++i) {
+        printf("q%-3d -> [", i);
+        for (int c = 0; c < dfa->symbol_count; ++c) {
+            printf(c ? " %2d" : "%2d", dfa_row(dfa, i)[c]);
+        }
+        printf("]%s\n", dfa->accept[i] ? " *" : "");
     }
     printf("\n");
 }
+#endif
+
+/* Token rules of the lexer in Untitled-1.c.  Tag order is rule priority. */
+enum {
+    TAG_NONE, TAG_IDENT, TAG_INT, TAG_HEX, TAG_FLOAT, TAG_STRING, TAG_CHAR,
+    TAG_OP, TAG_PUNC, TAG_LINE_COMMENT, TAG_BLOCK_COMMENT, TAG_COUNT
+};
+
+#ifndef NFA_NO_MAIN
+static const char *tag_names[TAG_COUNT] = {
+    "NONE", "IDENT", "INT", "HEX", "FLOAT", "STRING", "CHAR",
+    "OP", "PUNC", "LINE_COMMENT", "BLOCK_COMMENT"
+};
+#endif
+
+static void nfa_add_byte(NFA *nfa, int from, int c, int to) {
+    nfa_add_range(nfa, from, c, c, to);
+}
+
+static void nfa_add_set(NFA *nfa, int from, const char *bytes, int to) {
+    for (const char *p = bytes; *p; ++p) {
+        nfa_add_byte(nfa, from, (unsigned char)*p, to);
+    }
+}
+
+/* from --any byte except those in bytes--> to */
+static void nfa_add_except(NFA *nfa, int from, const char *bytes, int to) {
+    for (int c = 0; c < MAX_SYMBOLS; ++c) {
+        if (c == 0 || !strchr(bytes, c)) {
+            nfa_add_byte(nfa, from, c, to);
+        }
+    }
+}
+
+static int nfa_add_fragment(NFA *nfa) {
+    int start = nfa_add_state(nfa, TAG_NONE);
+    nfa_add_epsilon(nfa, nfa->start, start);
+    return start;
+}
+
+/* Byte-level NFA for every token the hand-written scanner produces (blanks
+ * are skipped before the table runs).  Numbers follow scan_number exactly:
+ * a dangling '.', 'e' or exponent sign still ends a FLOAT. */
+static void build_c_token_nfa(NFA *nfa) {
+    nfa_init(nfa, MAX_SYMBOLS);
+    nfa->start = nfa_add_state(nfa, TAG_NONE);
+
+    /* [A-Za-z_][A-Za-z0-9_]* */
+    int f = nfa_add_fragment(nfa);
+    int ident = nfa_add_state(nfa, TAG_IDENT);
+    nfa_add_range(nfa, f, 'A', 'Z', ident);
+    nfa_add_range(nfa, f, 'a', 'z', ident);
+    nfa_add_byte(nfa, f, '_', ident);
+    nfa_add_range(nfa, ident, 'A', 'Z', ident);
+    nfa_add_range(nfa, ident, 'a', 'z', ident);
+    nfa_add_range(nfa, ident, '0', '9', ident);
+    nfa_add_byte(nfa, ident, '_', ident);
+
+    /* [0-9]+ ('.' [0-9]*)? ([eE] [+-]? [0-9]*)? */
+    f = nfa_add_fragment(nfa);
+    int digits = nfa_add_state(nfa, TAG_INT);
+    int fraction = nfa_add_state(nfa, TAG_FLOAT);
+    int exponent = nfa_add_state(nfa, TAG_FLOAT);
+    int sign = nfa_add_state(nfa, TAG_FLOAT);
+    int exp_digits = nfa_add_state(nfa, TAG_FLOAT);
+    nfa_add_range(nfa, f, '0', '9', digits);
+    nfa_add_range(nfa, digits, '0', '9', digits);
+    nfa_add_byte(nfa, digits, '.', fraction);
+    nfa_add_range(nfa, fraction, '0', '9', fraction);
+    nfa_add_set(nfa, digits, "eE", exponent);
+    nfa_add_set(nfa, fraction, "eE", exponent);
+    nfa_add_set(nfa, exponent, "+-", sign);
+    nfa_add_range(nfa, exponent, '0', '9', exp_digits);
+    nfa_add_range(nfa, sign, '0', '9', exp_digits);
+    nfa_add_range(nfa, exp_digits, '0', '9', exp_digits);
+
+    /* 0[xX][0-9a-fA-F]* */
+    f = nfa_add_fragment(nfa);
+    int zero = nfa_add_state(nfa, TAG_NONE);
+    int hex = nfa_add_state(nfa, TAG_HEX);
+    nfa_add_byte(nfa, f, '0', zero);
+    nfa_add_set(nfa, zero, "xX", hex);
+    nfa_add_range(nfa, hex, '0', '9', hex);
+    nfa_add_range(nfa, hex, 'a', 'f', hex);
+    nfa_add_range(nfa, hex, 'A', 'F', hex);
+
+    /* "..." and '...' with backslash escapes; newlines are allowed inside */
+    static const struct { int quote; int tag; } quoted[] = {
+        {'"', TAG_STRING}, {'\'', TAG_CHAR}
+    };
+    for (int q = 0; q < 2; ++q) {
+        char stops[3] = {(char)quoted[q].quote, '\\', '\0'};
+        f = nfa_add_fragment(nfa);
+        int body = nfa_add_state(nfa, TAG_NONE);
+        int escape = nfa_add_state(nfa, TAG_NONE);
+        int closed = nfa_add_state(nfa, quoted[q].tag);
+        nfa_add_byte(nfa, f, quoted[q].quote, body);
+        nfa_add_except(nfa, body, stops, body);
+        nfa_add_byte(nfa, body, '\\', escape);
+        nfa_add_range(nfa, escape, 0, MAX_SYMBOLS - 1, body);
+        nfa_add_byte(nfa, body, quoted[q].quote, closed);
+    }
+
+    /* '/' is an operator unless it opens a comment */
+    f = nfa_add_fragment(nfa);
+    int slash = nfa_add_state(nfa, TAG_OP);
+    int line = nfa_add_state(nfa, TAG_LINE_COMMENT);
+    int block = nfa_add_state(nfa, TAG_NONE);
+    int star = nfa_add_state(nfa, TAG_NONE);
+    int closed = nfa_add_state(nfa, TAG_BLOCK_COMMENT);
+    nfa_add_byte(nfa, f, '/', slash);
+    nfa_add_byte(nfa, slash, '/', line);
+    nfa_add_except(nfa, line, "\n", line);
+    nfa_add_byte(nfa, slash, '*', block);
+    nfa_add_except(nfa, block, "*", block);
+    nfa_add_byte(nfa, block, '*', star);
+    nfa_add_byte(nfa, star, '*', star);
+    nfa_add_byte(nfa, star, '/', closed);
+    nfa_add_except(nfa, star, "*/", block);
+
+    /* + - = ! < > take a following '=', + and - also double; * and % are
+     * always single */
+    f = nfa_add_fragment(nfa);
+    int op_done = nfa_add_state(nfa, TAG_OP);
+    nfa_add_set(nfa, f, "*%", op_done);
+    for (const char *p = "+-=!<>"; *p; ++p) {
+        int op = nfa_add_state(nfa, TAG_OP);
+        nfa_add_byte(nfa, f, (unsigned char)*p, op);
+        nfa_add_byte(nfa, op, '=', op_done);
+        if (*p == '+' || *p == '-') {
+            nfa_add_byte(nfa, op, (unsigned char)*p, op_done);
+        }
+    }
+
+    f = nfa_add_fragment(nfa);
+    int punc = nfa_add_state(nfa, TAG_PUNC);
+    nfa_add_set(nfa, f, "(){}[];,.:?&|^~#", punc);
+}
+
+/* Regular expressions compiled to epsilon-NFAs by Thompson's construction,
+ * over bytes.  Syntax: literals, '.', [classes] and [^negated] ones with
+ * ranges, escapes \n \t \r \f \v \0 \xHH \d \D \w \W \s \S (any other
+ * escaped byte is literal), (groups), alternation '|', and the postfix
+ * repeats * + ? {m} {m,} {m,n}.  '.' matches every byte but '\n'. */
+#define REGEX_MAX_REPEAT 1000
+#define REGEX_MAX_DEPTH 256
+
+typedef enum { RX_EMPTY, RX_SET, RX_CONCAT, RX_ALT, RX_REPEAT } RegexKind;
+
+/* Concatenations and alternations list their operands through child and
+ * next, so long patterns do not make the compiler recurse deeply. */
+typedef struct {
+    RegexKind kind;
+    int child;
+    int next;
+    int min;
+    int max;                /* -1: unbounded */
+    unsigned char set[MAX_SYMBOLS / 8];
+} RegexNode;
+
+typedef struct {
+    const char *pattern;
+    const char *p;
+    RegexNode *nodes;
+    int count;
+    int cap;
+    int depth;
+    const char *error;
+} RegexParser;
+
+typedef struct {
+    int start;
+    int end;
+} Fragment;
+
+static void byte_set_add(unsigned char *set, int c) {
+    set[c >> 3] |= (unsigned char)(1u << (c & 7));
+}
+
+static int byte_set_has(const unsigned char *set, int c) {
+    return (set[c >> 3] >> (c & 7)) & 1;
+}
+
+static void byte_set_range(unsigned char *set, int lo, int hi) {
+    for (int c = lo; c <= hi; ++c) {
+        byte_set_add(set, c);
+    }
+}
+
+static int regex_node(RegexParser *rp, RegexKind kind) {
+    if (rp->count == rp->cap) {
+        rp->cap = rp->cap ? rp->cap * 2 : 32;
+        rp->nodes = (RegexNode *)automata_alloc(rp->nodes, (size_t)rp->cap * sizeof(RegexNode));
+    }
+    RegexNode *node = &rp->nodes[rp->count];
+    memset(node, 0, sizeof(*node));
+    node->kind = kind;
+    node->child = node->next = -1;
+    return rp->count++;
+}
+
+static int regex_fail(RegexParser *rp, const char *message) {
+    if (!rp->error) rp->error = message;
+    return -1;
+}
+
+static int hex_digit(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* Parses the escape after a backslash.  Returns the byte for single-byte
+ * escapes; class escapes (\d, \w, ...) are added to set and return 256.
+ * Returns -1 on error. */
+static int regex_escape(RegexParser *rp, unsigned char *set) {
+    int c = (unsigned char)*rp->p;
+    if (c == '\0') return regex_fail(rp, "trailing backslash");
+    rp->p++;
+    unsigned char class_set[MAX_SYMBOLS / 8] = {0};
+    switch (c) {
+        case 'n': return '\n';
+        case 't': return '\t';
+        case 'r': return '\r';
+        case 'f': return '\f';
+        case 'v': return '\v';
+        case '0': return 0;
+        case 'x': {
+            int hi = hex_digit((unsigned char)rp->p[0]);
+            int lo = hi < 0 ? -1 : hex_digit((unsigned char)rp->p[1]);
+            if (lo < 0) return regex_fail(rp, "\\x needs two hex digits");
+            rp->p += 2;
+            return hi * 16 + lo;
+        }
+        case 'd': case 'D':
+            byte_set_range(class_set, '0', '9');
+            break;
+        case 'w': case 'W':
+            byte_set_range(class_set, '0', '9');
+            byte_set_range(class_set, 'A', 'Z');
+            byte_set_range(class_set, 'a', 'z');
+            byte_set_add(class_set, '_');
+            break;
+        case 's': case 'S':
+            byte_set_add(class_set, ' ');
+            byte_set_range(class_set, '\t', '\r');
+            break;
+        default:
+            return c;
+    }
+    int negate = c == 'D' || c == 'W' || c == 'S';
+    for (int b = 0; b < MAX_SYMBOLS; ++b) {
+        if (byte_set_has(class_set, b) != negate) byte_set_add(set, b);
+    }
+    return MAX_SYMBOLS;
+}
+
+/* [...] after the '['.  A ']' right after '[' or '[^' is literal, as is a
+ * '-' that cannot form a range. */
+static int regex_parse_class(RegexParser *rp) {
+    int node = regex_node(rp, RX_SET);
+    unsigned char set[MAX_SYMBOLS / 8] = {0};
+    int negate = *rp->p == '^';
+    if (negate) rp->p++;
+    int first = 1;
+    while (*rp->p != ']' || first) {
+        if (*rp->p == '\0') return regex_fail(rp, "unterminated [");
+        first = 0;
+        int lo = (unsigned char)*rp->p++;
+        if (lo == '\\' && (lo = regex_escape(rp, set)) < 0) return -1;
+        if (lo == MAX_SYMBOLS) continue;
+        if (rp->p[0] != '-' || rp->p[1] == ']' || rp->p[1] == '\0') {
+            byte_set_add(set, lo);
+            continue;
+        }
+        rp->p++;
+        int hi = (unsigned char)*rp->p++;
+        if (hi == '\\' && (hi = regex_escape(rp, set)) < 0) return -1;
+        if (hi == MAX_SYMBOLS) return regex_fail(rp, "class escape as range bound");
+        if (hi < lo) return regex_fail(rp, "reversed range");
+        byte_set_range(set, lo, hi);
+    }
+    rp->p++;
+    for (int c = 0; c < MAX_SYMBOLS; ++c) {
+        if (byte_set_has(set, c) != negate) byte_set_add(rp->nodes[node].set, c);
+    }
+    return node;
+}
+
+static int regex_parse_alt(RegexParser *rp);
+
+static int regex_parse_atom(RegexParser *rp) {
+    int c = (unsigned char)*rp->p++;
+    if (c == '(') {
+        if (++rp->depth > REGEX_MAX_DEPTH) return regex_fail(rp, "groups nested too deeply");
+        int node = regex_parse_alt(rp);
+        rp->depth--;
+        if (node < 0) return -1;
+        if (*rp->p != ')') return regex_fail(rp, "missing )");
+        rp->p++;
+        return node;
+    }
+    if (c == '[') {
+        return regex_parse_class(rp);
+    }
+    if (c == '*' || c == '+' || c == '?' || (c == '{' && *rp->p >= '0' && *rp->p <= '9')) {
+        rp->p--;
+        return regex_fail(rp, "nothing to repeat");
+    }
+    int node = regex_node(rp, RX_SET);
+    if (c == '.') {
+        for (int b = 0; b < MAX_SYMBOLS; ++b) {
+            if (b != '\n') byte_set_add(rp->nodes[node].set, b);
+        }
+        return node;
+    }
+    if (c == '\\') {
+        unsigned char set[MAX_SYMBOLS / 8] = {0};
+        c = regex_escape(rp, set);
+        if (c < 0) return -1;
+        if (c == MAX_SYMBOLS) {
+            memcpy(rp->nodes[node].set, set, sizeof(set));
+            return node;
+        }
+    }
+    byte_set_add(rp->nodes[node].set, c);
+    return node;
+}
+
+static int regex_parse_count(RegexParser *rp) {
+    int value = 0;
+    if (*rp->p < '0' || *rp->p > '9') return regex_fail(rp, "bad repeat count");
+    while (*rp->p >= '0' && *rp->p <= '9') {
+        value = value * 10 + (*rp->p++ - '0');
+        if (value > REGEX_MAX_REPEAT) return regex_fail(rp, "repeat count too large");
+    }
+    return value;
+}
+
+static int regex_parse_repeat(RegexParser *rp) {
+    int node = regex_parse_atom(rp);
+    while (node >= 0) {
+        int min, max;
+        char c = *rp->p;
+        if (c == '*') {
+            min = 0, max = -1;
+        } else if (c == '+') {
+            min = 1, max = -1;
+        } else if (c == '?') {
+            min = 0, max = 1;
+        } else if (c == '{' && rp->p[1] >= '0' && rp->p[1] <= '9') {
+            rp->p++;
+            if ((min = regex_parse_count(rp)) < 0) return -1;
+            max = min;
+            if (*rp->p == ',') {
+                rp->p++;
+                max = -1;
+                if (*rp->p != '}' && (max = regex_parse_count(rp)) < 0) return -1;
+            }
+            if (*rp->p != '}') return regex_fail(rp, "missing }");
+            if (max >= 0 && max < min) return regex_fail(rp, "repeat bounds out of order");
+        } else {
+            break;
+        }
+        rp->p++;
+        int repeat = regex_node(rp, RX_REPEAT);
+        rp->nodes[repeat].child = node;
+        rp->nodes[repeat].min = min;
+        rp->nodes[repeat].max = max;
+        node = repeat;
+    }
+    return node;
+}
+
+/* Builds a CONCAT or ALT node from a list of operands, or returns the only
+ * operand. */
+static int regex_parse_list(RegexParser *rp, RegexKind kind, int (*operand)(RegexParser *),
+                            char separator) {
+    int first = operand(rp);
+    if (first < 0) return -1;
+    int last = first;
+    while (separator ? *rp->p == separator : *rp->p && *rp->p != '|' && *rp->p != ')') {
+        if (separator) rp->p++;
+        int item = operand(rp);
+        if (item < 0) return -1;
+        rp->nodes[last].next = item;
+        last = item;
+    }
+    if (last == first) return first;
+    int node = regex_node(rp, kind);
+    rp->nodes[node].child = first;
+    return node;
+}
+
+static int regex_parse_concat(RegexParser *rp) {
+    if (*rp->p == '\0' || *rp->p == '|' || *rp->p == ')') {
+        return regex_node(rp, RX_EMPTY);
+    }
+    return regex_parse_list(rp, RX_CONCAT, regex_parse_repeat, '\0');
+}
+
+static int regex_parse_alt(RegexParser *rp) {
+    return regex_parse_list(rp, RX_ALT, regex_parse_concat, '|');
+}
 
-int main(void) {
+static Fragment regex_compile(NFA *nfa, const RegexParser *rp, int index) {
+    const RegexNode *node = &rp->nodes[index];
+    Fragment f;
+    switch (node->kind) {
+        case RX_EMPTY:
+            f.start = f.end = nfa_add_state(nfa, 0);
+            break;
+        case RX_SET: {
+            f.start = nfa_add_state(nfa, 0);
+            f.end = nfa_add_state(nfa, 0);
+            for (int c = 0; c < MAX_SYMBOLS; ++c) {
+                if (!byte_set_has(node->set, c)) continue;
+                int hi = c;
+                while (hi + 1 < MAX_SYMBOLS && byte_set_has(node->set, hi + 1)) hi++;
+                nfa_add_range(nfa, f.start, c, hi, f.end);
+                c = hi;
+            }
+            break;
+        }
+        case RX_CONCAT:
+            f = regex_compile(nfa, rp, node->child);
+            for (int item = rp->nodes[node->child].next; item >= 0; item = rp->nodes[item].next) {
+                Fragment g = regex_compile(nfa, rp, item);
+                nfa_add_epsilon(nfa, f.end, g.start);
+                f.end = g.end;
+            }
+            break;
+        case RX_ALT:
+            f.start = nfa_add_state(nfa, 0);
+            f.end = nfa_add_state(nfa, 0);
+            for (int item = node->child; item >= 0; item = rp->nodes[item].next) {
+                Fragment g = regex_compile(nfa, rp, item);
+                nfa_add_epsilon(nfa, f.start, g.start);
+                nfa_add_epsilon(nfa, g.end, f.end);
+            }
+            break;
+        case RX_REPEAT: {
+            /* min required copies, then either a loop or max - min optional
+             * copies, each of which may be skipped to the end */
+            f.start = f.end = nfa_add_state(nfa, 0);
+            for (int i = 0; i < node->min; ++i) {
+                Fragment g = regex_compile(nfa, rp, node->child);
+                nfa_add_epsilon(nfa, f.end, g.start);
+                f.end = g.end;
+            }
+            if (node->max < 0) {
+                int loop = nfa_add_state(nfa, 0);
+                Fragment g = regex_compile(nfa, rp, node->child);
+                nfa_add_epsilon(nfa, f.end, loop);
+                nfa_add_epsilon(nfa, loop, g.start);
+                nfa_add_epsilon(nfa, g.end, loop);
+                f.end = loop;
+            } else if (node->max > node->min) {
+                int end = nfa_add_state(nfa, 0);
+                for (int i = node->min; i < node->max; ++i) {
+                    Fragment g = regex_compile(nfa, rp, node->child);
+                    nfa_add_epsilon(nfa, f.end, end);
+                    nfa_add_epsilon(nfa, f.end, g.start);
+                    f.end = g.end;
+                }
+                nfa_add_epsilon(nfa, f.end, end);
+                f.end = end;
+            }
+            break;
+        }
+    }
+    return f;
+}
+
+/* Adds pattern to a byte NFA as one more alternative of its start state,
+ * accepting with tag.  Returns -1 (after printing where) on a syntax
+ * error, leaving the NFA unchanged. */
+static int regex_to_nfa(NFA *nfa, const char *pattern, int tag) {
+    RegexParser rp;
+    memset(&rp, 0, sizeof(rp));
+    rp.pattern = rp.p = pattern;
+    int root = regex_parse_alt(&rp);
+    if (root >= 0 && *rp.p == ')') {
+        root = regex_fail(&rp, "unmatched )");
+    }
+    if (root < 0) {
+        fprintf(stderr, "regex: %s at offset %d in \"%s\"\n", rp.error, (int)(rp.p - pattern), pattern);
+        free(rp.nodes);
+        return -1;
+    }
+    Fragment f = regex_compile(nfa, &rp, root);
+    free(rp.nodes);
+    nfa_add_epsilon(nfa, nfa->start, f.start);
+    nfa->tag[f.end] = tag;
+    return 0;
+}
+
+/* A fresh byte NFA holding just pattern, with tag 1. */
+static int build_regex_nfa(NFA *nfa, const char *pattern) {
+    nfa_init(nfa, MAX_SYMBOLS);
+    if (regex_to_nfa(nfa, pattern, 1) != 0) {
+        nfa_free(nfa);
+        return -1;
+    }
+    return 0;
+}
+
+/* A rule set: the union of the rules' patterns, rule i accepting with tag
+ * i + 1.  Longest match picks the rule, and among rules matching the same
+ * longest prefix the earlier one wins, so keywords go before identifiers.
+ * Minimization starts from one block per tag, so rules stay apart. */
+typedef struct {
+    const char *name;
+    const char *pattern;
+} RegexRule;
+
+static int build_rules_nfa(NFA *nfa, const RegexRule *rules, int count) {
+    nfa_init(nfa, MAX_SYMBOLS);
+    nfa->start = nfa_add_state(nfa, TAG_NONE);
+    for (int i = 0; i < count; ++i) {
+        if (regex_to_nfa(nfa, rules[i].pattern, i + 1) != 0) {
+            fprintf(stderr, "in rule %s\n", rules[i].name);
+            nfa_free(nfa);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+#ifndef NFA_NO_MAIN
+/* Reads rules from path: one "name pattern" per line, name and pattern
+ * separated by blanks, the pattern running to the end of the line; blank
+ * lines and lines starting with '#' are skipped.  The rules point into
+ * *text, which the caller frees along with *rules.  Returns the rule
+ * count, or -1. */
+static int load_rules(const char *path, char **text, RegexRule **rules) {
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return -1;
+    }
+    size_t len = 0, cap = 4096;
+    char *buf = (char *)automata_alloc(NULL, cap);
+    for (size_t n; (n = fread(buf + len, 1, cap - len - 1, in)) > 0;) {
+        len += n;
+        if (cap - len - 1 == 0) {
+            cap *= 2;
+            buf = (char *)automata_alloc(buf, cap);
+        }
+    }
+    fclose(in);
+    buf[len] = '\0';
+    int count = 0, rule_cap = 0;
+    RegexRule *list = NULL;
+    int line = 0;
+    for (char *p = buf; *p;) {
+        char *end = p + strcspn(p, "\n");
+        char *next = *end ? end + 1 : end;
+        line++;
+        while (end > p && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) end--;
+        *end = '\0';
+        p += strspn(p, " \t");
+        if (*p && *p != '#') {
+            char *name = p;
+            p += strcspn(p, " \t");
+            if (*p) *p++ = '\0';
+            p += strspn(p, " \t");
+            if (!*p) {
+                fprintf(stderr, "%s:%d: rule %s has no pattern\n", path, line, name);
+                free(list);
+                free(buf);
+                return -1;
+            }
+            if (count == rule_cap) {
+                rule_cap = rule_cap ? rule_cap * 2 : 16;
+                list = (RegexRule *)automata_alloc(list, (size_t)rule_cap * sizeof(RegexRule));
+            }
+            list[count].name = name;
+            list[count].pattern = p;
+            count++;
+        }
+        p = next;
+    }
+    *text = buf;
+    *rules = list;
+    return count;
+}
+#endif
+
+/* Rewrites a byte NFA over byte classes, one symbol per class, and stores
+ * the class of every byte in byte_symbol.  Bytes are split by membership
+ * in each move's range, so bytes of one class take the same moves
+ * everywhere.  Returns the class count. */
+static int nfa_compress_alphabet(NFA *nfa, int byte_symbol[MAX_SYMBOLS]) {
+    int count = 1;
+    int inside[MAX_SYMBOLS];
+    memset(byte_symbol, 0, MAX_SYMBOLS * sizeof(int));
+    for (int s = 0; s < nfa->state_count && count < MAX_SYMBOLS; ++s) {
+        const MoveList *moves = &nfa->moves[s];
+        for (int m = 0; m < moves->count && count < MAX_SYMBOLS; ++m) {
+            for (int c = 0; c < MAX_SYMBOLS; ++c) {
+                inside[c] = c >= moves->items[m].lo && c <= moves->items[m].hi;
+            }
+            count = byte_classes_split(byte_symbol, MAX_SYMBOLS, count, inside);
+        }
+    }
+    /* each move becomes the runs of consecutive classes its bytes fall in */
+    unsigned char covered[MAX_SYMBOLS];
+    for (int s = 0; s < nfa->state_count; ++s) {
+        MoveList old = nfa->moves[s];
+        memset(&nfa->moves[s], 0, sizeof(MoveList));
+        for (int m = 0; m < old.count; ++m) {
+            memset(covered, 0, (size_t)count);
+            for (int c = old.items[m].lo; c <= old.items[m].hi; ++c) {
+                covered[byte_symbol[c]] = 1;
+            }
+            for (int k = 0; k < count; ++k) {
+                if (!covered[k]) continue;
+                int hi = k;
+                while (hi + 1 < count && covered[hi + 1]) hi++;
+                nfa_add_range(nfa, s, k, hi, old.items[m].target);
+                k = hi;
+            }
+        }
+        free(old.items);
+    }
+    nfa->symbol_count = count;
+    return count;
+}
+
+static int find_dead_state(const DFA *dfa) {
+    for (int i = 0; i < dfa->state_count; ++i) {
+        if (dfa->accept[i]) continue;
+        int loops = 1;
+        for (int c = 0; c < dfa->symbol_count && loops; ++c) {
+            loops = dfa_row(dfa, i)[c] == i;
+        }
+        if (loops) return i;
+    }
+    return -1;
+}
+
+#ifndef NFA_NO_MAIN
+/* Marks states the scanner can skip through in bulk: those whose self-loop
+ * covers exactly the identifier bytes, or every byte but one or two.  A
+ * state S that loops on everything but a, where a leads to T with T --a--> T,
+ * T --b--> F and every other byte back to S, only leaves {S, T} on the pair
+ * "ab"; the scanner can jump straight to that pair (block comment bodies). */
+static void dfa_state_accel(const DFA *dfa, int state, int accel[3]) {
+    int escapes[MAX_SYMBOLS];
+    int escape_count = 0;
+    int ident_loop = 1;
+    for (int c = 0; c < dfa->symbol_count; ++c) {
+        int loops = dfa_row(dfa, state)[c] == state;
+        int is_ident = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') ||
+                       (c >= 'a' && c <= 'z') || c == '_';
+        if (loops != is_ident) ident_loop = 0;
+        if (!loops) escapes[escape_count++] = c;
+    }
+    accel[0] = accel[1] = accel[2] = 0;
+    if (ident_loop) {
+        accel[0] = 1;
+    } else if (escape_count == 1 || escape_count == 2) {
+        accel[0] = 2;
+        accel[1] = escapes[0];
+        accel[2] = escapes[escape_count - 1];
+    }
+    if (escape_count != 1) {
+        return;
+    }
+    int a = escapes[0];
+    int t = dfa_row(dfa, state)[a];
+    if (t == state || dfa_row(dfa, t)[a] != t) {
+        return;
+    }
+    int b = -1;
+    for (int c = 0; c < dfa->symbol_count; ++c) {
+        int next = dfa_row(dfa, t)[c];
+        if (c == a || next == state) continue;
+        if (b != -1) return;
+        b = c;
+    }
+    if (b != -1 && dfa_row(dfa, t)[b] != t) {
+        accel[0] = 3;
+        accel[2] = b;
+    }
+}
+#endif
+
+/* Byte to symbol mapping of the identifier automaton: letters are symbol 0,
+ * digits symbol 1, and every other byte has no transition. */
+static void identifier_byte_symbols(int map[MAX_SYMBOLS]) {
+    for (int c = 0; c < MAX_SYMBOLS; ++c) {
+        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) {
+            map[c] = 0;
+        } else if (c >= '0' && c <= '9') {
+            map[c] = 1;
+        } else {
+            map[c] = -1;
+        }
+    }
+}
+
+/* State reached from state on byte c, or -1 when the match cannot continue
+ * (no transition, or the dead state).  byte_symbol maps bytes to symbols;
+ * NULL means the DFA already runs over bytes. */
+static int dfa_byte_target(const DFA *dfa, const int *byte_symbol, int dead, int state, int c) {
+    int symbol = byte_symbol ? byte_symbol[c] : c;
+    if (symbol < 0 || symbol >= dfa->symbol_count) {
+        return -1;
+    }
+    int next = dfa_row(dfa, state)[symbol];
+    return next == dead ? -1 : next;
+}
+
+/* Byte classes of a DFA under byte_symbol: bytes with the same target in
+ * every state share a class; representative[k] is the smallest byte of
+ * class k. */
+static int dfa_byte_classes(const DFA *dfa, const int *byte_symbol, int dead, unsigned char classes[MAX_SYMBOLS],
+                            int representative[MAX_SYMBOLS]) {
+    int byte_class[MAX_SYMBOLS] = {0};
+    int target[MAX_SYMBOLS];
+    int count = 1;
+    for (int s = 0; s < dfa->state_count && count < MAX_SYMBOLS; ++s) {
+        for (int c = 0; c < MAX_SYMBOLS; ++c) {
+            target[c] = dfa_byte_target(dfa, byte_symbol, dead, s, c);
+        }
+        count = byte_classes_split(byte_class, MAX_SYMBOLS, count, target);
+    }
+    for (int c = MAX_SYMBOLS - 1; c >= 0; --c) {
+        classes[c] = (unsigned char)byte_class[c];
+        representative[byte_class[c]] = c;
+    }
+    return count;
+}
+
+/* Table-walking executor.  Bytes are first mapped to the DFA's byte
+ * classes, so each state's row has one entry per class instead of 256 and
+ * the table stays small.  A row is the state's accept tag followed by the
+ * row offset of the next state per class; missing transitions and the dead
+ * state become DFA_MATCH_STOP.  byte_class[] holds class + 1 so it indexes
+ * the row directly, and the loop is two loads and one compare per byte. */
+#define DFA_MATCH_STOP 0xFFFFFFFFu
+
+typedef struct {
+    const unsigned char *byte_class;    /* MAX_SYMBOLS entries */
+    const unsigned *table;
+    int stride;             /* classes + 1 */
+    int states;             /* rows in table */
+    unsigned start;         /* row offset of the start state */
+    void *storage;          /* the block holding byte_class and table, NULL when they are mapped */
+} DFAMatcher;
+
+/* Fails (-1) when the table would not fit 32-bit row offsets. */
+static int dfa_matcher_init(DFAMatcher *m, const DFA *dfa, const int *byte_symbol) {
+    int dead = find_dead_state(dfa);
+    unsigned char classes[MAX_SYMBOLS];
+    int representative[MAX_SYMBOLS];
+    int class_count = dfa_byte_classes(dfa, byte_symbol, dead, classes, representative);
+    size_t stride = (size_t)class_count + 1;
+    if ((size_t)dfa->state_count * stride >= DFA_MATCH_STOP) {
+        fprintf(stderr, "DFA has too many states for a table matcher.\n");
+        return -1;
+    }
+    size_t table_size = (size_t)dfa->state_count * stride * sizeof(unsigned);
+    m->storage = automata_alloc(NULL, table_size + MAX_SYMBOLS);
+    unsigned *table = (unsigned *)m->storage;
+    unsigned char *byte_class = (unsigned char *)m->storage + table_size;
+    for (int c = 0; c < MAX_SYMBOLS; ++c) {
+        byte_class[c] = (unsigned char)(classes[c] + 1);
+    }
+    m->byte_class = byte_class;
+    m->table = table;
+    m->stride = (int)stride;
+    m->states = dfa->state_count;
+    for (int s = 0; s < dfa->state_count; ++s) {
+        unsigned *row = table + (size_t)s * stride;
+        row[0] = (unsigned)dfa->accept[s];
+        for (int k = 0; k < class_count; ++k) {
+            int next = dfa_byte_target(dfa, byte_symbol, dead, s, representative[k]);
+            row[k + 1] = next < 0 ? DFA_MATCH_STOP : (unsigned)((size_t)next * stride);
+        }
+    }
+    m->start = (unsigned)((size_t)dfa->start * stride);
+    return 0;
+}
+
+static void dfa_matcher_free(DFAMatcher *m) {
+    free(m->storage);
+    m->storage = NULL;
+    m->table = NULL;
+}
+
+/* Longest match at the start of in[0..len): returns its length and stores
+ * the accepting state's tag in *tag (0 when no prefix, not even the empty
+ * one, is accepted). */
+static size_t dfa_match(const DFAMatcher *m, const unsigned char *in, size_t len, int *tag) {
+    const unsigned *table = m->table;
+    const unsigned char *byte_class = m->byte_class;
+    unsigned row = m->start;
+    size_t best = 0;
+    int best_tag = (int)table[row];
+    for (size_t i = 0; i < len;) {
+        row = table[row + byte_class[in[i++]]];
+        if (row == DFA_MATCH_STOP) break;
+        if (table[row]) {
+            best = i;
+            best_tag = (int)table[row];
+        }
+    }
+    *tag = best_tag;
+    return best;
+}
+
+/* Lazy DFA: determinization on demand, for automata too large to build in
+ * full.  DFA states are created only when the input reaches them; each
+ * cached state is a set in a StateSetTable plus a row, laid out as in
+ * DFAMatcher: the accept tag, then the row offset of the next state per
+ * symbol, which starts out LAZY_UNKNOWN.  A miss computes the successor set from the NFA
+ * (precomputed epsilon closures ORed together, as in subset construction)
+ * and caches it.  Once max_states are cached, a new state flushes the
+ * whole cache, which restarts from the start state, so memory stays
+ * bounded however many states the full DFA would have. */
+#define LAZY_UNKNOWN (-2)
+#define LAZY_DEAD (-1)
+
+typedef struct {
+    const NFA *nfa;         /* must outlive the lazy DFA */
+    Closures closures;
+    StateSetTable sets;     /* cached DFA states; state 0 is the start */
+    int *rows;              /* state s at s * stride: tag, then a row offset, LAZY_UNKNOWN or LAZY_DEAD per symbol */
+    int stride;             /* symbol_count + 1 */
+    int max_states;
+    int byte_symbol[MAX_SYMBOLS];   /* symbol of each byte, -1 for none */
+    WorkSet initial;        /* the start state's set, kept for flushes */
+    WorkSet scratch;
+    size_t hits;            /* transitions found in the cache */
+    size_t misses;          /* transitions computed from the NFA */
+    size_t flushes;
+    size_t built;           /* states added, counting those flushed */
+} LazyDFA;
+
+/* Row offset of the cached state for set, adding it when it is new. */
+static int lazy_dfa_add(LazyDFA *lazy, const WorkSet *set) {
+    int added;
+    int state = state_set_find_or_add(&lazy->sets, set, &added);
+    int *row = lazy->rows + (size_t)state * (size_t)lazy->stride;
+    if (added) {
+        lazy->built++;
+        row[0] = set_tag(lazy->nfa, set);
+        for (int c = 1; c < lazy->stride; ++c) {
+            row[c] = LAZY_UNKNOWN;
+        }
+    }
+    return state * lazy->stride;
+}
+
+static void lazy_dfa_flush(LazyDFA *lazy) {
+    state_set_table_reset(&lazy->sets);
+    lazy_dfa_add(lazy, &lazy->initial);
+}
+
+/* byte_symbol maps bytes to the NFA's symbols (NULL: the NFA runs over
+ * bytes).  At least two states are cached: the start state and the one
+ * being entered. */
+static void lazy_dfa_init(LazyDFA *lazy, const NFA *nfa, const int *byte_symbol, int max_states) {
+    size_t width = ((size_t)nfa->state_count + SET_WORD_BITS - 1) / SET_WORD_BITS;
+    memset(lazy, 0, sizeof(*lazy));
+    lazy->nfa = nfa;
+    lazy->stride = nfa->symbol_count + 1;
+    if (max_states > INT_MAX / lazy->stride - 1) {
+        max_states = INT_MAX / lazy->stride - 1;    /* row offsets are ints */
+    }
+    lazy->max_states = max_states < 2 ? 2 : max_states;
+    for (int c = 0; c < MAX_SYMBOLS; ++c) {
+        int symbol = byte_symbol ? byte_symbol[c] : c;
+        lazy->byte_symbol[c] = symbol >= 0 && symbol < nfa->symbol_count ? symbol : -1;
+    }
+    closures_build(nfa, &lazy->closures);
+    state_set_table_init(&lazy->sets);
+    /* one spare row: a new state is added before the cache is found full */
+    lazy->rows = (int *)automata_alloc(NULL, ((size_t)lazy->max_states + 1) * (size_t)lazy->stride * sizeof(int));
+    WorkSet *sets[2] = {&lazy->initial, &lazy->scratch};
+    for (int k = 0; k < 2; ++k) {
+        sets[k]->bits = (SetWord *)automata_alloc(NULL, (width ? width : 1) * sizeof(SetWord));
+        sets[k]->words = (int *)automata_alloc(NULL, (width ? width : 1) * sizeof(int));
+        sets[k]->word_count = 0;
+        memset(sets[k]->bits, 0, width * sizeof(SetWord));
+    }
+    closure_or(&lazy->initial, &lazy->closures, nfa->start);
+    lazy_dfa_add(lazy, &lazy->initial);
+}
+
+static void lazy_dfa_free(LazyDFA *lazy) {
+    closures_free(&lazy->closures);
+    state_set_table_free(&lazy->sets);
+    free(lazy->rows);
+    free(lazy->initial.bits);
+    free(lazy->initial.words);
+    free(lazy->scratch.bits);
+    free(lazy->scratch.words);
+}
+
+/* The miss path: the successor of the cached state at row on symbol,
+ * computed from the NFA and cached (LAZY_DEAD when the set is empty).  A
+ * flush drops that state, so its row is only filled in when the cache kept
+ * it. */
+static int lazy_dfa_step(LazyDFA *lazy, int row, int symbol) {
+    const NFA *nfa = lazy->nfa;
+    WorkSet *dest = &lazy->scratch;
+    const StateSetTable *sets = &lazy->sets;
+    int state = row / lazy->stride;
+    lazy->misses++;
+    for (size_t k = sets->offset[state]; k < sets->offset[state + 1]; ++k) {
+        int base = sets->index[k] * SET_WORD_BITS;
+        for (SetWord b = sets->bits[k]; b; b &= b - 1) {
+            const MoveList *moves = &nfa->moves[base + __builtin_ctzll(b)];
+            for (int m = 0; m < moves->count; ++m) {
+                int target = moves->items[m].target;
+                if (moves->items[m].lo <= symbol && symbol <= moves->items[m].hi &&
+                    !work_set_has(dest, target)) {
+                    closure_or(dest, &lazy->closures, target);
+                }
+            }
+        }
+    }
+    int *slot = lazy->rows + row + 1 + symbol;
+    if (dest->word_count == 0) {
+        *slot = LAZY_DEAD;
+        return LAZY_DEAD;
+    }
+    work_set_sort(dest);
+    int count = lazy->sets.count;
+    int next = lazy_dfa_add(lazy, dest);
+    if (lazy->sets.count > count && lazy->sets.count > lazy->max_states) {
+        lazy->flushes++;
+        lazy_dfa_flush(lazy);
+        next = lazy_dfa_add(lazy, dest);
+    } else {
+        *slot = next;
+    }
+    work_set_clear(dest);
+    return next;
+}
+
+/* Longest match, as dfa_match, with transitions taken from the cache. */
+static size_t lazy_dfa_match(LazyDFA *lazy, const unsigned char *in, size_t len, int *tag) {
+    int row = 0;
+    size_t best = 0;
+    size_t steps = 0;
+    int best_tag = lazy->rows[0];
+    for (size_t i = 0; i < len;) {
+        int symbol = lazy->byte_symbol[in[i++]];
+        if (symbol < 0) break;
+        int next = lazy->rows[row + 1 + symbol];
+        if (next == LAZY_UNKNOWN) {
+            next = lazy_dfa_step(lazy, row, symbol);
+        } else {
+            steps++;
+        }
+        if (next == LAZY_DEAD) break;
+        row = next;
+        if (lazy->rows[row]) {
+            best = i;
+            best_tag = lazy->rows[row];
+        }
+    }
+    lazy->hits += steps;
+    *tag = best_tag;
+    return best;
+}
+
+/* Binary DFA files (--save, --load, --dump): a minimal DFA's table matcher
+ * written out so later runs map it instead of rebuilding it.  Layout:
+ *
+ *   0     DfaFileHeader (64 bytes)
+ *   64    byte class map, MAX_SYMBOLS bytes (class + 1 per byte)
+ *   320   transition table, states * stride unsigned ints; each row is the
+ *         state's accept tag, then the row offset of the next state per
+ *         class or DFA_MATCH_STOP
+ *
+ * Sections start on DFA_FILE_ALIGN boundaries, so the mapped table is
+ * aligned and DFAMatcher points straight into it.  Numbers are in the
+ * writer's byte order; a reader with the other order rejects the file by
+ * its byte_order field.  The checksum covers the header (bar the checksum
+ * itself) and everything after it, and opening also checks that every
+ * offset stays inside the table, so a damaged file is refused rather than
+ * matched out of bounds. */
+#define DFA_FILE_MAGIC "CDFA"
+#define DFA_FILE_VERSION 1
+#define DFA_FILE_BYTE_ORDER 0x01020304u
+#define DFA_FILE_ALIGN 64
+
+typedef struct {
+    char magic[4];
+    unsigned version;
+    unsigned byte_order;
+    unsigned header_size;
+    unsigned states;
+    unsigned stride;        /* classes + 1 */
+    unsigned start;         /* row offset of the start state */
+    unsigned reserved;
+    unsigned long long class_offset;
+    unsigned long long table_offset;
+    unsigned long long file_size;
+    unsigned long long checksum;
+} DfaFileHeader;
+
+typedef char dfa_file_header_is_64_bytes[sizeof(DfaFileHeader) == 64 ? 1 : -1];
+
+typedef struct {
+    DFAMatcher matcher;     /* byte_class and table point into the mapping */
+    const unsigned char *data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} DFAFile;
+
+/* 64-bit multiply-xorshift over 8-byte words, continuing from h. */
+static unsigned long long dfa_file_checksum(const unsigned char *p, size_t len, unsigned long long h) {
+    for (; len >= 8; p += 8, len -= 8) {
+        unsigned long long w;
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    }
+    for (; len > 0; ++p, --len) {
+        h = (h ^ *p) * 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+static unsigned long long dfa_file_sum(const DfaFileHeader *header, const unsigned char *body, size_t len) {
+    unsigned long long h = dfa_file_checksum((const unsigned char *)header, offsetof(DfaFileHeader, checksum),
+                                             STATE_SET_HASH_SEED);
+    return dfa_file_checksum(body, len, h);
+}
+
+static size_t dfa_file_align(size_t offset) {
+    return (offset + DFA_FILE_ALIGN - 1) / DFA_FILE_ALIGN * DFA_FILE_ALIGN;
+}
+
+static int dfa_file_write(const char *path, const DFAMatcher *m) {
+    size_t table_size = (size_t)m->states * (size_t)m->stride * sizeof(unsigned);
+    DfaFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DFA_FILE_MAGIC, 4);
+    header.version = DFA_FILE_VERSION;
+    header.byte_order = DFA_FILE_BYTE_ORDER;
+    header.header_size = (unsigned)sizeof(header);
+    header.states = (unsigned)m->states;
+    header.stride = (unsigned)m->stride;
+    header.start = m->start;
+    header.class_offset = dfa_file_align(sizeof(header));
+    header.table_offset = dfa_file_align((size_t)header.class_offset + MAX_SYMBOLS);
+    header.file_size = header.table_offset + table_size;
+    size_t body_size = (size_t)header.file_size - sizeof(header);
+    unsigned char *body = (unsigned char *)automata_alloc(NULL, body_size);
+    memset(body, 0, body_size);
+    memcpy(body + header.class_offset - sizeof(header), m->byte_class, MAX_SYMBOLS);
+    memcpy(body + header.table_offset - sizeof(header), m->table, table_size);
+    header.checksum = dfa_file_sum(&header, body, body_size);
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        fprintf(stderr, "cannot write %s\n", path);
+        free(body);
+        return -1;
+    }
+    int ok = fwrite(&header, 1, sizeof(header), out) == sizeof(header) &&
+             fwrite(body, 1, body_size, out) == body_size;
+    ok = fclose(out) == 0 && ok;
+    free(body);
+    if (!ok) {
+        fprintf(stderr, "cannot write %s\n", path);
+        remove(path);
+        return -1;
+    }
+    return 0;
+}
+
+static void dfa_file_unmap(DFAFile *f) {
+#ifdef _WIN32
+    UnmapViewOfFile(f->data);
+    CloseHandle(f->mapping);
+    CloseHandle(f->file);
+#else
+    munmap((void *)f->data, f->size);
+#endif
+}
+
+/* Why the mapped file cannot be used, or NULL when it can. */
+static const char *dfa_file_check(const DFAFile *f) {
+    DfaFileHeader header;
+    if (f->size < sizeof(header)) return "too short";
+    memcpy(&header, f->data, sizeof(header));
+    if (memcmp(header.magic, DFA_FILE_MAGIC, 4) != 0) return "not a DFA file";
+    if (header.version != DFA_FILE_VERSION) return "unsupported version";
+    if (header.byte_order != DFA_FILE_BYTE_ORDER) return "written with the other byte order";
+    if (header.header_size != sizeof(header) || header.file_size != f->size) return "bad header";
+    size_t cells = (size_t)header.states * (size_t)header.stride;
+    if (header.states == 0 || header.stride == 0 || header.stride > MAX_SYMBOLS + 1 || cells >= DFA_MATCH_STOP ||
+        header.class_offset < sizeof(header) || f->size < MAX_SYMBOLS ||
+        header.class_offset > f->size - MAX_SYMBOLS ||
+        header.table_offset % DFA_FILE_ALIGN != 0 || header.table_offset > f->size ||
+        (f->size - header.table_offset) / sizeof(unsigned) < cells) {
+        return "bad section layout";
+    }
+    if (header.checksum != dfa_file_sum(&header, f->data + sizeof(header), f->size - sizeof(header))) {
+        return "checksum mismatch";
+    }
+    const unsigned char *classes = f->data + header.class_offset;
+    for (int c = 0; c < MAX_SYMBOLS; ++c) {
+        if (classes[c] == 0 || classes[c] >= header.stride) return "bad byte class";
+    }
+    const unsigned *table = (const unsigned *)(f->data + header.table_offset);
+    if (header.start % header.stride != 0 || header.start >= cells) return "bad start state";
+    for (size_t k = 0; k < cells; ++k) {
+        if (k % header.stride != 0 && table[k] != DFA_MATCH_STOP &&
+            (table[k] % header.stride != 0 || table[k] >= cells)) {
+            return "transition out of range";
+        }
+    }
+    return NULL;
+}
+
+/* Maps path and checks it; the matcher then runs on the mapped table. */
+static int dfa_file_open(DFAFile *f, const char *path) {
+    memset(f, 0, sizeof(*f));
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        fprintf(stderr, "cannot open %s\n", path);
+        return -1;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const unsigned char *view = mapping ? (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        fprintf(stderr, "cannot map %s\n", path);
+        return -1;
+    }
+    f->file = file;
+    f->mapping = mapping;
+    f->data = view;
+    f->size = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        if (fd >= 0) close(fd);
+        fprintf(stderr, "cannot open %s\n", path);
+        return -1;
+    }
+    void *view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        fprintf(stderr, "cannot map %s\n", path);
+        return -1;
+    }
+    f->data = (const unsigned char *)view;
+    f->size = (size_t)st.st_size;
+#endif
+    const char *problem = dfa_file_check(f);
+    if (problem) {
+        fprintf(stderr, "%s: %s\n", path, problem);
+        dfa_file_unmap(f);
+        return -1;
+    }
+    DfaFileHeader header;
+    memcpy(&header, f->data, sizeof(header));
+    f->matcher.byte_class = f->data + header.class_offset;
+    f->matcher.table = (const unsigned *)(f->data + header.table_offset);
+    f->matcher.stride = (int)header.stride;
+    f->matcher.states = (int)header.states;
+    f->matcher.start = header.start;
+    f->matcher.storage = NULL;
+    return 0;
+}
+
+static void dfa_file_close(DFAFile *f) {
+    dfa_file_unmap(f);
+    memset(f, 0, sizeof(*f));
+}
+
+/* Subset construction, totalisation and minimization; only the minimal
+ * DFA is kept. */
+static void build_minimal_dfa(const NFA *nfa, DFA *minimized) {
+    DFA dfa;
+    parallel_subset_construction(nfa, &dfa, subset_threads);
+    ensure_total_dfa(&dfa);
+    hopcroft_minimize(&dfa, minimized);
+    dfa_free(&dfa);
+}
+
+/* Define NFA_NO_MAIN to #include this file as a library (see bench.c). */
+#ifndef NFA_NO_MAIN
+static void print_byte(int c) {
+    if (c > ' ' && c < 127 && c != '\\' && c != '-') {
+        printf("%c", c);
+    } else {
+        printf("\\x%02x", c);
+    }
+}
+
+/* --dump: the file's header and byte classes, then its DFA in the
+ * print_dfa / export_dfa_matrix text form, one column per byte class.  The
+ * table folds the dead state into "no transition", so it shows as --. */
+static void dfa_file_dump(const DFAFile *f, const char *path) {
+    const DFAMatcher *m = &f->matcher;
+    int classes = m->stride - 1;
+    printf("%s: version %d, %zu bytes, %d states, %d byte classes, checksum ok\n", path, DFA_FILE_VERSION, f->size,
+           m->states, classes);
+    printf("Byte classes:\n");
+    for (int k = 0; k < classes; ++k) {
+        printf("  c%-3d:", k);
+        for (int c = 0; c < MAX_SYMBOLS; ++c) {
+            if (m->byte_class[c] != k + 1 || (c > 0 && m->byte_class[c - 1] == k + 1)) continue;
+            int last = c;
+            while (last + 1 < MAX_SYMBOLS && m->byte_class[last + 1] == k + 1) last++;
+            printf(" ");
+            print_byte(c);
+            if (last > c) {
+                printf("-");
+                print_byte(last);
+            }
+        }
+        printf("\n");
+    }
+    printf("\n");
+    DFA dfa;
+    dfa_init(&dfa, classes);
+    for (int s = 0; s < m->states; ++s) {
+        const unsigned *row = m->table + (size_t)s * (size_t)m->stride;
+        int state = dfa_add_state(&dfa, (int)row[0]);
+        for (int k = 0; k < classes; ++k) {
+            dfa_row(&dfa, state)[k] = row[k + 1] == DFA_MATCH_STOP ? -1 : (int)(row[k + 1] / (unsigned)m->stride);
+        }
+    }
+    dfa.start = (int)(m->start / (unsigned)m->stride);
+    print_dfa(&dfa, "DFA", NULL);
+    export_dfa_matrix(&dfa, NULL);
+    dfa_free(&dfa);
+}
+
+/* --emit-matcher: the same longest match compiled to code, one label per
+ * state, so the current state lives in the instruction pointer.  Each DFA
+ * gets name_switch (a switch on the byte per state, portable C) and, under
+ * GCC/Clang, name_goto (computed goto through a per-state label table
+ * indexed by byte class). */
+static void emit_matcher_state_entry(FILE *out, const DFA *dfa, int state) {
+    fprintf(out, "q%d:\n", state);
+    if (dfa->accept[state]) {
+        fprintf(out, "    last = p;\n    best = %d;\n", dfa->accept[state]);
+    }
+    fprintf(out, "    if (p == end) goto done;\n");
+}
+
+static void emit_matcher(FILE *out, const DFA *dfa, const int *byte_symbol, const char *name) {
+    int dead = find_dead_state(dfa);
+    unsigned char classes[MAX_SYMBOLS];
+    int representative[MAX_SYMBOLS];
+    int class_count = dfa_byte_classes(dfa, byte_symbol, dead, classes, representative);
+    const char *prologue = "(const unsigned char *in, size_t len, int *tag) {\n"
+                           "    const unsigned char *p = in, *end = in + len, *last = in;\n";
+
+    int *votes = (int *)automata_alloc(NULL, ((size_t)dfa->state_count + 1) * sizeof(int));
+    fprintf(out, "/* %s: %d states, %d byte classes. */\n", name, dfa->state_count, class_count);
+    fprintf(out, "#ifdef DFA_MATCHER_GOTO\n");
+    fprintf(out, "static const unsigned char %s_class[256] = {", name);
+    for (int c = 0; c < MAX_SYMBOLS; ++c) {
+        fprintf(out, "%s%d", c == 0 ? "\n    " : c % 16 ? ", " : ",\n    ", classes[c]);
+    }
+    fprintf(out, "\n};\n\n");
+    fprintf(out, "static size_t %s_goto%s", name, prologue);
+    fprintf(out, "    static const void *const next[%d][%d] = {\n", dfa->state_count, class_count);
+    for (int s = 0; s < dfa->state_count; ++s) {
+        fprintf(out, "        {");
+        for (int k = 0; k < class_count; ++k) {
+            int next = s == dead ? -1 : dfa_byte_target(dfa, byte_symbol, dead, s, representative[k]);
+            if (next < 0) {
+                fprintf(out, "%s&&done", k ? ", " : "");
+            } else {
+                fprintf(out, "%s&&q%d", k ? ", " : "", next);
+            }
+        }
+        fprintf(out, "},\n");
+    }
+    fprintf(out, "    };\n    int best = %d;\n    goto q%d;\n", dfa->accept[dfa->start], dfa->start);
+    for (int s = 0; s < dfa->state_count; ++s) {
+        if (s == dead) continue;
+        emit_matcher_state_entry(out, dfa, s);
+        fprintf(out, "    goto *next[%d][%s_class[*p++]];\n", s, name);
+    }
+    fprintf(out, "done:\n    *tag = best;\n    return (size_t)(last - in);\n}\n#endif\n\n");
+
+    fprintf(out, "static size_t %s_switch%s", name, prologue);
+    fprintf(out, "    int best = %d;\n    goto q%d;\n", dfa->accept[dfa->start], dfa->start);
+    for (int s = 0; s < dfa->state_count; ++s) {
+        if (s == dead) continue;
+        int target[MAX_SYMBOLS];
+        memset(votes, 0, ((size_t)dfa->state_count + 1) * sizeof(int));
+        for (int c = 0; c < MAX_SYMBOLS; ++c) {
+            target[c] = dfa_byte_target(dfa, byte_symbol, dead, s, c);
+            votes[target[c] + 1]++;
+        }
+        int fallback = -1;
+        for (int t = 0; t < dfa->state_count; ++t) {
+            if (votes[t + 1] > votes[fallback + 1]) fallback = t;
+        }
+        emit_matcher_state_entry(out, dfa, s);
+        fprintf(out, "    switch (*p++) {\n");
+        for (int t = -1; t < dfa->state_count; ++t) {
+            if (t == fallback || votes[t + 1] == 0) continue;
+            int listed = 0;
+            for (int c = 0; c < MAX_SYMBOLS; ++c) {
+                if (target[c] != t) continue;
+                const char *sep = listed == 0 ? "    " : listed % 8 ? " " : "\n    ";
+                if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) {
+                    fprintf(out, "%scase '%c':", sep, c);
+                } else {
+                    fprintf(out, "%scase %d:", sep, c);
+                }
+                listed++;
+            }
+            if (t < 0) {
+                fprintf(out, "\n        goto done;\n");
+            } else {
+                fprintf(out, "\n        goto q%d;\n", t);
+            }
+        }
+        if (fallback < 0) {
+            fprintf(out, "    default:\n        goto done;\n    }\n");
+        } else {
+            fprintf(out, "    default:\n        goto q%d;\n    }\n", fallback);
+        }
+    }
+    fprintf(out, "done:\n    *tag = best;\n    return (size_t)(last - in);\n}\n\n");
+    free(votes);
+}
+
+static int emit_lexer_table(const DFA *dfa, const char *path) {
+    int dead = find_dead_state(dfa);
+    if (dead < 0 || dfa->state_count > 256) {
+        fprintf(stderr, "Lexer DFA must be total with at most 256 states.\n");
+        return -1;
+    }
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        return -1;
+    }
+    fprintf(out, "/* Generated by `nfa_to_dfa --emit-lexer %s` from build_c_token_nfa in\n", path);
+    fprintf(out, " * Untitled-2.c.  Do not edit: change the rules there and regenerate. */\n");
+    fprintf(out, "#ifndef LEXER_DFA_H\n#define LEXER_DFA_H\n\n");
+    for (int t = 1; t < TAG_COUNT; ++t) {
+        fprintf(out, "#define LEXER_TAG_%s %d\n", tag_names[t], t);
+    }
+    fprintf(out, "\n#define LEXER_DFA_STATES %d\n", dfa->state_count);
+    fprintf(out, "#define LEXER_DFA_START %d\n", dfa->start);
+    fprintf(out, "#define LEXER_DFA_DEAD %d\n\n", dead);
+    fprintf(out, "/* accel[s][0]: 1 = s loops on [A-Za-z0-9_]; 2 = s loops on every byte\n");
+    fprintf(out, " * except accel[s][1] and accel[s][2]; 3 = s can only be left through the\n");
+    fprintf(out, " * byte pair accel[s][1] accel[s][2]. */\n");
+    fprintf(out, "#define LEXER_ACCEL_IDENT 1\n#define LEXER_ACCEL_UNTIL 2\n#define LEXER_ACCEL_PAIR 3\n\n");
+    fprintf(out, "static const unsigned char lexer_dfa_accept[LEXER_DFA_STATES] = {");
+    for (int i = 0; i < dfa->state_count; ++i) {
+        fprintf(out, "%s%d", i == 0 ? "\n    " : i % 16 ? ", " : ",\n    ", dfa->accept[i]);
+    }
+    fprintf(out, "\n};\n\n");
+    fprintf(out, "static const unsigned char lexer_dfa_accel[LEXER_DFA_STATES][3] = {");
+    for (int i = 0; i < dfa->state_count; ++i) {
+        int accel[3];
+        dfa_state_accel(dfa, i, accel);
+        fprintf(out, "%s{%d, %d, %d}", i == 0 ? "\n    " : i % 8 ? ", " : ",\n    ",
+                accel[0], accel[1], accel[2]);
+    }
+    fprintf(out, "\n};\n\n");
+    fprintf(out, "static const unsigned char lexer_dfa_next[LEXER_DFA_STATES][256] = {\n");
+    for (int i = 0; i < dfa->state_count; ++i) {
+        fprintf(out, "    { /* q%d */", i);
+        for (int c = 0; c < MAX_SYMBOLS; ++c) {
+            fprintf(out, "%s%d", c == 0 ? "\n        " : c % 16 ? "," : ",\n        ",
+                    dfa_row(dfa, i)[c]);
+        }
+        fprintf(out, "\n    },\n");
+    }
+    fprintf(out, "};\n\n#endif\n");
+    fclose(out);
+    return 0;
+}
+
+static void stats_report(FILE *out, const NFA *nfa, const DFA *dfa, const DFA *minimized) {
+    static const char *const names[PHASE_COUNT] = {"build", "subset", "totalize", "minimize", "emit"};
+    fprintf(out, "states: NFA %d, DFA %d (total), minimal DFA %d\n",
+            nfa->state_count, dfa->state_count, minimized->state_count);
+    fprintf(out, "epsilon closures: %zu (%zu states reached), set lookups: %zu\n",
+            stats.closures, stats.closure_states, stats.set_lookups);
+    fprintf(out, "refinement: %zu splitters, %zu splits\n", stats.splitters, stats.splits);
+    fprintf(out, "phases:");
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        fprintf(out, " %s %.3f ms%s", names[p], stats.seconds[p] * 1e3, p + 1 < PHASE_COUNT ? "," : "\n");
+    }
+}
+
+/* --stats with --lazy: determinization happens while matching, so the
+ * subset phase is the time spent matching. */
+static void lazy_stats_report(FILE *out, const NFA *nfa, const LazyDFA *lazy) {
+    fprintf(out, "states: NFA %d, lazy DFA %d cached (at most %d), %zu built\n",
+            nfa->state_count, lazy->sets.count, lazy->max_states, lazy->built);
+    fprintf(out, "epsilon closures: %zu (%zu states reached), set lookups: %zu\n",
+            stats.closures, stats.closure_states, lazy->sets.probes);
+    fprintf(out, "cache: %zu hits, %zu misses, %zu flushes\n", lazy->hits, lazy->misses, lazy->flushes);
+    fprintf(out, "phases: build %.3f ms, subset (matching) %.3f ms\n",
+            stats.seconds[PHASE_BUILD] * 1e3, stats.seconds[PHASE_SUBSET] * 1e3);
+}
+
+/* Builds the C token automaton (NFA -> DFA -> minimal DFA) and writes the
+ * table the lexer runs. */
+static int generate_lexer_table(const char *path) {
     NFA nfa;
     DFA dfa;
     DFA minimized;
+    double t = stats_clock();
+    build_c_token_nfa(&nfa);
+    stats_phase(PHASE_BUILD, t);
+    t = stats_clock();
+    parallel_subset_construction(&nfa, &dfa, subset_threads);
+    stats_phase(PHASE_SUBSET, t);
+    t = stats_clock();
+    ensure_total_dfa(&dfa);
+    stats_phase(PHASE_TOTAL, t);
+    t = stats_clock();
+    hopcroft_minimize(&dfa, &minimized);
+    stats_phase(PHASE_MINIMIZE, t);
+    t = stats_clock();
+    int rc = emit_lexer_table(&minimized, path);
+    stats_phase(PHASE_EMIT, t);
+    if (rc == 0) {
+        if (stats_enabled) {
+            stats_report(stderr, &nfa, &dfa, &minimized);
+        }
+        printf("C token automaton: NFA %d states, DFA %d states, minimal DFA %d states -> %s\n",
+               nfa.state_count, dfa.state_count, minimized.state_count, path);
+    }
+    dfa_free(&minimized);
+    dfa_free(&dfa);
+    nfa_free(&nfa);
+    return rc;
+}
 
+/* Writes matchers for the identifier automaton and the C token automaton
+ * (tags as in lexer_dfa.h) to path. */
+static int generate_matchers(const char *path) {
+    NFA nfa;
+    DFA ident;
+    DFA tokens;
+    int ident_symbols[MAX_SYMBOLS];
     build_identifier_nfa(&nfa);
+    build_minimal_dfa(&nfa, &ident);
+    nfa_free(&nfa);
+    build_c_token_nfa(&nfa);
+    build_minimal_dfa(&nfa, &tokens);
+    nfa_free(&nfa);
+    identifier_byte_symbols(ident_symbols);
+
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        dfa_free(&tokens);
+        dfa_free(&ident);
+        return -1;
+    }
+    fprintf(out, "/* Generated by `nfa_to_dfa --emit-matcher %s` from Untitled-2.c.\n", path);
+    fprintf(out, " * Each function returns the length of the longest accepted prefix of\n");
+    fprintf(out, " * in[0..len) and stores its tag in *tag (0 when nothing matches). */\n");
+    fprintf(out, "#ifndef DFA_MATCHERS_H\n#define DFA_MATCHERS_H\n\n#include <stddef.h>\n\n");
+    fprintf(out, "#if defined(__GNUC__) && !defined(DFA_MATCHER_NO_GOTO)\n#define DFA_MATCHER_GOTO 1\n#endif\n\n");
+    emit_matcher(out, &ident, ident_symbols, "ident_match");
+    emit_matcher(out, &tokens, NULL, "c_token_match");
+    fprintf(out, "#endif\n");
+    fclose(out);
+    printf("matchers: identifier DFA %d states, C token DFA %d states -> %s\n",
+           ident.state_count, tokens.state_count, path);
+    dfa_free(&tokens);
+    dfa_free(&ident);
+    return 0;
+}
+
+/* --regex with --lazy: match through a lazy DFA of at most max_states
+ * cached states instead of building the DFA. */
+static int run_regex_lazy(const char *pattern, char **texts, int text_count, int max_states) {
+    NFA nfa;
+    LazyDFA lazy;
+    int byte_symbol[MAX_SYMBOLS];
+    double t = stats_clock();
+    if (build_regex_nfa(&nfa, pattern) != 0) {
+        return -1;
+    }
+    int classes = nfa_compress_alphabet(&nfa, byte_symbol);
+    lazy_dfa_init(&lazy, &nfa, byte_symbol, max_states);
+    stats_phase(PHASE_BUILD, t);
+    printf("regex: NFA %d states over %d byte classes, lazy DFA caching at most %d states\n",
+           nfa.state_count, classes, lazy.max_states);
+    for (int i = 0; i < text_count; ++i) {
+        int tag = 0;
+        t = stats_clock();
+        size_t n = lazy_dfa_match(&lazy, (const unsigned char *)texts[i], strlen(texts[i]), &tag);
+        stats_phase(PHASE_SUBSET, t);
+        printf("  %-8s -> %zu byte(s)%s\n", texts[i], n, tag ? ", accepted" : ", no match");
+    }
+    printf("lazy DFA: %d states cached, %zu hits, %zu misses, %zu flushes\n", lazy.sets.count, lazy.hits,
+           lazy.misses, lazy.flushes);
+    if (stats_enabled) {
+        lazy_stats_report(stderr, &nfa, &lazy);
+    }
+    lazy_dfa_free(&lazy);
+    nfa_free(&nfa);
+    return 0;
+}
+
+/* --load: match with a DFA file's mapped table, nothing rebuilt. */
+static int run_load(const char *path, char **texts, int text_count) {
+    DFAFile file;
+    if (dfa_file_open(&file, path) != 0) {
+        return -1;
+    }
+    printf("%s: %d states, %d byte classes\n", path, file.matcher.states, file.matcher.stride - 1);
+    for (int i = 0; i < text_count; ++i) {
+        int tag = 0;
+        size_t n = dfa_match(&file.matcher, (const unsigned char *)texts[i], strlen(texts[i]), &tag);
+        if (tag) {
+            printf("  %-8s -> %zu byte(s), accepted (tag %d)\n", texts[i], n, tag);
+        } else {
+            printf("  %-8s -> %zu byte(s), no match\n", texts[i], n);
+        }
+    }
+    dfa_file_close(&file);
+    return 0;
+}
+
+/* --rules: one tagged DFA for every rule in the file (a lazy one with
+ * --lazy), then each text cut into longest matches in a single pass and
+ * each token printed with the rule that won it.  Bytes no rule matches
+ * are printed one at a time as "?". */
+static int run_rules(const char *path, char **texts, int text_count, int lazy_states, const char *save_path) {
+    char *text;
+    RegexRule *rules;
+    int count = load_rules(path, &text, &rules);
+    if (count <= 0) {
+        if (count == 0) {
+            fprintf(stderr, "%s: no rules\n", path);
+            free(rules);
+            free(text);
+        }
+        return -1;
+    }
+    NFA nfa;
+    DFA dfa;
+    DFA minimized;
+    DFAMatcher matcher;
+    LazyDFA lazy;
+    int byte_symbol[MAX_SYMBOLS];
+    double t = stats_clock();
+    if (build_rules_nfa(&nfa, rules, count) != 0) {
+        free(rules);
+        free(text);
+        return -1;
+    }
+    int classes = nfa_compress_alphabet(&nfa, byte_symbol);
+    int rc = 0;
+    if (lazy_states) {
+        lazy_dfa_init(&lazy, &nfa, byte_symbol, lazy_states);
+        stats_phase(PHASE_BUILD, t);
+        printf("rules: %d rules, NFA %d states over %d byte classes, lazy DFA caching at most %d states\n",
+               count, nfa.state_count, classes, lazy.max_states);
+    } else {
+        stats_phase(PHASE_BUILD, t);
+        t = stats_clock();
+        parallel_subset_construction(&nfa, &dfa, subset_threads);
+        stats_phase(PHASE_SUBSET, t);
+        t = stats_clock();
+        ensure_total_dfa(&dfa);
+        stats_phase(PHASE_TOTAL, t);
+        t = stats_clock();
+        hopcroft_minimize(&dfa, &minimized);
+        stats_phase(PHASE_MINIMIZE, t);
+        if (dfa_matcher_init(&matcher, &minimized, byte_symbol) != 0) {
+            dfa_free(&minimized);
+            dfa_free(&dfa);
+            nfa_free(&nfa);
+            free(rules);
+            free(text);
+            return -1;
+        }
+        printf("rules: %d rules, NFA %d states over %d byte classes, DFA %d states, minimal DFA %d states\n",
+               count, nfa.state_count, classes, dfa.state_count, minimized.state_count);
+        if (save_path && dfa_file_write(save_path, &matcher) != 0) {
+            rc = -1;
+        }
+    }
+    for (int i = 0; rc == 0 && i < text_count; ++i) {
+        const unsigned char *in = (const unsigned char *)texts[i];
+        size_t len = strlen(texts[i]);
+        printf("%s\n", texts[i]);
+        for (size_t pos = 0; pos < len;) {
+            int tag = 0;
+            size_t n;
+            if (lazy_states) {
+                t = stats_clock();
+                n = lazy_dfa_match(&lazy, in + pos, len - pos, &tag);
+                stats_phase(PHASE_SUBSET, t);
+            } else {
+                n = dfa_match(&matcher, in + pos, len - pos, &tag);
+            }
+            if (n == 0 || tag == 0) {
+                printf("  %-12s %c\n", "?", in[pos]);
+                pos++;
+                continue;
+            }
+            printf("  %-12s %.*s\n", rules[tag - 1].name, (int)n, texts[i] + pos);
+            pos += n;
+        }
+    }
+    if (lazy_states) {
+        printf("lazy DFA: %d states cached, %zu hits, %zu misses, %zu flushes\n", lazy.sets.count, lazy.hits,
+               lazy.misses, lazy.flushes);
+        if (stats_enabled) {
+            lazy_stats_report(stderr, &nfa, &lazy);
+        }
+        lazy_dfa_free(&lazy);
+    } else {
+        if (stats_enabled) {
+            stats_report(stderr, &nfa, &dfa, &minimized);
+        }
+        dfa_matcher_free(&matcher);
+        dfa_free(&minimized);
+        dfa_free(&dfa);
+    }
+    nfa_free(&nfa);
+    free(rules);
+    free(text);
+    return rc;
+}
+
+/* --regex: compiles pattern over byte classes and prints the longest match
+ * at the start of each text. */
+static int run_regex(const char *pattern, char **texts, int text_count, const char *save_path) {
+    NFA nfa;
+    DFA dfa;
+    DFA minimized;
+    DFAMatcher matcher;
+    int byte_symbol[MAX_SYMBOLS];
+    double t = stats_clock();
+    if (build_regex_nfa(&nfa, pattern) != 0) {
+        return -1;
+    }
+    int classes = nfa_compress_alphabet(&nfa, byte_symbol);
+    stats_phase(PHASE_BUILD, t);
+    t = stats_clock();
+    parallel_subset_construction(&nfa, &dfa, subset_threads);
+    stats_phase(PHASE_SUBSET, t);
+    t = stats_clock();
+    ensure_total_dfa(&dfa);
+    stats_phase(PHASE_TOTAL, t);
+    t = stats_clock();
+    hopcroft_minimize(&dfa, &minimized);
+    stats_phase(PHASE_MINIMIZE, t);
+    int rc = dfa_matcher_init(&matcher, &minimized, byte_symbol);
+    if (rc == 0 && save_path && dfa_file_write(save_path, &matcher) != 0) {
+        dfa_matcher_free(&matcher);
+        rc = -1;
+    }
+    if (rc == 0) {
+        printf("regex: NFA %d states over %d byte classes, DFA %d states, minimal DFA %d states\n",
+               nfa.state_count, classes, dfa.state_count, minimized.state_count);
+        for (int i = 0; i < text_count; ++i) {
+            int tag = 0;
+            size_t n = dfa_match(&matcher, (const unsigned char *)texts[i], strlen(texts[i]), &tag);
+            printf("  %-8s -> %zu byte(s)%s\n", texts[i], n, tag ? ", accepted" : ", no match");
+        }
+        dfa_matcher_free(&matcher);
+        if (stats_enabled) {
+            stats_report(stderr, &nfa, &dfa, &minimized);
+        }
+    }
+    dfa_free(&minimized);
+    dfa_free(&dfa);
+    nfa_free(&nfa);
+    return rc;
+}
+
+int main(int argc, char **argv) {
+    const char *emit_path = NULL;
+    const char *matcher_path = NULL;
+    const char *pattern = NULL;
+    const char *rules_path = NULL;
+    const char *save_path = NULL;
+    const char *load_path = NULL;
+    const char *dump_path = NULL;
+    int lazy_states = 0;
+    int texts = argc;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--stats") == 0) {
+            stats_enabled = 1;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            subset_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--lazy") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            lazy_states = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--regex") == 0 && i + 1 < argc) {
+            pattern = argv[++i];
+            texts = i + 1;
+            break;
+        } else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            rules_path = argv[++i];
+            texts = i + 1;
+            break;
+        } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            save_path = argv[++i];
+        } else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            load_path = argv[++i];
+            texts = i + 1;
+            break;
+        } else if (strcmp(argv[i], "--dump") == 0 && i + 1 == argc - 1) {
+            dump_path = argv[++i];
+        } else if (strcmp(argv[i], "--emit-lexer") == 0 && i + 1 < argc && !emit_path) {
+            emit_path = argv[++i];
+        } else if (strcmp(argv[i], "--emit-matcher") == 0 && i + 1 < argc && !matcher_path) {
+            matcher_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [-j threads] [--stats] [--emit-lexer <header>] [--emit-matcher <header>]\n"
+                            "       %s [-j threads] [--stats] [--lazy states | --save <dfa>] --regex <pattern> [text ...]\n"
+                            "       %s [-j threads] [--stats] [--lazy states | --save <dfa>] --rules <file> [text ...]\n"
+                            "       %s --load <dfa> [text ...]\n"
+                            "       %s --dump <dfa>\n",
+                    argv[0], argv[0], argv[0], argv[0], argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (save_path && (lazy_states || (!pattern && !rules_path))) {
+        fprintf(stderr, "--save needs --regex or --rules, without --lazy\n");
+        return EXIT_FAILURE;
+    }
+    if (load_path) {
+        return run_load(load_path, argv + texts, argc - texts) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (dump_path) {
+        DFAFile file;
+        if (dfa_file_open(&file, dump_path) != 0) {
+            return EXIT_FAILURE;
+        }
+        dfa_file_dump(&file, dump_path);
+        dfa_file_close(&file);
+        return EXIT_SUCCESS;
+    }
+    if (rules_path) {
+        int rc = run_rules(rules_path, argv + texts, argc - texts, lazy_states, save_path);
+        return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (pattern) {
+        int rc = lazy_states ? run_regex_lazy(pattern, argv + texts, argc - texts, lazy_states)
+                             : run_regex(pattern, argv + texts, argc - texts, save_path);
+        return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (emit_path || matcher_path) {
+        if (emit_path && generate_lexer_table(emit_path) != 0) {
+            return EXIT_FAILURE;
+        }
+        if (matcher_path && generate_matchers(matcher_path) != 0) {
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    NFA nfa;
+    DFA dfa;
+    DFA minimized;
+
+    double t = stats_clock();
+    build_identifier_nfa(&nfa);
+    stats_phase(PHASE_BUILD, t);
     print_nfa(&nfa, "Identifier NFA");
 
-    subset_construction(&nfa, &dfa);
+    t = stats_clock();
+    parallel_subset_construction(&nfa, &dfa, subset_threads);
+    stats_phase(PHASE_SUBSET, t);
+    t = stats_clock();
     ensure_total_dfa(&dfa);
-    print_dfa(&dfa, "DFA before minimization");
-    export_dfa_matrix(&dfa);
+    stats_phase(PHASE_TOTAL, t);
+    print_dfa(&dfa, "DFA before minimization", identifier_symbol_names);
+    export_dfa_matrix(&dfa, identifier_symbol_names);
 
+    t = stats_clock();
     hopcroft_minimize(&dfa, &minimized);
-    print_dfa(&minimized, "Minimal DFA");
-    export_dfa_matrix(&minimized);
+    stats_phase(PHASE_MINIMIZE, t);
+    print_dfa(&minimized, "Minimal DFA", identifier_symbol_names);
+    export_dfa_matrix(&minimized, identifier_symbol_names);
 
     printf("Start state (minimal DFA): q%d\n", minimized.start);
     printf("Accepting states (minimal DFA):");
@@ -369,5 +3139,27 @@ int main(void) {
     }
     printf("\n");
 
+    DFAMatcher matcher;
+    int symbols[MAX_SYMBOLS];
+    static const char *const samples[] = {"count42", "x", "a1b2+c", "9lives", "_tmp"};
+    identifier_byte_symbols(symbols);
+    if (dfa_matcher_init(&matcher, &minimized, symbols) != 0) {
+        return EXIT_FAILURE;
+    }
+    printf("Longest match (minimal DFA):\n");
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i) {
+        int tag = 0;
+        size_t n = dfa_match(&matcher, (const unsigned char *)samples[i], strlen(samples[i]), &tag);
+        printf("  %-8s -> %zu byte(s)%s\n", samples[i], n, tag ? ", accepted" : ", no match");
+    }
+    dfa_matcher_free(&matcher);
+
+    if (stats_enabled) {
+        stats_report(stderr, &nfa, &dfa, &minimized);
+    }
+    dfa_free(&minimized);
+    dfa_free(&dfa);
+    nfa_free(&nfa);
     return EXIT_SUCCESS;
 }
+#endif
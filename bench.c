@@ -0,0 +1,1539 @@
+#define LEXER_NO_MAIN
+#include "Untitled-1.c"
+#define NFA_NO_MAIN
+#include "Untitled-2.c"
+#include "dfa_matchers.h"
+
+#ifdef _WIN32
+#define PSAPI_VERSION 2
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+//编译运行实例
+//gcc -O2 bench.c -o bench -pthread
+//bench [--suite lexer|automata|all] [--size 64M] [--corpus ident|comment|literal|mixed|all]
+//      [--seed N] [--rounds N] [--nfa-states N] [--json results.jsonl] [identifier-count]
+
+/* xorshift64*: deterministic across platforms so runs are comparable. */
+static unsigned long long bench_rng_state = 0x9e3779b97f4a7c15ull;
+
+static unsigned long long bench_rand(void) {
+    bench_rng_state ^= bench_rng_state >> 12;
+    bench_rng_state ^= bench_rng_state << 25;
+    bench_rng_state ^= bench_rng_state >> 27;
+    return bench_rng_state * 0x2545f4914f6cdd1dull;
+}
+
+/* Machine-readable results: one JSON object per measurement, appended to
+ * the --json file so runs can be diffed or plotted for regressions. */
+static FILE *bench_json = NULL;
+static unsigned long long bench_seed = 1;
+
+static void bench_record(const char *suite, const char *name, const char *metric, double value) {
+    if (bench_json) {
+        fprintf(bench_json, "{\"suite\":\"%s\",\"case\":\"%s\",\"metric\":\"%s\",\"value\":%.6g,\"seed\":%llu}\n",
+                suite, name, metric, value, bench_seed);
+    }
+}
+
+/* Peak resident set size of the process so far, in bytes. */
+static size_t bench_peak_rss(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return (size_t)counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+static void bench_report_rss(const char *suite) {
+    size_t rss = bench_peak_rss();
+    printf("  peak RSS       : %8.1f MB\n", (double)rss / 1e6);
+    bench_record(suite, "process", "peak_rss_bytes", (double)rss);
+}
+
+static int bench_compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* q-th percentile (0..100) of sorted[0..n), nearest rank. */
+static double bench_percentile(const double *sorted, size_t n, double q) {
+    size_t rank = (size_t)(q / 100.0 * (double)n + 0.5);
+    if (rank > 0) rank--;
+    if (rank >= n) rank = n - 1;
+    return sorted[rank];
+}
+
+/* Sorts samples and prints/records p50, p90, p99 and max (microseconds). */
+static void bench_latencies(const char *suite, const char *name, const char *what,
+                            double *samples, size_t n) {
+    static const double qs[] = {50, 90, 99, 100};
+    static const char *labels[] = {"p50_us", "p90_us", "p99_us", "max_us"};
+    if (n == 0) {
+        return;
+    }
+    qsort(samples, n, sizeof(double), bench_compare_double);
+    printf("  %-15s: p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us (%zu samples)\n", what,
+           bench_percentile(samples, n, 50) * 1e6, bench_percentile(samples, n, 90) * 1e6,
+           bench_percentile(samples, n, 99) * 1e6, samples[n - 1] * 1e6, n);
+    for (size_t i = 0; i < sizeof(qs) / sizeof(qs[0]); ++i) {
+        bench_record(suite, name, labels[i], bench_percentile(samples, n, qs[i]) * 1e6);
+    }
+}
+
+/* The original linear strcmp scan, kept as the baseline. */
+static int legacy_is_keyword(const char *lexeme) {
+    for (size_t i = 0; keywords[i]; ++i) {
+        if (strcmp(keywords[i], lexeme) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Identifier-heavy workload: roughly one keyword in four, the rest short
+ * names that often share a prefix with a keyword (in, do_, size...).  All
+ * strings live in one pool (idents[0]) so both lookups see the same layout. */
+static char **make_identifiers(size_t count, size_t **lengths_out) {
+    static const char *stems[] = {
+        "i", "j", "n", "len", "size", "buf", "ptr", "node", "in", "do_it",
+        "cas", "form", "self", "iter", "str", "value", "count", "unsigned_t"
+    };
+    static const char alnum[] = "abcdefghijklmnopqrstuvwxyz_0123456789";
+    char **idents = (char **)malloc(count * sizeof(*idents));
+    size_t *lengths = (size_t *)malloc(count * sizeof(*lengths));
+    char *pool = (char *)malloc(count * 16);
+    size_t used = 0;
+    if (!idents || !lengths || !pool) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        char name[32];
+        unsigned long long r = bench_rand();
+        if (r % 4 == 0) {
+            snprintf(name, sizeof(name), "%s", keywords[(r >> 8) % KW_COUNT]);
+        } else {
+            size_t stem = (size_t)((r >> 8) % (sizeof(stems) / sizeof(stems[0])));
+            size_t len = strlen(stems[stem]);
+            memcpy(name, stems[stem], len);
+            size_t extra = (size_t)((r >> 16) % 4);
+            for (size_t k = 0; k < extra; ++k) {
+                name[len++] = alnum[(r >> (24 + 5 * k)) % (sizeof(alnum) - 1)];
+            }
+            name[len] = '\0';
+        }
+        lengths[i] = strlen(name);
+        idents[i] = pool + used;
+        memcpy(idents[i], name, lengths[i] + 1);
+        used += lengths[i] + 1;
+    }
+    *lengths_out = lengths;
+    return idents;
+}
+
+static void bench_keywords(size_t count, int rounds) {
+    size_t *lengths = NULL;
+    char **idents = make_identifiers(count, &lengths);
+
+    for (size_t i = 0; i < count; ++i) {
+        int expected = legacy_is_keyword(idents[i]);
+        int got = keyword_lookup(idents[i], lengths[i]) != KW_NONE;
+        if (expected != got) {
+            fprintf(stderr, "keyword mismatch on \"%s\"\n", idents[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    double best_legacy = 1e30, best_hash = 1e30;
+    size_t hits_legacy = 0, hits_hash = 0;
+    for (int r = 0; r < rounds; ++r) {
+        double t0 = lex_now();
+        size_t hits = 0;
+        for (size_t i = 0; i < count; ++i) {
+            hits += (size_t)legacy_is_keyword(idents[i]);
+        }
+        double t1 = lex_now();
+        hits_legacy = hits;
+        hits = 0;
+        for (size_t i = 0; i < count; ++i) {
+            hits += keyword_lookup(idents[i], lengths[i]) != KW_NONE;
+        }
+        double t2 = lex_now();
+        hits_hash = hits;
+        if (t1 - t0 < best_legacy) best_legacy = t1 - t0;
+        if (t2 - t1 < best_hash) best_hash = t2 - t1;
+    }
+
+    printf("keyword lookup, %zu identifiers, best of %d rounds\n", count, rounds);
+    printf("  linear strcmp  : %8.2f ns/ident (%zu keywords)\n",
+           best_legacy * 1e9 / (double)count, hits_legacy);
+    printf("  perfect hash   : %8.2f ns/ident (%zu keywords)\n",
+           best_hash * 1e9 / (double)count, hits_hash);
+    printf("  speedup        : %8.2fx\n", best_legacy / best_hash);
+
+    free(idents[0]);
+    free(idents);
+    free(lengths);
+}
+
+/* Interning the identifier workload: per-name cost, and the table against
+ * one malloc'd copy per occurrence (what a token-owned lexeme costs). */
+static void bench_intern(size_t count) {
+    size_t *lengths = NULL;
+    char **idents = make_identifiers(count, &lengths);
+    SymbolTable tab;
+    symbol_table_init(&tab);
+    double t0 = lex_now();
+    for (size_t i = 0; i < count; ++i) {
+        int id = symbol_intern(&tab, idents[i], lengths[i]);
+        size_t len = 0;
+        if (memcmp(symbol_name(&tab, id, &len), idents[i], lengths[i] + 1) != 0 || len != lengths[i]) {
+            fprintf(stderr, "interning mismatch on \"%s\"\n", idents[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    double elapsed = lex_now() - t0;
+    size_t copies = 0;
+    for (size_t i = 0; i < count; ++i) {
+        copies += lengths[i] + 1;
+    }
+    printf("interning %zu identifiers\n", count);
+    printf("  per name       : %8.2f ns (%zu distinct, %.1f%% hits)\n", elapsed * 1e9 / (double)count,
+           tab.count, 100.0 * (double)tab.hits / (double)tab.lookups);
+    printf("  arena          : %8zu bytes (private copies: %zu bytes + %zu mallocs)\n",
+           tab.arena_bytes, copies, count);
+    symbol_table_free(&tab);
+    free(idents[0]);
+    free(idents);
+    free(lengths);
+}
+
+/* Synthetic C-like corpora.  Each profile draws pieces of source text from
+ * the seeded generator until the requested size is reached:
+ *   ident    declarations, assignments and calls over generated names
+ *   comment  vendor-header-like license banners, doc comments, blank lines
+ *   literal  integer, hex, float, string and char constants
+ *   mixed    function bodies drawing from all three */
+typedef enum {
+    CORPUS_IDENT, CORPUS_COMMENT, CORPUS_LITERAL, CORPUS_MIXED, CORPUS_COUNT
+} CorpusProfile;
+
+static const char *corpus_names[CORPUS_COUNT] = {"ident", "comment", "literal", "mixed"};
+
+static void corpus_name(char *dst) {
+    static const char *syllables[] = {
+        "buf", "len", "node", "count", "idx", "size", "ptr", "next", "value", "item",
+        "ctx", "state", "key", "hash", "list", "head", "tail", "data", "tmp", "res"
+    };
+    unsigned long long r = bench_rand();
+    size_t n = sizeof(syllables) / sizeof(syllables[0]);
+    if (r % 5 == 0) {
+        sprintf(dst, "%c", (char)('a' + (r >> 8) % 26));
+    } else if (r % 5 == 1) {
+        sprintf(dst, "%s_%s", syllables[(r >> 8) % n], syllables[(r >> 16) % n]);
+    } else if (r % 5 == 2) {
+        sprintf(dst, "%s%u", syllables[(r >> 8) % n], (unsigned)((r >> 16) % 10));
+    } else {
+        sprintf(dst, "%s", syllables[(r >> 8) % n]);
+    }
+}
+
+static void corpus_ident_piece(OutBuf *out) {
+    char a[32], b[32], c[32];
+    corpus_name(a);
+    corpus_name(b);
+    corpus_name(c);
+    switch (bench_rand() % 5) {
+        case 0: outbuf_printf(out, 128, "    %s = %s + %s;\n", a, b, c); break;
+        case 1: outbuf_printf(out, 128, "    if (%s < %s) %s(%s, %s);\n", a, b, c, a, b); break;
+        case 2: outbuf_printf(out, 128, "    %s->%s = %s.%s;\n", a, b, c, a); break;
+        case 3: outbuf_printf(out, 128, "static int %s(const struct %s *%s);\n", a, b, c); break;
+        default: outbuf_printf(out, 128, "    for (%s = 0; %s < %s; %s++) {\n    }\n", a, a, b, a); break;
+    }
+}
+
+static void corpus_comment_piece(OutBuf *out) {
+    static const char *pieces[] = {
+        "/*\n * Copyright (c) Example Corp. All rights reserved.\n"
+        " * Licensed under the Apache License, Version 2.0 (the \"License\");\n"
+        " * you may not use this file except in compliance with the License.\n */\n",
+        "/**\n * @brief Returns the number of bytes available in the ring buffer.\n"
+        " * @param ring   the ring buffer, must not be NULL\n * @return byte count\n */\n",
+        "    unsigned long long ring_buffer_available_bytes(const struct ring_buffer *ring);\n",
+        "// Deprecated: use ring_buffer_available_bytes instead.\n",
+        "        \n\n",
+        "#define RING_BUFFER_DEFAULT_CAPACITY_IN_BYTES 65536\n",
+    };
+    const char *piece = pieces[bench_rand() % (sizeof(pieces) / sizeof(pieces[0]))];
+    outbuf_write(out, piece, strlen(piece));
+}
+
+static void corpus_literal_piece(OutBuf *out) {
+    static const char *escapes[] = {"\\n", "\\t", "\\\\", "\\\"", "%d", " ", "value: "};
+    unsigned long long r = bench_rand();
+    switch (r % 5) {
+        case 0: outbuf_printf(out, 64, "    x = %llu;\n", (r >> 8) % 1000000); break;
+        case 1: outbuf_printf(out, 64, "    mask = 0x%llX;\n", r >> 20); break;
+        case 2: outbuf_printf(out, 64, "    f = %llu.%llue-%llu;\n", (r >> 8) % 1000, (r >> 20) % 100000, (r >> 40) % 30); break;
+        case 3: {
+            outbuf_write(out, "    s = \"", 9);
+            for (int k = 0; k < 4; ++k) {
+                const char *e = escapes[(r >> (8 + 4 * k)) % (sizeof(escapes) / sizeof(escapes[0]))];
+                outbuf_write(out, e, strlen(e));
+            }
+            outbuf_write(out, "\";\n", 3);
+            break;
+        }
+        default: outbuf_printf(out, 64, "    c = '%c'; d = '\\%c';\n", (char)('a' + (r >> 8) % 26), "ntr0"[(r >> 16) % 4]); break;
+    }
+}
+
+static char *make_corpus(CorpusProfile profile, size_t bytes, size_t *len_out) {
+    OutBuf out;
+    outbuf_init(&out, NULL);
+    outbuf_reserve(&out, bytes + 512);
+    while (out.len < bytes) {
+        CorpusProfile pick = profile;
+        if (profile == CORPUS_MIXED) {
+            unsigned long long r = bench_rand() % 10;
+            pick = r < 5 ? CORPUS_IDENT : r < 7 ? CORPUS_COMMENT : CORPUS_LITERAL;
+        }
+        switch (pick) {
+            case CORPUS_IDENT: corpus_ident_piece(&out); break;
+            case CORPUS_COMMENT: corpus_comment_piece(&out); break;
+            default: corpus_literal_piece(&out); break;
+        }
+    }
+    *len_out = out.len;
+    return out.data;
+}
+
+static double bench_lex_buffer(const char *text, size_t len, int rounds, size_t *tokens_out) {
+    double best = 1e30;
+    for (int r = 0; r < rounds; ++r) {
+        Scanner scanner;
+        scanner_init_buffer(&scanner, text, len);
+        double t0 = lex_now();
+        size_t tokens = 0;
+        for (;;) {
+            Token tok = scanner_next_token(&scanner);
+            tokens++;
+            if (tok.kind == TK_EOF) break;
+        }
+        double elapsed = lex_now() - t0;
+        if (elapsed < best) best = elapsed;
+        *tokens_out = tokens;
+    }
+    return best;
+}
+
+/* Throughput of one corpus profile plus the latency of each LEX_BATCH-token
+ * pull, over all rounds. */
+static void bench_corpus(CorpusProfile profile, size_t bytes, int rounds) {
+    size_t len = 0;
+    char *text = make_corpus(profile, bytes, &len);
+    Token *batch = (Token *)malloc(LEX_BATCH * sizeof(Token));
+    size_t cap = (len / 64 / LEX_BATCH + 2) * (size_t)rounds;
+    double *samples = (double *)malloc(cap * sizeof(double));
+    size_t sample_count = 0;
+    if (!batch || !samples) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    double best = 1e30;
+    size_t tokens = 0;
+    for (int r = 0; r < rounds; ++r) {
+        Scanner scanner;
+        scanner_init_buffer(&scanner, text, len);
+        tokens = 0;
+        double t0 = lex_now();
+        double last = t0;
+        for (;;) {
+            size_t n = scanner_next_batch(&scanner, batch, LEX_BATCH);
+            double now = lex_now();
+            if (sample_count < cap) samples[sample_count++] = now - last;
+            last = now;
+            tokens += n;
+            if (batch[n - 1].kind == TK_EOF) break;
+        }
+        if (last - t0 < best) best = last - t0;
+    }
+    const char *name = corpus_names[profile];
+    printf("corpus %-7s: %zu bytes, %zu tokens, best of %d rounds\n", name, len, tokens, rounds);
+    printf("  throughput     : %8.1f MB/s, %.2f Mtokens/s\n", (double)len / best / 1e6, (double)tokens / best / 1e6);
+    bench_record("lexer", name, "mb_per_s", (double)len / best / 1e6);
+    bench_record("lexer", name, "mtokens_per_s", (double)tokens / best / 1e6);
+    bench_latencies("lexer", name, "batch latency", samples, sample_count);
+    free(samples);
+    free(batch);
+    free(text);
+}
+
+static void bench_lex_kernels(size_t bytes, int rounds) {
+    static const char *names[] = {"scalar", "sse2", "avx2"};
+    size_t len = 0;
+    size_t tokens = 0;
+    char *text = make_corpus(CORPUS_COMMENT, bytes, &len);
+    printf("lexing %zu bytes of the comment corpus per kernel set, best of %d rounds\n", len, rounds);
+    for (size_t k = 0; k < sizeof(names) / sizeof(names[0]); ++k) {
+        if (lex_kernels_select(names[k]) != 0) {
+            printf("  table + %-6s : not supported on this CPU\n", names[k]);
+            continue;
+        }
+        double best = bench_lex_buffer(text, len, rounds, &tokens);
+        printf("  table + %-6s : %8.1f MB/s (%zu tokens)\n", names[k], (double)len / best / 1e6, tokens);
+    }
+    lex_kernels_select(NULL);
+    lex_use_table = 0;
+    double best = bench_lex_buffer(text, len, rounds, &tokens);
+    printf("  hand  + %-6s : %8.1f MB/s (%zu tokens)\n", lex_kernels->name, (double)len / best / 1e6, tokens);
+    lex_use_table = 1;
+    free(text);
+}
+
+/* Line/column tracking in the scanner against offsets only, with and
+ * without resolving every token through a LineIndex afterwards (the index
+ * build is part of the timed region). */
+static void bench_positions(size_t bytes, int rounds) {
+    static const char *names[] = {"tracking", "offsets", "offsets+index"};
+    size_t len = 0;
+    char *text = make_corpus(CORPUS_MIXED, bytes, &len);
+    printf("positions over %zu bytes of the mixed corpus, best of %d rounds\n", len, rounds);
+    for (int mode = 0; mode < 3; ++mode) {
+        double best = 1e30;
+        size_t check = 0;
+        for (int r = 0; r < rounds; ++r) {
+            Scanner scanner;
+            LineIndex lines = {0};
+            double t0 = lex_now();
+            if (mode == 0) {
+                scanner_init_buffer(&scanner, text, len);
+            } else {
+                scanner_init_offsets(&scanner, text, len);
+            }
+            if (mode == 2) line_index_build(&lines, text, len);
+            check = 0;
+            for (;;) {
+                Token tok = scanner_next_token(&scanner);
+                if (mode == 2) line_index_resolve(&lines, &tok);
+                check += tok.line + tok.column;
+                if (tok.kind == TK_EOF) break;
+            }
+            double elapsed = lex_now() - t0;
+            if (mode == 2) line_index_free(&lines);
+            if (elapsed < best) best = elapsed;
+        }
+        printf("  %-14s: %8.1f MB/s (position sum %zu)\n", names[mode], (double)len / best / 1e6, check);
+        bench_record("lexer", names[mode], "mb_per_s", (double)len / best / 1e6);
+    }
+    free(text);
+}
+
+/* Reading the mixed corpus back from a temporary file: a LexStream with its
+ * reader thread against FILE mode (fgetc), with the mapped buffer as the
+ * ceiling. */
+static void bench_stream(size_t bytes, int rounds) {
+    static const char *names[] = {"buffer", "stream", "fgetc"};
+    size_t len = 0;
+    char *text = make_corpus(CORPUS_MIXED, bytes, &len);
+    FILE *fp = tmpfile();
+    if (!fp || fwrite(text, 1, len, fp) != len || fflush(fp) != 0) {
+        fprintf(stderr, "tmpfile: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    printf("input over %zu bytes of the mixed corpus, best of %d rounds\n", len, rounds);
+    for (int mode = 0; mode < 3; ++mode) {
+        double best = 1e30;
+        size_t tokens = 0;
+        for (int r = 0; r < rounds; ++r) {
+            Scanner scanner;
+            LexStream stream;
+            rewind(fp);
+            double t0 = lex_now();
+            if (mode == 0) {
+                scanner_init_buffer(&scanner, text, len);
+            } else if (mode == 1) {
+                lex_stream_open(&stream, "", fileno(fp));
+                scanner_init_stream(&scanner, &stream);
+            } else {
+                scanner_init(&scanner, fp);
+            }
+            tokens = 0;
+            for (;;) {
+                Token tok = scanner_next_token(&scanner);
+                tokens++;
+                if (tok.kind == TK_EOF) break;
+            }
+            if (mode == 1) lex_stream_close(&stream);
+            scanner_free(&scanner);
+            double elapsed = lex_now() - t0;
+            if (elapsed < best) best = elapsed;
+        }
+        printf("  %-7s: %8.1f MB/s (%zu tokens)\n", names[mode], (double)len / best / 1e6, tokens);
+        bench_record("lexer", names[mode], "mb_per_s", (double)len / best / 1e6);
+    }
+    fclose(fp);
+    free(text);
+}
+
+/* Numeric values decoded by the scanner (Scanner.values) against lexing
+ * plain and re-parsing every literal with strtoull/strtod afterwards. */
+static void bench_values(size_t bytes, int rounds) {
+    static const char *names[] = {"no values", "scanner values", "strto* pass"};
+    size_t len = 0;
+    char *text = make_corpus(CORPUS_LITERAL, bytes, &len);
+    printf("numeric values over %zu bytes of the literal corpus, best of %d rounds\n", len, rounds);
+    for (int mode = 0; mode < 3; ++mode) {
+        double best = 1e30;
+        double check = 0;
+        for (int r = 0; r < rounds; ++r) {
+            Scanner scanner;
+            scanner_init_buffer(&scanner, text, len);
+            scanner.values = mode == 1;
+            char digits[128];
+            double t0 = lex_now();
+            check = 0;
+            for (;;) {
+                Token tok = scanner_next_token(&scanner);
+                if (tok.kind == TK_EOF) break;
+                if (tok.kind < TK_INT_LITERAL || tok.kind > TK_FLOAT_LITERAL) continue;
+                if (mode == 1) {
+                    check += tok.kind == TK_FLOAT_LITERAL ? tok.value.d : (double)tok.value.u;
+                } else if (mode == 2) {
+                    size_t n = tok.length < sizeof(digits) - 1 ? tok.length : sizeof(digits) - 1;
+                    memcpy(digits, tok.lexeme, n);
+                    digits[n] = '\0';
+                    check += tok.kind == TK_FLOAT_LITERAL ? strtod(digits, NULL)
+                                                          : (double)strtoull(digits, NULL, 0);
+                }
+            }
+            double elapsed = lex_now() - t0;
+            if (elapsed < best) best = elapsed;
+        }
+        printf("  %-15s: %8.1f MB/s (sum %.6g)\n", names[mode], (double)len / best / 1e6, check);
+        bench_record("lexer", names[mode], "mb_per_s", (double)len / best / 1e6);
+    }
+    free(text);
+}
+
+/* Stand-in for a parser: a little work per token that depends on it. */
+static unsigned long long bench_consume(const Token *toks, size_t n, unsigned long long acc) {
+    for (size_t i = 0; i < n; ++i) {
+        acc = acc * 31 + (unsigned long long)toks[i].kind * 7 + toks[i].length + (unsigned)toks[i].keyword;
+    }
+    return acc;
+}
+
+/* The same consumer fed one token per call, LEX_BATCH tokens per call, and
+ * from a producer thread through the ring. */
+static void bench_batches(size_t bytes, int rounds) {
+    size_t len = 0;
+    char *text = make_corpus(CORPUS_MIXED, bytes, &len);
+    Token *batch = (Token *)malloc(LEX_BATCH * sizeof(Token));
+    double best_single = 1e30, best_batch = 1e30, best_ring = 1e30;
+    unsigned long long check[3] = {0, 0, 0};
+    size_t tokens = 0;
+    if (!batch) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int r = 0; r < rounds; ++r) {
+        Scanner scanner;
+        scanner_init_buffer(&scanner, text, len);
+        double t0 = lex_now();
+        unsigned long long acc = 0;
+        tokens = 0;
+        for (;;) {
+            Token tok = scanner_next_token(&scanner);
+            acc = bench_consume(&tok, 1, acc);
+            tokens++;
+            if (tok.kind == TK_EOF) break;
+        }
+        double t1 = lex_now();
+        check[0] = acc;
+
+        scanner_init_buffer(&scanner, text, len);
+        acc = 0;
+        for (;;) {
+            size_t n = scanner_next_batch(&scanner, batch, LEX_BATCH);
+            acc = bench_consume(batch, n, acc);
+            if (batch[n - 1].kind == TK_EOF) break;
+        }
+        double t2 = lex_now();
+        check[1] = acc;
+
+        scanner_init_buffer(&scanner, text, len);
+        acc = 0;
+        LexProducer producer;
+        if (lex_producer_start(&producer, &scanner) != 0) {
+            fprintf(stderr, "cannot start producer thread\n");
+            exit(EXIT_FAILURE);
+        }
+        const Token *toks;
+        size_t n;
+        while ((toks = lex_producer_acquire(&producer, &n)) != NULL) {
+            acc = bench_consume(toks, n, acc);
+            lex_producer_release(&producer);
+        }
+        lex_producer_finish(&producer);
+        double t3 = lex_now();
+        check[2] = acc;
+
+        if (t1 - t0 < best_single) best_single = t1 - t0;
+        if (t2 - t1 < best_batch) best_batch = t2 - t1;
+        if (t3 - t2 < best_ring) best_ring = t3 - t2;
+    }
+    if (check[0] != check[1] || check[0] != check[2]) {
+        fprintf(stderr, "batched token streams differ\n");
+        exit(EXIT_FAILURE);
+    }
+    printf("feeding %zu tokens to a consumer, best of %d rounds\n", tokens, rounds);
+    printf("  per token      : %8.2f Mtokens/s\n", (double)tokens / best_single / 1e6);
+    printf("  batches of %-4d: %8.2f Mtokens/s\n", LEX_BATCH, (double)tokens / best_batch / 1e6);
+    printf("  producer ring  : %8.2f Mtokens/s\n", (double)tokens / best_ring / 1e6);
+    free(batch);
+    free(text);
+}
+
+/* Editor-style typing: bursts of single-byte inserts at a random spot,
+ * each followed by the re-lex, compared with lexing the whole text again. */
+static void bench_incremental(size_t bytes, int bursts) {
+    static const char typed[] = "if (count > 0) { total += count; } /* x */\n";
+    size_t len = 0;
+    size_t tokens = 0;
+    char *text = make_corpus(CORPUS_MIXED, bytes, &len);
+    double full = bench_lex_buffer(text, len, 3, &tokens);
+
+    LexDocument doc;
+    lex_doc_init(&doc, text, len);
+    size_t edits = 0;
+    size_t changed = 0;
+    double t0 = lex_now();
+    for (int b = 0; b < bursts; ++b) {
+        size_t offset = (size_t)(bench_rand() % (doc.len + 1));
+        for (size_t i = 0; i + 1 < sizeof(typed); ++i) {
+            LexEdit edit = {0, 0, 0};
+            lex_doc_edit(&doc, offset + i, 0, &typed[i], 1, &edit);
+            changed += edit.inserted;
+            edits++;
+        }
+    }
+    double elapsed = lex_now() - t0;
+    /* the edited document must match lexing its text from scratch */
+    Scanner scanner;
+    scanner_init_buffer(&scanner, lex_doc_text(&doc), doc.len);
+    for (size_t i = 0; i < lex_doc_count(&doc); ++i) {
+        Token want = scanner_next_token(&scanner);
+        Token got = lex_doc_token(&doc, i);
+        if (got.kind != want.kind || got.length != want.length || got.offset != want.offset ||
+            got.line != want.line || got.column != want.column ||
+            memcmp(got.lexeme, want.lexeme, got.length) != 0) {
+            fprintf(stderr, "incremental token %zu differs from a full re-lex\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    printf("incremental re-lex of %zu bytes (%zu tokens): %zu single-byte edits\n", len, tokens, edits);
+    printf("  per edit       : %8.2f us (%.1f tokens re-lexed on average)\n",
+           elapsed / (double)edits * 1e6, (double)changed / (double)edits);
+    printf("  full re-lex    : %8.2f us\n", full * 1e6);
+    lex_doc_free(&doc);
+    free(text);
+}
+
+/* Random lexer-like NFA with the given number of states: the start state
+ * has epsilon moves into fragments of 2-6 chained states on random symbols,
+ * some with self-loops, each ending in a tagged accept state.  Fragments
+ * overlap on their first symbols, so subset construction has real work,
+ * but the DFA grows roughly linearly with the NFA. */
+static void random_nfa(NFA *nfa, int states, int symbols) {
+    nfa_init(nfa, symbols);
+    for (int s = 0; s < states; ++s) {
+        nfa_add_state(nfa, 0);
+    }
+    nfa->start = 0;
+    int next = 1;
+    int fragment = 0;
+    while (next < states) {
+        int length = 2 + (int)(bench_rand() % 5);
+        if (length > states - next) length = states - next;
+        nfa_add_epsilon(nfa, 0, next);
+        for (int k = 0; k < length; ++k) {
+            int s = next + k;
+            unsigned long long r = bench_rand();
+            if (k + 1 < length) {
+                int sym = (int)(r % (unsigned long long)symbols);
+                nfa_add_range(nfa, s, sym, sym, s + 1);
+            }
+            if ((r >> 8) % 3 == 0) {
+                int sym = (int)((r >> 16) % (unsigned long long)symbols);
+                if (nfa_target(nfa, s, sym) == -1) nfa_add_range(nfa, s, sym, sym, s);
+            }
+        }
+        nfa->tag[next + length - 1] = 1 + fragment % 4;
+        next += length;
+        fragment++;
+    }
+}
+
+/* The original Moore-style refinement, kept as the baseline: every pass
+ * compares each state of a block with the block's first state until no
+ * block splits, so it needs as many passes as the longest distinguishing
+ * suffix.  Blocks are contiguous runs of members: block b holds
+ * members[first[b] .. first[b] + size[b]). */
+static void legacy_minimize(const DFA *dfa, DFA *minimized) {
+    int n = dfa->state_count;
+    int *partition = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    int *members = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    int *first = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    int *size = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    int *split = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    int *tags = (int *)automata_alloc(NULL, (size_t)n * sizeof(int));
+    int block_count = 0;
+
+    /* Initial partition: one block per accept tag in ascending order, then
+     * the non-accepting states, so states recognising different tokens are
+     * never merged. */
+    memcpy(tags, dfa->accept, (size_t)n * sizeof(int));
+    qsort(tags, (size_t)n, sizeof(int), compare_ints);
+    int tag_count = 0;
+    for (int i = 0; i < n; ++i) {
+        if (i == 0 || tags[i] != tags[i - 1]) tags[tag_count++] = tags[i];
+    }
+    if (tag_count > 0 && tags[0] == 0) {
+        memmove(tags, tags + 1, (size_t)(tag_count - 1) * sizeof(int));
+        tags[tag_count - 1] = 0;
+    }
+    int filled = 0;
+    for (int t = 0; t < tag_count; ++t) {
+        first[block_count] = filled;
+        for (int i = 0; i < n; ++i) {
+            if (dfa->accept[i] == tags[t]) {
+                members[filled++] = i;
+                partition[i] = block_count;
+            }
+        }
+        size[block_count] = filled - first[block_count];
+        block_count++;
+    }
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int b = 0; b < block_count; ++b) {
+            if (size[b] <= 1) continue;
+            int *run = members + first[b];
+            const int *representative = dfa_row(dfa, run[0]);
+            int keep = 1;
+            int split_size = 0;
+            for (int i = 1; i < size[b]; ++i) {
+                const int *row = dfa_row(dfa, run[i]);
+                int distinguishable = 0;
+                for (int symbol = 0; symbol < dfa->symbol_count; ++symbol) {
+                    if (partition[representative[symbol]] != partition[row[symbol]]) {
+                        distinguishable = 1;
+                        break;
+                    }
+                }
+                if (distinguishable) {
+                    split[split_size++] = run[i];
+                } else {
+                    run[keep++] = run[i];
+                }
+            }
+            if (split_size > 0) {
+                changed = 1;
+                int new_block = block_count++;
+                memcpy(run + keep, split, (size_t)split_size * sizeof(int));
+                first[new_block] = first[b] + keep;
+                size[new_block] = split_size;
+                size[b] = keep;
+                for (int i = 0; i < split_size; ++i) {
+                    partition[split[i]] = new_block;
+                }
+            }
+        }
+    }
+
+    dfa_init(minimized, dfa->symbol_count);
+    for (int i = 0; i < block_count; ++i) {
+        dfa_add_state(minimized, dfa->accept[members[first[i]]]);
+    }
+    minimized->start = partition[dfa->start];
+    for (int i = 0; i < block_count; ++i) {
+        const int *row = dfa_row(dfa, members[first[i]]);
+        int *out = dfa_row(minimized, i);
+        for (int symbol = 0; symbol < dfa->symbol_count; ++symbol) {
+            out[symbol] = partition[row[symbol]];
+        }
+    }
+    free(tags);
+    free(split);
+    free(size);
+    free(first);
+    free(members);
+    free(partition);
+}
+
+/* Line of n states on symbol 0 (state i -> i + 1) with every other symbol
+ * back to 0; only the last state accepts.  All states are distinct, but
+ * refinement one suffix length at a time needs n passes to see it. */
+static void chain_dfa(DFA *dfa, int n, int symbols) {
+    dfa_init(dfa, symbols);
+    for (int s = 0; s < n; ++s) {
+        dfa_add_state(dfa, s == n - 1);
+    }
+    for (int s = 0; s < n; ++s) {
+        int *row = dfa_row(dfa, s);
+        row[0] = s + 1 < n ? s + 1 : s;
+        for (int c = 1; c < symbols; ++c) {
+            row[c] = 0;
+        }
+    }
+    dfa->start = 0;
+}
+
+/* hopcroft_minimize against legacy_minimize on DFAs of doubling size: the
+ * determinised random NFAs above and chain DFAs.  The baseline is dropped
+ * for a family once a run takes over a second. */
+static void bench_minimizers(int max_states) {
+    for (int family = 0; family < 2; ++family) {
+        int legacy = 1;
+        for (int states = 256; states <= max_states; states *= 2) {
+            NFA nfa;
+            DFA dfa;
+            DFA minimized;
+            if (family == 0) {
+                random_nfa(&nfa, states, 16);
+                subset_construction(&nfa, &dfa);
+                ensure_total_dfa(&dfa);
+                nfa_free(&nfa);
+            } else {
+                chain_dfa(&dfa, states, 16);
+            }
+            double t0 = lex_now();
+            hopcroft_minimize(&dfa, &minimized);
+            double hopcroft = lex_now() - t0;
+            int min_states = minimized.state_count;
+            dfa_free(&minimized);
+            double baseline = 0;
+            if (legacy) {
+                t0 = lex_now();
+                legacy_minimize(&dfa, &minimized);
+                baseline = lex_now() - t0;
+                if (minimized.state_count != min_states) {
+                    fprintf(stderr, "minimizers disagree: %d vs %d states\n", min_states, minimized.state_count);
+                    exit(EXIT_FAILURE);
+                }
+                dfa_free(&minimized);
+            }
+            char name[48];
+            snprintf(name, sizeof(name), "minimize_%s_n%d", family ? "chain" : "random", states);
+            printf("minimize %s DFA, %d -> %d states: hopcroft %9.3f ms", family ? "chain " : "random",
+                   dfa.state_count, min_states, hopcroft * 1e3);
+            bench_record("automata", name, "hopcroft_ms", hopcroft * 1e3);
+            if (legacy) {
+                printf(", legacy %9.3f ms\n", baseline * 1e3);
+                bench_record("automata", name, "legacy_ms", baseline * 1e3);
+                legacy = baseline < 1.0;
+            } else {
+                printf("\n");
+            }
+            dfa_free(&dfa);
+        }
+    }
+}
+
+/* words random keywords of 3-10 letters as one alternation; every fourth
+ * takes a [0-9]* suffix and every fifth may repeat its first two letters. */
+static char *keyword_regex(int words) {
+    size_t cap = (size_t)words * 24 + 1;
+    char *text = (char *)malloc(cap);
+    if (!text) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t len = 0;
+    for (int w = 0; w < words; ++w) {
+        int letters = 3 + (int)(bench_rand() % 8);
+        if (w) text[len++] = '|';
+        if (w % 5 == 4) text[len++] = '(';
+        for (int i = 0; i < letters; ++i) {
+            text[len++] = (char)('a' + bench_rand() % 26);
+            if (i == 1 && w % 5 == 4) {
+                memcpy(text + len, ")*", 2);
+                len += 2;
+            }
+        }
+        if (w % 4 == 3) {
+            memcpy(text + len, "[0-9]*", 6);
+            len += 6;
+        }
+    }
+    text[len] = '\0';
+    return text;
+}
+
+/* Parallel determinization of the largest random NFA and keyword regex:
+ * wall time at 1, 2, 4 ... threads (up to the CPU count, at least 2), each
+ * result checked against the sequential DFA. */
+static void bench_parallel_subset(int max_states) {
+    int cpus = lex_default_threads();
+    for (int family = 0; family < 2; ++family) {
+        NFA nfa;
+        DFA serial;
+        DFA dfa;
+        int symbols[MAX_SYMBOLS];
+        if (family == 0) {
+            random_nfa(&nfa, max_states, 16);
+        } else {
+            char *pattern = keyword_regex(max_states / 16 > 1 ? max_states / 16 : 1);
+            if (build_regex_nfa(&nfa, pattern) != 0) {
+                exit(EXIT_FAILURE);
+            }
+            free(pattern);
+            nfa_compress_alphabet(&nfa, symbols);
+        }
+        subset_construction(&nfa, &serial);
+        printf("parallel subset, %s NFA %d states -> DFA %d:", family ? "keyword" : "random",
+               nfa.state_count, serial.state_count);
+        for (int threads = 1; threads <= (cpus > 2 ? cpus : 2); threads *= 2) {
+            double t0 = lex_now();
+            parallel_subset_construction(&nfa, &dfa, threads);
+            double seconds = lex_now() - t0;
+            if (dfa.state_count != serial.state_count ||
+                memcmp(dfa.transitions, serial.transitions,
+                       (size_t)dfa.state_count * (size_t)dfa.symbol_count * sizeof(int)) != 0 ||
+                memcmp(dfa.accept, serial.accept, (size_t)dfa.state_count * sizeof(int)) != 0) {
+                fprintf(stderr, "parallel subset construction differs at %d threads\n", threads);
+                exit(EXIT_FAILURE);
+            }
+            char name[48];
+            snprintf(name, sizeof(name), "parallel_%s_t%d", family ? "keyword" : "random", threads);
+            printf(" %dT %.3f ms", threads, seconds * 1e3);
+            bench_record("automata", name, "subset_ms", seconds * 1e3);
+            dfa_free(&dfa);
+        }
+        printf("\n");
+        dfa_free(&serial);
+        nfa_free(&nfa);
+    }
+}
+
+/* Determinisation of large Thompson NFAs: keyword alternations of growing
+ * size, compiled over byte classes. */
+static void bench_thompson(int max_states) {
+    for (int words = 64; words * 16 <= max_states; words *= 2) {
+        char *pattern = keyword_regex(words);
+        NFA nfa;
+        DFA dfa;
+        DFA minimized;
+        int symbols[MAX_SYMBOLS];
+        if (build_regex_nfa(&nfa, pattern) != 0) {
+            exit(EXIT_FAILURE);
+        }
+        nfa_compress_alphabet(&nfa, symbols);
+        double t0 = lex_now();
+        subset_construction(&nfa, &dfa);
+        double t1 = lex_now();
+        ensure_total_dfa(&dfa);
+        hopcroft_minimize(&dfa, &minimized);
+        double t2 = lex_now();
+        char name[48];
+        snprintf(name, sizeof(name), "thompson_w%d", words);
+        printf("keyword regex, %d words: NFA %d states, %d classes -> DFA %d -> minimal %d: "
+               "subset %.3f ms, minimize %.3f ms\n", words, nfa.state_count, nfa.symbol_count, dfa.state_count,
+               minimized.state_count, (t1 - t0) * 1e3, (t2 - t1) * 1e3);
+        bench_record("automata", name, "subset_ms", (t1 - t0) * 1e3);
+        bench_record("automata", name, "minimize_ms", (t2 - t1) * 1e3);
+        dfa_free(&minimized);
+        dfa_free(&dfa);
+        nfa_free(&nfa);
+        free(pattern);
+    }
+}
+
+/* Startup cost: building the keyword regex's table matcher from the
+ * pattern (parse, subset construction, minimization) against mapping the
+ * same matcher from a DFA file, whose tables must come back identical. */
+static void bench_dfa_file(int max_states) {
+    int words = max_states / 4 > 64 ? max_states / 4 : 64;
+    char *pattern = keyword_regex(words);
+    const char *dir = getenv("TMPDIR");
+    if (!dir) dir = getenv("TEMP");
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/bench-%lu.cdfa", dir ? dir : ".", (unsigned long)bench_seed);
+    NFA nfa;
+    DFA minimized;
+    DFAMatcher matcher;
+    int symbols[MAX_SYMBOLS];
+    double t0 = lex_now();
+    if (build_regex_nfa(&nfa, pattern) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    nfa_compress_alphabet(&nfa, symbols);
+    build_minimal_dfa(&nfa, &minimized);
+    if (dfa_matcher_init(&matcher, &minimized, symbols) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    double build = lex_now() - t0;
+    if (dfa_file_write(path, &matcher) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    DFAFile file;
+    t0 = lex_now();
+    if (dfa_file_open(&file, path) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    double load = lex_now() - t0;
+    size_t table_size = (size_t)matcher.states * (size_t)matcher.stride * sizeof(unsigned);
+    if (file.matcher.states != matcher.states || file.matcher.stride != matcher.stride ||
+        file.matcher.start != matcher.start || memcmp(file.matcher.byte_class, matcher.byte_class, MAX_SYMBOLS) != 0 ||
+        memcmp(file.matcher.table, matcher.table, table_size) != 0) {
+        fprintf(stderr, "DFA file does not match the matcher it was written from\n");
+        exit(EXIT_FAILURE);
+    }
+    printf("DFA file, keyword regex of %d words (%d states, %zu-byte table): build %.3f ms, map and check %.3f ms\n",
+           words, matcher.states, table_size, build * 1e3, load * 1e3);
+    bench_record("automata", "dfa_file", "build_ms", build * 1e3);
+    bench_record("automata", "dfa_file", "load_ms", load * 1e3);
+    dfa_file_close(&file);
+    remove(path);
+    dfa_matcher_free(&matcher);
+    dfa_free(&minimized);
+    nfa_free(&nfa);
+    free(pattern);
+}
+
+/* The C token rules written as one regular expression (single tag). */
+static const char *const bench_token_regex =
+    "[A-Za-z_][A-Za-z0-9_]*|[0-9]+(\\.[0-9]*)?([eE][-+]?[0-9]*)?|0[xX][0-9a-fA-F]*"
+    "|\"([^\"\\\\]|\\\\(.|\\n))*\"|'([^'\\\\]|\\\\(.|\\n))*'"
+    "|//[^\\n]*|/\\*([^*]|\\*+[^*/])*\\*+/"
+    "|[-+=!<>]=?|\\+\\+|--|[*%/]|[(){}\\[\\];,.:?&|^~#]";
+
+/* Subset construction and minimization timed per automaton: random NFAs of
+ * doubling sizes up to max_states, then the C token NFA behind lexer_dfa.h.
+ * Larger sizes run fewer automata (at least 10) so each size costs about
+ * the same. */
+static void bench_automata(int max_states, int per_size) {
+    NFA nfa;
+    DFA dfa;
+    DFA minimized;
+    double *subset_times = (double *)malloc((size_t)per_size * sizeof(double));
+    double *min_times = (double *)malloc((size_t)per_size * sizeof(double));
+    double *compile_times = (double *)malloc((size_t)per_size * sizeof(double));
+    if (!subset_times || !min_times || !compile_times) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int states = 8; states <= max_states; states *= 2) {
+        int count = per_size * 64 / states;
+        if (count > per_size) count = per_size;
+        if (count < 10) count = per_size < 10 ? per_size : 10;
+        size_t done = 0, dfa_states = 0, min_states = 0;
+        for (int i = 0; i < count; ++i) {
+            random_nfa(&nfa, states, 16);
+            double t0 = lex_now();
+            subset_construction(&nfa, &dfa);
+            double t1 = lex_now();
+            ensure_total_dfa(&dfa);
+            hopcroft_minimize(&dfa, &minimized);
+            double t2 = lex_now();
+            subset_times[done] = t1 - t0;
+            min_times[done] = t2 - t1;
+            dfa_states += (size_t)dfa.state_count;
+            min_states += (size_t)minimized.state_count;
+            done++;
+            dfa_free(&minimized);
+            dfa_free(&dfa);
+            nfa_free(&nfa);
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "random_n%d", states);
+        printf("random NFAs, %d states, 16 symbols: %zu built\n", states, done);
+        printf("  mean DFA size  : %8.1f states, %.1f after minimization\n",
+               (double)dfa_states / (double)done, (double)min_states / (double)done);
+        bench_record("automata", name, "dfa_states", (double)dfa_states / (double)done);
+        bench_record("automata", name, "min_states", (double)min_states / (double)done);
+        snprintf(name, sizeof(name), "random_n%d/subset", states);
+        bench_latencies("automata", name, "subset", subset_times, done);
+        snprintf(name, sizeof(name), "random_n%d/minimize", states);
+        bench_latencies("automata", name, "minimize", min_times, done);
+    }
+
+    size_t done = 0;
+    int nfa_states = 0, dfa_states = 0, min_states = 0;
+    for (int i = 0; i < per_size; ++i) {
+        build_c_token_nfa(&nfa);
+        double t0 = lex_now();
+        subset_construction(&nfa, &dfa);
+        double t1 = lex_now();
+        ensure_total_dfa(&dfa);
+        hopcroft_minimize(&dfa, &minimized);
+        double t2 = lex_now();
+        subset_times[done] = t1 - t0;
+        min_times[done] = t2 - t1;
+        done++;
+        nfa_states = nfa.state_count;
+        dfa_states = dfa.state_count;
+        min_states = minimized.state_count;
+        dfa_free(&minimized);
+        dfa_free(&dfa);
+        nfa_free(&nfa);
+    }
+    printf("C token NFA: %d states -> DFA %d -> minimal %d\n", nfa_states, dfa_states, min_states);
+    bench_latencies("automata", "c_tokens/subset", "subset", subset_times, done);
+    bench_latencies("automata", "c_tokens/minimize", "minimize", min_times, done);
+
+    /* the same rules as a regex: Thompson NFA over all 256 bytes, then
+     * over byte classes; compile time covers parsing and compression */
+    for (int compress = 0; compress < 2; ++compress) {
+        int symbols[MAX_SYMBOLS];
+        int columns = 0;
+        done = 0;
+        for (int i = 0; i < per_size; ++i) {
+            double t0 = lex_now();
+            if (build_regex_nfa(&nfa, bench_token_regex) != 0) {
+                exit(EXIT_FAILURE);
+            }
+            columns = compress ? nfa_compress_alphabet(&nfa, symbols) : nfa.symbol_count;
+            double t1 = lex_now();
+            subset_construction(&nfa, &dfa);
+            double t2 = lex_now();
+            ensure_total_dfa(&dfa);
+            hopcroft_minimize(&dfa, &minimized);
+            compile_times[done] = t1 - t0;
+            subset_times[done] = t2 - t1;
+            done++;
+            nfa_states = nfa.state_count;
+            min_states = minimized.state_count;
+            dfa_free(&minimized);
+            dfa_free(&dfa);
+            nfa_free(&nfa);
+        }
+        const char *name = compress ? "regex_classes" : "regex_bytes";
+        char label[48];
+        printf("token regex, %s: NFA %d states, %d columns -> minimal DFA %d\n", name, nfa_states, columns,
+               min_states);
+        snprintf(label, sizeof(label), "%s/compile", name);
+        bench_latencies("automata", label, "compile", compile_times, done);
+        snprintf(label, sizeof(label), "%s/subset", name);
+        bench_latencies("automata", label, "subset", subset_times, done);
+    }
+    bench_thompson(max_states);
+    bench_parallel_subset(max_states);
+    bench_dfa_file(max_states);
+    bench_minimizers(max_states);
+    bench_report_rss("automata");
+    free(compile_times);
+    free(min_times);
+    free(subset_times);
+}
+
+/* Longest-match executors over the same minimal DFAs: the table walk in
+ * Untitled-2.c against the generated code in dfa_matchers.h.  Each run
+ * tokenizes the whole corpus, skipping one byte where nothing matches. */
+typedef size_t (*MatchFn)(const unsigned char *in, size_t len, int *tag);
+
+static DFAMatcher bench_matcher;
+
+static size_t bench_table_match(const unsigned char *in, size_t len, int *tag) {
+    return dfa_match(&bench_matcher, in, len, tag);
+}
+
+/* Cuts text into longest matches with fn (skipping a byte where nothing
+ * matches); returns the scan's seconds. */
+static double bench_scan(MatchFn fn, const unsigned char *text, size_t len, size_t *matches, size_t *tags) {
+    double t0 = lex_now();
+    *matches = *tags = 0;
+    for (size_t pos = 0; pos < len;) {
+        int tag = 0;
+        size_t n = fn(text + pos, len - pos, &tag);
+        pos += n ? n : 1;
+        *matches += n != 0;
+        *tags += (size_t)tag;
+    }
+    return lex_now() - t0;
+}
+
+static void bench_matcher_case(const char *dfa_name, CorpusProfile profile, const DFA *dfa,
+                               const int *byte_symbol, MatchFn goto_fn, MatchFn switch_fn,
+                               size_t bytes, int rounds) {
+    static const char *modes[] = {"table", "goto", "switch"};
+    MatchFn fns[3] = {bench_table_match, goto_fn, switch_fn};
+    size_t len = 0;
+    const unsigned char *text = (const unsigned char *)make_corpus(profile, bytes, &len);
+    if (dfa_matcher_init(&bench_matcher, dfa, byte_symbol) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    printf("%s DFA (%d states, %d byte classes, %zu-byte table) over %zu bytes of the %s corpus, best of %d rounds\n",
+           dfa_name, dfa->state_count, bench_matcher.stride - 1,
+           (size_t)dfa->state_count * (size_t)bench_matcher.stride * sizeof(unsigned), len, corpus_names[profile],
+           rounds);
+    for (int mode = 0; mode < 3; ++mode) {
+        if (!fns[mode]) continue;
+        double best = 1e30;
+        size_t matches = 0, tags = 0;
+        for (int r = 0; r < rounds; ++r) {
+            double elapsed = bench_scan(fns[mode], text, len, &matches, &tags);
+            if (elapsed < best) best = elapsed;
+        }
+        char name[48];
+        snprintf(name, sizeof(name), "match_%s/%s", dfa_name, modes[mode]);
+        printf("  %-7s: %8.1f MB/s, %zu matches (tag sum %zu)\n", modes[mode], (double)len / best / 1e6,
+               matches, tags);
+        bench_record("automata", name, "mb_per_s", (double)len / best / 1e6);
+    }
+    dfa_matcher_free(&bench_matcher);
+    free((void *)text);
+}
+
+static void bench_matchers(size_t bytes, int rounds) {
+    NFA nfa;
+    DFA minimized;
+    MatchFn ident_goto = NULL, tokens_goto = NULL;
+#ifdef DFA_MATCHER_GOTO
+    ident_goto = ident_match_goto;
+    tokens_goto = c_token_match_goto;
+#endif
+    int symbols[MAX_SYMBOLS];
+    identifier_byte_symbols(symbols);
+    build_identifier_nfa(&nfa);
+    build_minimal_dfa(&nfa, &minimized);
+    bench_matcher_case("ident", CORPUS_IDENT, &minimized, symbols, ident_goto, ident_match_switch, bytes, rounds);
+    dfa_free(&minimized);
+    nfa_free(&nfa);
+    build_c_token_nfa(&nfa);
+    build_minimal_dfa(&nfa, &minimized);
+    bench_matcher_case("c_token", CORPUS_MIXED, &minimized, NULL, tokens_goto, c_token_match_switch, bytes, rounds);
+    dfa_free(&minimized);
+    nfa_free(&nfa);
+    if (build_regex_nfa(&nfa, bench_token_regex) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    nfa_compress_alphabet(&nfa, symbols);
+    build_minimal_dfa(&nfa, &minimized);
+    bench_matcher_case("regex", CORPUS_MIXED, &minimized, symbols, NULL, NULL, bytes, rounds);
+    dfa_free(&minimized);
+    nfa_free(&nfa);
+}
+
+/* The rules of c_tokens.rules. */
+static const RegexRule bench_rules[] = {
+    {"KEYWORD", "auto|break|case|char|const|continue|default|do|double|else|enum|extern|float|for|goto|if"
+                "|inline|int|long|register|restrict|return|short|signed|sizeof|static|struct|switch|typedef"
+                "|union|unsigned|void|volatile|while"},
+    {"IDENT", "[A-Za-z_][A-Za-z0-9_]*"},
+    {"HEX", "0[xX][0-9a-fA-F]+"},
+    {"FLOAT", "[0-9]+\\.[0-9]*([eE][-+]?[0-9]+)?|[0-9]+[eE][-+]?[0-9]+"},
+    {"INT", "[0-9]+"},
+    {"STRING", "\"([^\"\\\\\\n]|\\\\.)*\""},
+    {"CHAR", "'([^'\\\\\\n]|\\\\.)*'"},
+    {"LINE_COMMENT", "//[^\\n]*"},
+    {"BLOCK_COMMENT", "/\\*([^*]|\\*+[^*/])*\\*+/"},
+    {"OP", "[-+*/%=!<>&|^]=?|\\+\\+|--|&&|\\|\\||<<=?|>>=?|->|~"},
+    {"PUNC", "[(){}\\[\\];,.:?#]"},
+    {"BLANK", "[ \\t\\r\\n\\f\\v]+"},
+};
+#define BENCH_RULE_COUNT ((int)(sizeof(bench_rules) / sizeof(bench_rules[0])))
+
+static DFAMatcher bench_rule_matchers[BENCH_RULE_COUNT];
+
+/* The baseline: one DFA per rule, each tried at every position; the
+ * longest match wins, the earlier rule on a tie. */
+static size_t legacy_match_rules(const unsigned char *in, size_t len, int *tag) {
+    size_t best = 0;
+    *tag = 0;
+    for (int r = 0; r < BENCH_RULE_COUNT; ++r) {
+        int t = 0;
+        size_t n = dfa_match(&bench_rule_matchers[r], in, len, &t);
+        if (t && n > best) {
+            best = n;
+            *tag = r + 1;
+        }
+    }
+    return best;
+}
+
+/* Classifying the mixed corpus by the C token rules: one pass through the
+ * union's tagged DFA against trying the rules one by one. */
+static void bench_rules_case(size_t bytes, int rounds) {
+    NFA nfa;
+    DFA minimized;
+    int symbols[MAX_SYMBOLS];
+    size_t len = 0;
+    const unsigned char *text = (const unsigned char *)make_corpus(CORPUS_MIXED, bytes, &len);
+    int per_rule_states = 0;
+    for (int r = 0; r < BENCH_RULE_COUNT; ++r) {
+        if (build_rules_nfa(&nfa, &bench_rules[r], 1) != 0) {
+            exit(EXIT_FAILURE);
+        }
+        nfa_compress_alphabet(&nfa, symbols);
+        build_minimal_dfa(&nfa, &minimized);
+        per_rule_states += minimized.state_count;
+        if (dfa_matcher_init(&bench_rule_matchers[r], &minimized, symbols) != 0) {
+            exit(EXIT_FAILURE);
+        }
+        dfa_free(&minimized);
+        nfa_free(&nfa);
+    }
+    if (build_rules_nfa(&nfa, bench_rules, BENCH_RULE_COUNT) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    nfa_compress_alphabet(&nfa, symbols);
+    build_minimal_dfa(&nfa, &minimized);
+    if (dfa_matcher_init(&bench_matcher, &minimized, symbols) != 0) {
+        exit(EXIT_FAILURE);
+    }
+    printf("%d token rules over %zu bytes of the mixed corpus: tagged DFA %d states, per-rule DFAs %d states\n",
+           BENCH_RULE_COUNT, len, minimized.state_count, per_rule_states);
+    static const char *modes[] = {"one pass", "per rule"};
+    MatchFn fns[2] = {bench_table_match, legacy_match_rules};
+    size_t want_matches = 0, want_tags = 0;
+    for (int mode = 0; mode < 2; ++mode) {
+        double best = 1e30;
+        size_t matches = 0, tags = 0;
+        for (int r = 0; r < rounds; ++r) {
+            double elapsed = bench_scan(fns[mode], text, len, &matches, &tags);
+            if (elapsed < best) best = elapsed;
+        }
+        if (mode == 0) {
+            want_matches = matches;
+            want_tags = tags;
+        } else if (matches != want_matches || tags != want_tags) {
+            fprintf(stderr, "rule matchers disagree: %zu/%zu vs %zu/%zu\n", matches, tags, want_matches, want_tags);
+            exit(EXIT_FAILURE);
+        }
+        char name[48];
+        snprintf(name, sizeof(name), "rules/%s", mode ? "per_rule" : "one_pass");
+        printf("  %-8s: %8.1f MB/s, %zu tokens (tag sum %zu)\n", modes[mode], (double)len / best / 1e6, matches,
+               tags);
+        bench_record("automata", name, "mb_per_s", (double)len / best / 1e6);
+    }
+    for (int r = 0; r < BENCH_RULE_COUNT; ++r) {
+        dfa_matcher_free(&bench_rule_matchers[r]);
+    }
+    dfa_matcher_free(&bench_matcher);
+    dfa_free(&minimized);
+    nfa_free(&nfa);
+    free((void *)text);
+}
+
+static LazyDFA bench_lazy_dfa;
+
+static size_t bench_lazy_match(const unsigned char *in, size_t len, int *tag) {
+    return lazy_dfa_match(&bench_lazy_dfa, in, len, tag);
+}
+
+/* One lazy DFA scan per round, each starting from an empty cache, so the
+ * time includes every state the scan builds; checked against the full
+ * DFA's matches and tags when one was built (want_matches != 0). */
+static void bench_lazy_case(const char *case_name, const NFA *nfa, const int *byte_symbol, int cache_states,
+                            const unsigned char *text, size_t len, int rounds, size_t want_matches,
+                            size_t want_tags) {
+    double best = 1e30;
+    size_t matches = 0, tags = 0;
+    for (int r = 0; r < rounds; ++r) {
+        lazy_dfa_init(&bench_lazy_dfa, nfa, byte_symbol, cache_states);
+        double elapsed = bench_scan(bench_lazy_match, text, len, &matches, &tags);
+        if (elapsed < best) best = elapsed;
+        if (r + 1 < rounds) lazy_dfa_free(&bench_lazy_dfa);
+    }
+    if (want_matches && (matches != want_matches || tags != want_tags)) {
+        fprintf(stderr, "lazy DFA disagrees with the full DFA: %zu/%zu vs %zu/%zu\n", matches, tags,
+                want_matches, want_tags);
+        exit(EXIT_FAILURE);
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "lazy_%s/c%d", case_name, cache_states);
+    printf("  lazy, %6d-state cache: %8.1f MB/s, %zu hits, %zu misses, %zu flushes\n", cache_states,
+           (double)len / best / 1e6, bench_lazy_dfa.hits, bench_lazy_dfa.misses, bench_lazy_dfa.flushes);
+    bench_record("automata", name, "mb_per_s", (double)len / best / 1e6);
+    bench_record("automata", name, "misses", (double)bench_lazy_dfa.misses);
+    lazy_dfa_free(&bench_lazy_dfa);
+}
+
+/* Lazy DFA against full determinization: the token regex over the mixed
+ * corpus, where the whole DFA fits the cache, and "(a|b)*a(a|b){k}" over
+ * words of a and b, whose DFA has 2^(k+1) states.  The full DFA is only
+ * built for the small k. */
+static void bench_lazy(size_t bytes, int rounds) {
+    NFA nfa;
+    DFA minimized;
+    int symbols[MAX_SYMBOLS];
+    size_t len = 0;
+    const unsigned char *text = (const unsigned char *)make_corpus(CORPUS_MIXED, bytes, &len);
+    static const int ks[] = {-1, 10, 20};    /* -1: the token regex */
+    for (size_t c = 0; c < sizeof(ks) / sizeof(ks[0]); ++c) {
+        int k = ks[c];
+        char pattern[48];
+        if (k >= 0) {
+            snprintf(pattern, sizeof(pattern), "(a|b)*a(a|b){%d}", k);
+        }
+        if (build_regex_nfa(&nfa, k < 0 ? bench_token_regex : pattern) != 0) {
+            exit(EXIT_FAILURE);
+        }
+        nfa_compress_alphabet(&nfa, symbols);
+        if (k == 10) {
+            /* words of 20 to 59 letters, a and b evenly, one per line */
+            len = bytes / 8;
+            unsigned char *words = (unsigned char *)malloc(len);
+            if (!words) {
+                fprintf(stderr, "out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+            for (size_t i = 0; i < len;) {
+                size_t n = 20 + (size_t)(bench_rand() % 40);
+                for (size_t j = 0; j < n && i < len; ++j) {
+                    words[i++] = (unsigned char)('a' + (bench_rand() & 1));
+                }
+                if (i < len) words[i++] = '\n';
+            }
+            free((void *)text);
+            text = words;
+        }
+        size_t matches = 0, tags = 0;
+        printf("%s: NFA %d states, %zu bytes of %s\n", k < 0 ? "token regex" : pattern, nfa.state_count, len,
+               k < 0 ? "the mixed corpus" : "a/b words");
+        if (k <= 10) {
+            double t0 = lex_now();
+            build_minimal_dfa(&nfa, &minimized);
+            double build = lex_now() - t0;
+            if (dfa_matcher_init(&bench_matcher, &minimized, symbols) != 0) {
+                exit(EXIT_FAILURE);
+            }
+            double best = 1e30;
+            for (int r = 0; r < rounds; ++r) {
+                double elapsed = bench_scan(bench_table_match, text, len, &matches, &tags);
+                if (elapsed < best) best = elapsed;
+            }
+            printf("  full DFA, %d states: built in %.3f ms, %8.1f MB/s\n", minimized.state_count, build * 1e3,
+                   (double)len / best / 1e6);
+            dfa_matcher_free(&bench_matcher);
+            dfa_free(&minimized);
+        }
+        const char *case_name = k < 0 ? "regex" : k <= 10 ? "ab10" : "ab20";
+        bench_lazy_case(case_name, &nfa, symbols, 64, text, len, rounds, matches, tags);
+        bench_lazy_case(case_name, &nfa, symbols, 4096, text, len, rounds, matches, tags);
+        nfa_free(&nfa);
+    }
+    free((void *)text);
+}
+
+/* Parses a byte count with an optional K, M or G suffix. */
+static size_t bench_parse_size(const char *text) {
+    char *end = NULL;
+    unsigned long long value = strtoull(text, &end, 10);
+    switch (end && *end ? *end : ' ') {
+        case 'k': case 'K': value <<= 10; break;
+        case 'm': case 'M': value <<= 20; break;
+        case 'g': case 'G': value <<= 30; break;
+        default: break;
+    }
+    return (size_t)value;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--suite lexer|automata|all] [--size bytes[K|M|G]]\n"
+                    "       [--corpus ident|comment|literal|mixed|all] [--seed n] [--rounds n]\n"
+                    "       [--nfa-states n] [--json results.jsonl] [identifier-count]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    size_t count = 1000000;
+    size_t size = 64u << 20;
+    int rounds = 3;
+    int nfa_states = 16384;
+    int lexer = 1, automata = 1;
+    int corpus = -1;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--suite") == 0 && value) {
+            lexer = strcmp(value, "automata") != 0;
+            automata = strcmp(value, "lexer") != 0;
+            i++;
+        } else if (strcmp(arg, "--size") == 0 && value) {
+            size = bench_parse_size(value);
+            i++;
+        } else if (strcmp(arg, "--corpus") == 0 && value) {
+            corpus = -1;
+            for (int k = 0; k < CORPUS_COUNT; ++k) {
+                if (strcmp(value, corpus_names[k]) == 0) corpus = k;
+            }
+            if (corpus < 0 && strcmp(value, "all") != 0) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            i++;
+        } else if (strcmp(arg, "--seed") == 0 && value) {
+            bench_seed = strtoull(value, NULL, 10);
+            i++;
+        } else if (strcmp(arg, "--rounds") == 0 && value) {
+            rounds = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--nfa-states") == 0 && value) {
+            nfa_states = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--json") == 0 && value) {
+            bench_json = fopen(value, "a");
+            if (!bench_json) {
+                fprintf(stderr, "%s: %s\n", value, strerror(errno));
+                return EXIT_FAILURE;
+            }
+            i++;
+        } else if (arg[0] != '-' && strtoull(arg, NULL, 10) > 0) {
+            count = (size_t)strtoull(arg, NULL, 10);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (size == 0 || rounds <= 0 || nfa_states < 8) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    bench_rng_state ^= bench_seed * 0x9e3779b97f4a7c15ull;
+    if (bench_rng_state == 0) bench_rng_state = 1;
+    lex_kernels_select(NULL);
+
+    if (lexer) {
+        for (int k = 0; k < CORPUS_COUNT; ++k) {
+            if (corpus < 0 || corpus == k) bench_corpus((CorpusProfile)k, size, rounds);
+        }
+        bench_keywords(count, 5);
+        bench_intern(count);
+        bench_lex_kernels(size, rounds);
+        bench_positions(size, rounds);
+        bench_values(size, rounds);
+        bench_stream(size, rounds);
+        bench_batches(size / 4 ? size / 4 : size, rounds);
+        bench_incremental(size < (8u << 20) ? size : 8u << 20, 200);
+        bench_report_rss("lexer");
+    }
+    if (automata) {
+        bench_matchers(size, rounds);
+        bench_lazy(size, rounds);
+        bench_rules_case(size, rounds);
+        bench_automata(nfa_states, 200);
+    }
+    if (bench_json) {
+        fclose(bench_json);
+    }
+    return EXIT_SUCCESS;
+}
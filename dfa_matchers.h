@@ -0,0 +1,544 @@
+/* Generated by `nfa_to_dfa --emit-matcher dfa_matchers.h` from Untitled-2.c.
+ * Each function returns the length of the longest accepted prefix of
+ * in[0..len) and stores its tag in *tag (0 when nothing matches). */
+#ifndef DFA_MATCHERS_H
+#define DFA_MATCHERS_H
+
+#include <stddef.h>
+
+#if defined(__GNUC__) && !defined(DFA_MATCHER_NO_GOTO)
+#define DFA_MATCHER_GOTO 1
+#endif
+
+/* ident_match: 3 states, 3 byte classes. */
+#ifdef DFA_MATCHER_GOTO
+static const unsigned char ident_match_class[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+    0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0,
+    0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static size_t ident_match_goto(const unsigned char *in, size_t len, int *tag) {
+    const unsigned char *p = in, *end = in + len, *last = in;
+    static const void *const next[3][3] = {
+        {&&done, &&q0, &&q0},
+        {&&done, &&done, &&q0},
+        {&&done, &&done, &&done},
+    };
+    int best = 0;
+    goto q1;
+q0:
+    last = p;
+    best = 1;
+    if (p == end) goto done;
+    goto *next[0][ident_match_class[*p++]];
+q1:
+    if (p == end) goto done;
+    goto *next[1][ident_match_class[*p++]];
+done:
+    *tag = best;
+    return (size_t)(last - in);
+}
+#endif
+
+static size_t ident_match_switch(const unsigned char *in, size_t len, int *tag) {
+    const unsigned char *p = in, *end = in + len, *last = in;
+    int best = 0;
+    goto q1;
+q0:
+    last = p;
+    best = 1;
+    if (p == end) goto done;
+    switch (*p++) {
+    case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7':
+    case '8': case '9': case 'A': case 'B': case 'C': case 'D': case 'E': case 'F':
+    case 'G': case 'H': case 'I': case 'J': case 'K': case 'L': case 'M': case 'N':
+    case 'O': case 'P': case 'Q': case 'R': case 'S': case 'T': case 'U': case 'V':
+    case 'W': case 'X': case 'Y': case 'Z': case 'a': case 'b': case 'c': case 'd':
+    case 'e': case 'f': case 'g': case 'h': case 'i': case 'j': case 'k': case 'l':
+    case 'm': case 'n': case 'o': case 'p': case 'q': case 'r': case 's': case 't':
+    case 'u': case 'v': case 'w': case 'x': case 'y': case 'z':
+        goto q0;
+    default:
+        goto done;
+    }
+q1:
+    if (p == end) goto done;
+    switch (*p++) {
+    case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G': case 'H':
+    case 'I': case 'J': case 'K': case 'L': case 'M': case 'N': case 'O': case 'P':
+    case 'Q': case 'R': case 'S': case 'T': case 'U': case 'V': case 'W': case 'X':
+    case 'Y': case 'Z': case 'a': case 'b': case 'c': case 'd': case 'e': case 'f':
+    case 'g': case 'h': case 'i': case 'j': case 'k': case 'l': case 'm': case 'n':
+    case 'o': case 'p': case 'q': case 'r': case 's': case 't': case 'u': case 'v':
+    case 'w': case 'x': case 'y': case 'z':
+        goto q0;
+    default:
+        goto done;
+    }
+done:
+    *tag = best;
+    return (size_t)(last - in);
+}
+
+/* c_token_match: 25 states, 20 byte classes. */
+#ifdef DFA_MATCHER_GOTO
+static const unsigned char c_token_match_class[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 2, 3, 4, 0, 5, 4, 6, 4, 4, 7, 8, 4, 9, 10, 11,
+    12, 13, 13, 13, 13, 13, 13, 13, 13, 13, 4, 4, 2, 14, 2, 4,
+    0, 15, 15, 15, 15, 16, 15, 17, 17, 17, 17, 17, 17, 17, 17, 17,
+    17, 17, 17, 17, 17, 17, 17, 17, 18, 17, 17, 4, 19, 4, 4, 17,
+    0, 15, 15, 15, 15, 16, 15, 17, 17, 17, 17, 17, 17, 17, 17, 17,
+    17, 17, 17, 17, 17, 17, 17, 17, 18, 17, 17, 4, 4, 4, 4, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static size_t c_token_match_goto(const unsigned char *in, size_t len, int *tag) {
+    const unsigned char *p = in, *end = in + len, *last = in;
+    static const void *const next[25][20] = {
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&q0, &&q0, &&done, &&q0, &&q0, &&q0, &&q0, &&done},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&q4, &&done, &&q2, &&q2, &&done, &&done, &&q5, &&done, &&q3, &&done},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&q4, &&done, &&q2, &&q2, &&done, &&done, &&q5, &&done, &&done, &&done},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&q3, &&q3, &&done, &&q3, &&q3, &&done, &&done, &&done},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&q4, &&q4, &&done, &&done, &&q5, &&done, &&done, &&done},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&q6, &&q6, &&done, &&done, &&q6, &&q6, &&done, &&done, &&done, &&done, &&done, &&done},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&q6, &&q6, &&done, &&done, &&done, &&done, &&done, &&done},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&q10, &&done, &&done, &&done, &&done, &&done},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&q10, &&done, &&done, &&done, &&done, &&done, &&q10, &&done, &&done, &&done, &&done, &&done},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&q10, &&done, &&done, &&done, &&done, &&q10, &&done, &&done, &&done, &&done, &&done},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&q22, &&done, &&done, &&done, &&q15, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done},
+        {&&q15, &&done, &&q15, &&q15, &&q15, &&q15, &&q15, &&q15, &&q15, &&q15, &&q15, &&q15, &&q15, &&q15, &&q15, &&q15, &&q15, &&q15, &&q15, &&q15},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done},
+        {&&done, &&done, &&q9, &&q18, &&q14, &&q10, &&q19, &&q10, &&q11, &&q12, &&q14, &&q13, &&q1, &&q2, &&q9, &&q0, &&q0, &&q0, &&q0, &&done},
+        {&&q18, &&q18, &&q18, &&q7, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q20},
+        {&&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q8, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q21},
+        {&&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18, &&q18},
+        {&&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19, &&q19},
+        {&&q22, &&q22, &&q22, &&q22, &&q22, &&q22, &&q22, &&q23, &&q22, &&q22, &&q22, &&q22, &&q22, &&q22, &&q22, &&q22, &&q22, &&q22, &&q22, &&q22},
+        {&&q22, &&q22, &&q22, &&q22, &&q22, &&q22, &&q22, &&q23, &&q22, &&q22, &&q22, &&q16, &&q22, &&q22, &&q22, &&q22, &&q22, &&q22, &&q22, &&q22},
+        {&&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done, &&done},
+    };
+    int best = 0;
+    goto q17;
+q0:
+    last = p;
+    best = 1;
+    if (p == end) goto done;
+    goto *next[0][c_token_match_class[*p++]];
+q1:
+    last = p;
+    best = 2;
+    if (p == end) goto done;
+    goto *next[1][c_token_match_class[*p++]];
+q2:
+    last = p;
+    best = 2;
+    if (p == end) goto done;
+    goto *next[2][c_token_match_class[*p++]];
+q3:
+    last = p;
+    best = 3;
+    if (p == end) goto done;
+    goto *next[3][c_token_match_class[*p++]];
+q4:
+    last = p;
+    best = 4;
+    if (p == end) goto done;
+    goto *next[4][c_token_match_class[*p++]];
+q5:
+    last = p;
+    best = 4;
+    if (p == end) goto done;
+    goto *next[5][c_token_match_class[*p++]];
+q6:
+    last = p;
+    best = 4;
+    if (p == end) goto done;
+    goto *next[6][c_token_match_class[*p++]];
+q7:
+    last = p;
+    best = 5;
+    if (p == end) goto done;
+    goto *next[7][c_token_match_class[*p++]];
+q8:
+    last = p;
+    best = 6;
+    if (p == end) goto done;
+    goto *next[8][c_token_match_class[*p++]];
+q9:
+    last = p;
+    best = 7;
+    if (p == end) goto done;
+    goto *next[9][c_token_match_class[*p++]];
+q10:
+    last = p;
+    best = 7;
+    if (p == end) goto done;
+    goto *next[10][c_token_match_class[*p++]];
+q11:
+    last = p;
+    best = 7;
+    if (p == end) goto done;
+    goto *next[11][c_token_match_class[*p++]];
+q12:
+    last = p;
+    best = 7;
+    if (p == end) goto done;
+    goto *next[12][c_token_match_class[*p++]];
+q13:
+    last = p;
+    best = 7;
+    if (p == end) goto done;
+    goto *next[13][c_token_match_class[*p++]];
+q14:
+    last = p;
+    best = 8;
+    if (p == end) goto done;
+    goto *next[14][c_token_match_class[*p++]];
+q15:
+    last = p;
+    best = 9;
+    if (p == end) goto done;
+    goto *next[15][c_token_match_class[*p++]];
+q16:
+    last = p;
+    best = 10;
+    if (p == end) goto done;
+    goto *next[16][c_token_match_class[*p++]];
+q17:
+    if (p == end) goto done;
+    goto *next[17][c_token_match_class[*p++]];
+q18:
+    if (p == end) goto done;
+    goto *next[18][c_token_match_class[*p++]];
+q19:
+    if (p == end) goto done;
+    goto *next[19][c_token_match_class[*p++]];
+q20:
+    if (p == end) goto done;
+    goto *next[20][c_token_match_class[*p++]];
+q21:
+    if (p == end) goto done;
+    goto *next[21][c_token_match_class[*p++]];
+q22:
+    if (p == end) goto done;
+    goto *next[22][c_token_match_class[*p++]];
+q23:
+    if (p == end) goto done;
+    goto *next[23][c_token_match_class[*p++]];
+done:
+    *tag = best;
+    return (size_t)(last - in);
+}
+#endif
+
+static size_t c_token_match_switch(const unsigned char *in, size_t len, int *tag) {
+    const unsigned char *p = in, *end = in + len, *last = in;
+    int best = 0;
+    goto q17;
+q0:
+    last = p;
+    best = 1;
+    if (p == end) goto done;
+    switch (*p++) {
+    case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7':
+    case '8': case '9': case 'A': case 'B': case 'C': case 'D': case 'E': case 'F':
+    case 'G': case 'H': case 'I': case 'J': case 'K': case 'L': case 'M': case 'N':
+    case 'O': case 'P': case 'Q': case 'R': case 'S': case 'T': case 'U': case 'V':
+    case 'W': case 'X': case 'Y': case 'Z': case 95: case 'a': case 'b': case 'c':
+    case 'd': case 'e': case 'f': case 'g': case 'h': case 'i': case 'j': case 'k':
+    case 'l': case 'm': case 'n': case 'o': case 'p': case 'q': case 'r': case 's':
+    case 't': case 'u': case 'v': case 'w': case 'x': case 'y': case 'z':
+        goto q0;
+    default:
+        goto done;
+    }
+q1:
+    last = p;
+    best = 2;
+    if (p == end) goto done;
+    switch (*p++) {
+    case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7':
+    case '8': case '9':
+        goto q2;
+    case 'X': case 'x':
+        goto q3;
+    case 46:
+        goto q4;
+    case 'E': case 'e':
+        goto q5;
+    default:
+        goto done;
+    }
+q2:
+    last = p;
+    best = 2;
+    if (p == end) goto done;
+    switch (*p++) {
+    case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7':
+    case '8': case '9':
+        goto q2;
+    case 46:
+        goto q4;
+    case 'E': case 'e':
+        goto q5;
+    default:
+        goto done;
+    }
+q3:
+    last = p;
+    best = 3;
+    if (p == end) goto done;
+    switch (*p++) {
+    case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7':
+    case '8': case '9': case 'A': case 'B': case 'C': case 'D': case 'E': case 'F':
+    case 'a': case 'b': case 'c': case 'd': case 'e': case 'f':
+        goto q3;
+    default:
+        goto done;
+    }
+q4:
+    last = p;
+    best = 4;
+    if (p == end) goto done;
+    switch (*p++) {
+    case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7':
+    case '8': case '9':
+        goto q4;
+    case 'E': case 'e':
+        goto q5;
+    default:
+        goto done;
+    }
+q5:
+    last = p;
+    best = 4;
+    if (p == end) goto done;
+    switch (*p++) {
+    case 43: case 45: case '0': case '1': case '2': case '3': case '4': case '5':
+    case '6': case '7': case '8': case '9':
+        goto q6;
+    default:
+        goto done;
+    }
+q6:
+    last = p;
+    best = 4;
+    if (p == end) goto done;
+    switch (*p++) {
+    case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7':
+    case '8': case '9':
+        goto q6;
+    default:
+        goto done;
+    }
+q7:
+    last = p;
+    best = 5;
+    if (p == end) goto done;
+    switch (*p++) {
+    default:
+        goto done;
+    }
+q8:
+    last = p;
+    best = 6;
+    if (p == end) goto done;
+    switch (*p++) {
+    default:
+        goto done;
+    }
+q9:
+    last = p;
+    best = 7;
+    if (p == end) goto done;
+    switch (*p++) {
+    case 61:
+        goto q10;
+    default:
+        goto done;
+    }
+q10:
+    last = p;
+    best = 7;
+    if (p == end) goto done;
+    switch (*p++) {
+    default:
+        goto done;
+    }
+q11:
+    last = p;
+    best = 7;
+    if (p == end) goto done;
+    switch (*p++) {
+    case 43: case 61:
+        goto q10;
+    default:
+        goto done;
+    }
+q12:
+    last = p;
+    best = 7;
+    if (p == end) goto done;
+    switch (*p++) {
+    case 45: case 61:
+        goto q10;
+    default:
+        goto done;
+    }
+q13:
+    last = p;
+    best = 7;
+    if (p == end) goto done;
+    switch (*p++) {
+    case 47:
+        goto q15;
+    case 42:
+        goto q22;
+    default:
+        goto done;
+    }
+q14:
+    last = p;
+    best = 8;
+    if (p == end) goto done;
+    switch (*p++) {
+    default:
+        goto done;
+    }
+q15:
+    last = p;
+    best = 9;
+    if (p == end) goto done;
+    switch (*p++) {
+    case 10:
+        goto done;
+    default:
+        goto q15;
+    }
+q16:
+    last = p;
+    best = 10;
+    if (p == end) goto done;
+    switch (*p++) {
+    default:
+        goto done;
+    }
+q17:
+    if (p == end) goto done;
+    switch (*p++) {
+    case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G': case 'H':
+    case 'I': case 'J': case 'K': case 'L': case 'M': case 'N': case 'O': case 'P':
+    case 'Q': case 'R': case 'S': case 'T': case 'U': case 'V': case 'W': case 'X':
+    case 'Y': case 'Z': case 95: case 'a': case 'b': case 'c': case 'd': case 'e':
+    case 'f': case 'g': case 'h': case 'i': case 'j': case 'k': case 'l': case 'm':
+    case 'n': case 'o': case 'p': case 'q': case 'r': case 's': case 't': case 'u':
+    case 'v': case 'w': case 'x': case 'y': case 'z':
+        goto q0;
+    case '0':
+        goto q1;
+    case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8':
+    case '9':
+        goto q2;
+    case 33: case 60: case 61: case 62:
+        goto q9;
+    case 37: case 42:
+        goto q10;
+    case 43:
+        goto q11;
+    case 45:
+        goto q12;
+    case 47:
+        goto q13;
+    case 35: case 38: case 40: case 41: case 44: case 46: case 58: case 59:
+    case 63: case 91: case 93: case 94: case 123: case 124: case 125: case 126:
+        goto q14;
+    case 34:
+        goto q18;
+    case 39:
+        goto q19;
+    default:
+        goto done;
+    }
+q18:
+    if (p == end) goto done;
+    switch (*p++) {
+    case 34:
+        goto q7;
+    case 92:
+        goto q20;
+    default:
+        goto q18;
+    }
+q19:
+    if (p == end) goto done;
+    switch (*p++) {
+    case 39:
+        goto q8;
+    case 92:
+        goto q21;
+    default:
+        goto q19;
+    }
+q20:
+    if (p == end) goto done;
+    switch (*p++) {
+    default:
+        goto q18;
+    }
+q21:
+    if (p == end) goto done;
+    switch (*p++) {
+    default:
+        goto q19;
+    }
+q22:
+    if (p == end) goto done;
+    switch (*p++) {
+    case 42:
+        goto q23;
+    default:
+        goto q22;
+    }
+q23:
+    if (p == end) goto done;
+    switch (*p++) {
+    case 47:
+        goto q16;
+    case 42:
+        goto q23;
+    default:
+        goto q22;
+    }
+done:
+    *tag = best;
+    return (size_t)(last - in);
+}
+
+#endif